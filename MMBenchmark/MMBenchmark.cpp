@@ -0,0 +1,1437 @@
+// Benchmarks for the matchmaking core.
+// Every measured path is run across population sizes and team configurations and reported as ns/op and allocations/op,
+// with a scaling column relative to the smallest population so the growth of each path is visible at a glance.
+//
+// A party mix section packs the same population into 5v5 matches under different party size distributions and reports how
+// many matches the queue still yields compared to solo players.
+//
+// A balancing section splits the same random matches with each team balancing mode and reports the resulting rating spread.
+//
+// A region sharding section runs the same Poisson load with one global queue and with per-region queues at several spillover
+// waits, and reports queue time, host latency and matchmaking CPU time.
+//
+// A policy section runs that load under every formation and region policy pair, skill windows at several growth rates, and
+// reports queue time, host latency, the rating range within matches and matchmaking CPU time.
+//
+// A role section runs that load through role queues with several team compositions and reports queue time, how long
+// matchmaking waited on each role and matchmaking CPU time.
+//
+// An outcome section evaluates the same 5v5 matches in batches of several sizes and reports the time and allocations per match
+// and how strongly the model favors the stronger team.
+//
+// A rounds section plays the same 5v5 matches out in rounds on several thread counts and reports the time and allocations per
+// match, the rounds a match lasts and how often the stronger team wins.
+//
+// A predictor section runs a busy Poisson load with the win predictor off, frozen at its Elo prior, learning, and learning while
+// it balances the teams, and reports the update time of the whole run and how well the chances given at formation predicted the
+// results.
+//
+// A ratings section rates the same four team matches of players with a hidden skill under every rating system, on several
+// thread counts, and reports the time and allocations per match and how closely the ratings came to order the players by skill.
+//
+// A rematch section runs a thin Poisson load through one global queue with rematch avoidance off and at several grace periods,
+// and reports how many matches paired recent opponents, the queue time it cost and matchmaking CPU time.
+//
+// An abandonment section runs Poisson loads of increasing arrival rate with impatient players and reports how many parties gave
+// up waiting and how many breached the wait-time SLO, to show the load below which abandonment becomes significant.
+//
+// Before any section runs, a trace check records scopes on short-lived threads and fails the run if the trace buffers grow with
+// the number of threads started.
+//
+// Usage: MMBenchmark [--max-population <n>] [--csv <file>], the CSV holds the benchmark table followed by every section
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../MMSimulator/MatchMaking/MatchMakingSystem.h"
+#include "../MMSimulator/MatchMaking/RandomGenerator.h"
+#include "../MMSimulator/MatchMaking/SimClock.h"
+#include "../MMSimulator/MatchMaking/TraceRecorder.h"
+
+// ===== ALLOCATION COUNTING BEGIN =====
+
+namespace
+{
+    std::atomic<uint64_t> numAllocations{0};
+}
+
+void* operator new(std::size_t size)
+{
+    numAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+// ===== ALLOCATION COUNTING END =====
+
+namespace
+{
+    // Minimum wall time for benchmarks that repeat a read-only call
+    constexpr double MinRepeatSeconds = 0.2;
+
+    struct FTeamConfig
+    {
+        const char* name;
+        int numTeams;
+        int teamSize;
+    };
+
+    const std::vector<FTeamConfig> TeamConfigs = {
+        {"1v1", 2, 1},
+        {"2v2", 2, 2},
+        {"3v3", 2, 3},
+        {"5v5", 2, 5},
+        {"4x3", 4, 3}, // multi-team
+        {"8x1", 8, 1}, // free-for-all
+    };
+
+    struct FBenchResult
+    {
+        std::string name;
+        std::string config;
+        int64_t population = 0;
+        uint64_t ops = 0;
+        double nsPerOp = 0.0;
+        double allocsPerOp = 0.0;
+    };
+
+    // Runs fn once, fn returns how many operations it performed
+    template <typename Fn>
+    FBenchResult Measure(const char* name, const char* config, int64_t population, Fn&& fn)
+    {
+        uint64_t allocsBefore = numAllocations.load(std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        uint64_t ops = fn();
+        auto end = std::chrono::steady_clock::now();
+        uint64_t allocs = numAllocations.load(std::memory_order_relaxed) - allocsBefore;
+
+        FBenchResult result;
+        result.name = name;
+        result.config = config;
+        result.population = population;
+        result.ops = ops;
+        double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        result.nsPerOp = ops == 0 ? 0.0 : ns / static_cast<double>(ops);
+        result.allocsPerOp = ops == 0 ? 0.0 : static_cast<double>(allocs) / static_cast<double>(ops);
+        return result;
+    }
+
+    // Repeats fn until MinRepeatSeconds have passed, each call performs {opsPerCall} operations. One unmeasured call warms up
+    // whatever fn grows once, and single operations run 16 calls between clock reads
+    template <typename Fn>
+    FBenchResult MeasureRepeated(const char* name, const char* config, int64_t population, Fn&& fn, uint64_t opsPerCall = 1)
+    {
+        fn();
+        const int callsPerCheck = opsPerCall > 1 ? 1 : 16;
+        return Measure(name, config, population, [&fn, opsPerCall, callsPerCheck]()
+        {
+            uint64_t ops = 0;
+            auto start = std::chrono::steady_clock::now();
+            do
+            {
+                for (int i = 0; i < callsPerCheck; ++i)
+                {
+                    fn();
+                }
+                ops += callsPerCheck * opsPerCall;
+            } while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < MinRepeatSeconds);
+            return ops;
+        });
+    }
+
+    // party size weights for sizes 1 - 5, packed into 5v5 teams
+    struct FPartyMix
+    {
+        const char* name;
+        std::vector<float> weights;
+    };
+
+    const std::vector<FPartyMix> PartyMixes = {
+        {"solo", {1.0f}},
+        {"duos", {0.6f, 0.4f}},
+        {"mixed", {0.4f, 0.25f, 0.15f, 0.1f, 0.1f}},
+        {"stacks", {0.3f, 0.0f, 0.0f, 0.2f, 0.5f}},
+        {"nosolo", {0.0f, 0.4f, 0.4f, 0.2f}}, // fours need a solo to fill a team
+    };
+
+    struct FBalancingMode
+    {
+        const char* name;
+        ETeamBalancing mode;
+        bool bLocalSearch;
+    };
+
+    const std::vector<FBalancingMode> BalancingModes = {
+        {"None", ETeamBalancing::None, false},
+        {"Greedy", ETeamBalancing::Greedy, false},
+        {"Greedy+LS", ETeamBalancing::Greedy, true},
+        {"KK", ETeamBalancing::Differencing, false},
+        {"KK+LS", ETeamBalancing::Differencing, true},
+    };
+
+    struct FShardingMode
+    {
+        const char* name;
+        bool bRegionSharding;
+        float spilloverWait;
+    };
+
+    const std::vector<FShardingMode> ShardingModes = {
+        {"global", false, 0.0f},
+        {"spill 5s", true, 5.0f},
+        {"spill 10s", true, 10.0f},
+        {"spill 30s", true, 30.0f},
+    };
+
+    struct FPolicyMode
+    {
+        const char* name;
+        EMatchFormation formation;
+        bool bRegionSharding;
+        float searchWindowGrowth;
+    };
+
+    const std::vector<FPolicyMode> PolicyModes = {
+        {"fifo", EMatchFormation::Fifo, false, 0.0f},
+        {"fifo/shard", EMatchFormation::Fifo, true, 0.0f},
+        {"bucket", EMatchFormation::SkillBuckets, false, 0.0f},
+        {"bucket/shard", EMatchFormation::SkillBuckets, true, 0.0f},
+        {"win+25", EMatchFormation::SkillWindows, false, 25.0f},
+        {"win+50", EMatchFormation::SkillWindows, false, 50.0f},
+        {"win+100", EMatchFormation::SkillWindows, false, 100.0f},
+        {"win+50/shard", EMatchFormation::SkillWindows, true, 50.0f},
+        {"style", EMatchFormation::PlayStyle, false, 0.0f},
+        {"style/shard", EMatchFormation::PlayStyle, true, 0.0f},
+    };
+
+    struct FRoleMode
+    {
+        const char* name;
+        FRoleComposition composition;
+        bool bRegionSharding;
+    };
+
+    const std::vector<FRoleMode> RoleModes = {
+        {"1/1/3", {1, 1, 3}, false},
+        {"1/2/2", {1, 2, 2}, false},
+        {"2/1/2", {2, 1, 2}, false},
+        {"0/0/5", {0, 0, 5}, false},
+        {"1/1/3/shard", {1, 1, 3}, true},
+    };
+
+    struct FBatchMode
+    {
+        const char* name;
+        EMatchFormation formation;
+        int batchThreads;
+        float batchBudgetMs;
+    };
+
+    const std::vector<FBatchMode> BatchModes = {
+        {"fifo", EMatchFormation::Fifo, 0, 0.0f},
+        {"win+50", EMatchFormation::SkillWindows, 0, 0.0f},
+        {"batch 1t", EMatchFormation::Batch, 1, 0.0f},
+        {"batch 4t", EMatchFormation::Batch, 4, 0.0f},
+        {"batch 4t/1ms", EMatchFormation::Batch, 4, 1.0f},
+        {"batch 4t/.1ms", EMatchFormation::Batch, 4, 0.1f},
+    };
+
+    struct FBackfillMode
+    {
+        const char* name;
+        bool bBackfill;
+        float backfillGrace;
+        float disconnectRate;
+    };
+
+    const std::vector<FBackfillMode> BackfillModes = {
+        {"off", false, 0.5f, 10.0f},
+        {"grace 0.5s", true, 0.5f, 10.0f},
+        {"grace 0s", true, 0.0f, 10.0f},
+        {"off/calm", false, 0.5f, 2.0f},
+        {"0.5s/calm", true, 0.5f, 2.0f},
+    };
+
+    struct FOutcomeMode
+    {
+        const char* name;
+        int batchSize;  // matches evaluated together
+    };
+
+    const std::vector<FOutcomeMode> OutcomeModes = {
+        {"batch 1", 1},
+        {"batch 16", 16},
+        {"batch 256", 256},
+    };
+
+    struct FRoundMode
+    {
+        const char* name;
+        int numThreads; // 0 for one per core
+    };
+
+    const std::vector<FRoundMode> RoundModes = {
+        {"1 thread", 1},
+        {"4 threads", 4},
+        {"all cores", 0},
+    };
+
+    struct FPredictorMode
+    {
+        const char* name;
+        bool bWinPredictor;
+        float learningRate;
+        bool bBalanceByPrediction;
+    };
+
+    const std::vector<FPredictorMode> PredictorModes = {
+        {"off", false, 0.0f, false},
+        {"prior", true, 0.0f, false},
+        {"learning", true, 0.02f, false},
+        {"balancing", true, 0.02f, true},
+    };
+
+    struct FRatingMode
+    {
+        const char* name;
+        ERatingSystem system;
+        int numThreads; // 0 for one per core
+    };
+
+    const std::vector<FRatingMode> RatingModes = {
+        {"Elo", ERatingSystem::Elo, 1},
+        {"Glicko-2", ERatingSystem::Glicko2, 1},
+        {"Glicko-2 x4", ERatingSystem::Glicko2, 4},
+        {"TrueSkill", ERatingSystem::TrueSkill, 1},
+        {"TrueSkill x4", ERatingSystem::TrueSkill, 4},
+    };
+
+    struct FRematchMode
+    {
+        const char* name;
+        bool bAvoidRematches;
+        float graceSeconds;
+    };
+
+    const std::vector<FRematchMode> RematchModes = {
+        {"off", false, 0.0f},
+        {"grace 1s", true, 1.0f},
+        {"grace 30s", true, 30.0f},
+    };
+
+    const std::vector<float> AbandonmentRates = { 0.05f, 0.1f, 0.2f, 0.5f, 1.0f, 2.0f }; // arrivals per second
+
+    // One value of a section row. Counts print without decimals, the unit follows the value and names it in the CSV header
+    struct FCell
+    {
+        FCell(const char* inTitle, int inWidth, int64_t count)
+            : title(inTitle), value(static_cast<double>(count)), width(inWidth)
+        {
+        }
+
+        FCell(const char* inTitle, int inWidth, int inPrecision, double inValue, const char* inUnit = "")
+            : title(inTitle), value(inValue), width(inWidth), precision(inPrecision), unit(inUnit)
+        {
+        }
+
+        const char* title;
+        double value;
+        int width;
+        int precision = 0;
+        const char* unit = "";
+    };
+
+    using FSectionRow = std::vector<FCell>;
+
+    // A table with one row per mode, or per team config and mode. Each run returns its row, whose cells also make the columns
+    struct FSection
+    {
+        const char* name;                       // heads the mode column and names the runs in the progress output
+        int labelWidth = 10;
+        std::vector<std::string> labels;
+        std::vector<std::string> configs;       // empty unless every mode runs per team config
+        std::function<FSectionRow(size_t)> run; // runs the row at the index
+        std::vector<FSectionRow> rows;
+    };
+
+    template <typename TMode>
+    std::string GetModeLabel(const TMode& mode)
+    {
+        return mode.name;
+    }
+
+    std::string GetModeLabel(float arrivalRate)
+    {
+        char label[32];
+        snprintf(label, sizeof(label), "%.2f", arrivalRate);
+        return label;
+    }
+
+    template <typename TMode, typename FRun>
+    FSection MakeSection(const char* name, int labelWidth, const std::vector<TMode>& modes, FRun run)
+    {
+        FSection section;
+        section.name = name;
+        section.labelWidth = labelWidth;
+        for (const TMode& mode : modes)
+        {
+            section.labels.push_back(GetModeLabel(mode));
+        }
+        section.run = [modes, run](size_t row) { return run(modes[row]); };
+        return section;
+    }
+
+    template <typename TMode, typename FRun>
+    FSection MakeSection(const char* name, int labelWidth, const std::vector<FTeamConfig>& configs, const std::vector<TMode>& modes, FRun run)
+    {
+        FSection section;
+        section.name = name;
+        section.labelWidth = labelWidth;
+        for (const FTeamConfig& config : configs)
+        {
+            for (const TMode& mode : modes)
+            {
+                section.labels.push_back(GetModeLabel(mode));
+                section.configs.push_back(config.name);
+            }
+        }
+        section.run = [configs, modes, run](size_t row) { return run(modes[row % modes.size()], configs[row / modes.size()]); };
+        return section;
+    }
+
+    volatile float floatSink = 0.0f;
+    volatile int intSink = 0;
+}
+
+// Drives MatchMakingSystem's update phases directly (friend of MatchMakingSystem)
+class FMatchMakingBenchmark
+{
+public:
+    // Runs the full pipeline once: create -> join queue -> matchmake -> finish matches -> queries
+    static void RunPipeline(int64_t population, const FTeamConfig& config, bool bPopulationOnlyBenchmarks, std::vector<FBenchResult>& results)
+    {
+        SeedRandomGenerator(12345);
+        std::unique_ptr<MatchMakingSystem> system = std::make_unique<MatchMakingSystem>();
+
+        FMatchSetting setting = system->GetMatchSetting();
+        setting.numTeams = config.numTeams;
+        setting.teamSize = config.teamSize;
+        setting.matchesPerCycle = static_cast<int>(population); // drain the whole queue in one cycle
+        system->SetMatchSetting(setting);
+
+        FBenchResult create = Measure("CreatePlayer", config.name, population, [&]()
+        {
+            for (int64_t i = 0; i < population; ++i)
+            {
+                system->CreatePlayer();
+            }
+            return static_cast<uint64_t>(population);
+        });
+
+        // every idle timer has expired, so the whole population joins the queue in one call
+        simClock.Advance(std::chrono::seconds(10));
+        FBenchResult rejoin = Measure("Update_PlayerEvents (join queue)", config.name, population, [&]()
+        {
+            // joining schedules spillover, window and abandonment events of its own, so the joins are counted off the queue
+            const int before = system->GetNumQueuedPlayers();
+            system->Update_PlayerEvents();
+            return static_cast<uint64_t>(std::max(system->GetNumQueuedPlayers() - before, 0));
+        });
+
+        simClock.Advance(std::chrono::seconds(1));
+        results.push_back(Measure("Update_Matchmake (per match)", config.name, population, [&]()
+        {
+            system->Update_Matchmake(system->matchMakingSystemDelay);
+            return static_cast<uint64_t>(system->ongoingMatchIds.size());
+        }));
+
+        simClock.Advance(std::chrono::seconds(10));
+        results.push_back(Measure("Update_Matches (per match)", config.name, population, [&]()
+        {
+            size_t before = system->ongoingMatchIds.size();
+            system->Update_Matches();
+            return static_cast<uint64_t>(before - system->ongoingMatchIds.size());
+        }));
+
+        if (bPopulationOnlyBenchmarks)
+        {
+            results.push_back(create);
+            results.push_back(rejoin);
+            results.push_back(MeasureRepeated("GetTopPlayersByWinRate (per call)", config.name, population, [&]()
+            {
+                intSink = static_cast<int>(system->GetTopPlayersByWinRate().size());
+            }));
+            results.push_back(MeasureRepeated("GetAvgQueueTime (per call)", config.name, population, [&]()
+            {
+                floatSink = system->GetAvgQueueTime();
+            }));
+        }
+    }
+
+    // Queues {population} players grouped by the mix and drains the queue in one cycle. The first mix run sets {soloMatches},
+    // which the throughput of the later ones is relative to
+    static FSectionRow RunPartyMix(int64_t population, const FPartyMix& mix, int64_t& soloMatches, std::vector<FBenchResult>& results)
+    {
+        SeedRandomGenerator(12345);
+        std::unique_ptr<MatchMakingSystem> system = std::make_unique<MatchMakingSystem>();
+
+        FMatchSetting setting = system->GetMatchSetting();
+        setting.numTeams = 2;
+        setting.teamSize = 5;
+        setting.matchesPerCycle = static_cast<int>(population);
+        setting.bRegionSharding = false; // one queue without rating windows, so only the party mix differs
+        setting.formation = EMatchFormation::Fifo;
+        system->SetMatchSetting(setting);
+
+        FArrivalSetting arrival;
+        arrival.partySizeWeights = mix.weights;
+        for (int64_t i = 0; i < population; ++i)
+        {
+            system->CreatePlayer();
+        }
+        std::vector<int> memberIds;
+        for (int id = 0; id < system->GetNextPlayerId();)
+        {
+            int partySize = std::min(FArrivalProcess::SamplePartySize(arrival), system->GetNextPlayerId() - id);
+            memberIds.clear();
+            for (int i = 0; i < partySize; ++i)
+            {
+                memberIds.push_back(id++);
+            }
+            system->FormParty(memberIds);
+        }
+
+        simClock.Advance(std::chrono::seconds(10));
+        system->Update_PlayerEvents();
+        const int64_t queuedPlayers = system->numQueuedPlayers;
+        const int64_t queuedParties = system->numQueuedParties;
+
+        simClock.Advance(std::chrono::seconds(1));
+        FBenchResult formation = Measure("Update_Matchmake (party mix)", mix.name, population, [&]()
+        {
+            system->Update_Matchmake(system->matchMakingSystemDelay);
+            return static_cast<uint64_t>(system->ongoingMatchIds.size());
+        });
+        results.push_back(formation);
+
+        // matched: share of the queued players placed, the rest couldn't be packed into full teams
+        const int64_t matches = static_cast<int64_t>(formation.ops);
+        if (soloMatches == 0)
+        {
+            soloMatches = matches;
+        }
+        const double matched = queuedPlayers > 0 ? static_cast<double>(matches * 10) / static_cast<double>(queuedPlayers) : 0.0;
+        const double throughput = soloMatches > 0 ? static_cast<double>(matches) / static_cast<double>(soloMatches) : 0.0;
+        return {
+            {"Players", 12, queuedPlayers},
+            {"Parties", 12, queuedParties},
+            {"Matches", 10, matches},
+            {"Matched", 9, 1, matched * 100.0, "%"},
+            {"ns/match", 12, 1, formation.nsPerOp},
+            {"Throughput", 10, 1, throughput * 100.0, "%"},
+        };
+    }
+
+    // Runs {simSeconds} of Poisson arrivals into 5v5 matches and totals the per-region matchmaking stats
+    static FSectionRow RunRegionSharding(const FShardingMode& mode, float simSeconds)
+    {
+        std::unique_ptr<MatchMakingSystem> system = MakeLoadSystem([&mode](FMatchSetting& setting)
+        {
+            setting.bRegionSharding = mode.bRegionSharding;
+            setting.spilloverWait = mode.spilloverWait;
+        });
+        RunPoissonLoad(system.get(), simSeconds);
+
+        // latency: worst member latency to the hosting data center, cpu: total time spent in the region queues
+        FRegionTotals totals = SumRegionStats(*system);
+        return {
+            {"Matches", 10, totals.matches},
+            {"Spilled", 10, totals.spilledMatches},
+            {"Queue (s)", 12, 2, totals.avgQueueSeconds},
+            {"Latency", 10, 1, totals.avgLatencyMs, "ms"},
+            {"CPU (ms)", 10, 1, totals.cpuMs},
+        };
+    }
+
+    // Same load as RunRegionSharding under one formation and region policy pair
+    static FSectionRow RunPolicy(const FPolicyMode& mode, float simSeconds)
+    {
+        std::unique_ptr<MatchMakingSystem> system = MakeLoadSystem([&mode](FMatchSetting& setting)
+        {
+            setting.formation = mode.formation;
+            setting.bRegionSharding = mode.bRegionSharding;
+            setting.searchWindowGrowth = mode.searchWindowGrowth;
+        });
+        RunPoissonLoad(system.get(), simSeconds);
+
+        // range: highest minus lowest party rating of a match, style: play style distance of its parties from the first one
+        FRegionTotals totals = SumRegionStats(*system);
+        FMatchmakingStats stats = system->GetMatchmakingStats();
+        return {
+            {"Matches", 10, totals.matches},
+            {"Queue (s)", 12, 2, totals.avgQueueSeconds},
+            {"Latency", 10, 1, totals.avgLatencyMs, "ms"},
+            {"Range", 10, 1, stats.avgRatingRange},
+            {"Style", 10, 2, stats.avgStyleDistance},
+            {"CPU (ms)", 10, 1, totals.cpuMs},
+        };
+    }
+
+    // Same load as RunRegionSharding through role queues, every player declares their own roles. The team size follows the
+    // composition
+    static FSectionRow RunRoles(const FRoleMode& mode, float simSeconds)
+    {
+        std::unique_ptr<MatchMakingSystem> system = MakeLoadSystem([&mode](FMatchSetting& setting)
+        {
+            setting.formation = EMatchFormation::Roles;
+            setting.roleComposition = mode.composition;
+            setting.bRegionSharding = mode.bRegionSharding;
+        });
+        RunPoissonLoad(system.get(), simSeconds);
+
+        // starved: simulated seconds matchmaking waited on the role, misses: packs that stopped on a missing role
+        FRegionTotals totals = SumRegionStats(*system);
+        FMatchmakingStats stats = system->GetMatchmakingStats();
+        int64_t misses = 0;
+        for (int64_t roleMisses : stats.roleMisses)
+        {
+            misses += roleMisses;
+        }
+        return {
+            {"Matches", 10, totals.matches},
+            {"Queue (s)", 12, 2, totals.avgQueueSeconds},
+            {"Tank (s)", 10, 1, stats.roleStarvedSeconds[0]},
+            {"Supp (s)", 10, 1, stats.roleStarvedSeconds[1]},
+            {"Dmg (s)", 10, 1, stats.roleStarvedSeconds[2]},
+            {"Misses", 10, misses},
+            {"CPU (ms)", 10, 1, totals.cpuMs},
+        };
+    }
+
+    // A global queue under a load deep enough for batches to choose from, formed greedily or solved as a whole
+    static FSectionRow RunBatch(const FBatchMode& mode, const FTeamConfig& config, float simSeconds)
+    {
+        std::unique_ptr<MatchMakingSystem> system = MakeLoadSystem([&mode, &config](FMatchSetting& setting)
+        {
+            setting.numTeams = config.numTeams;
+            setting.teamSize = config.teamSize;
+            setting.bRegionSharding = false;
+            setting.formation = mode.formation;
+            setting.batchThreads = mode.batchThreads;
+            setting.batchBudgetMs = mode.batchBudgetMs;
+        });
+        RunPoissonLoad(system.get(), simSeconds, 10.0f);
+
+        // range: highest minus lowest party rating of a match, cut: blocks a solve left for the next batch, cpu: forming matches
+        // plus solving batches
+        FRegionTotals totals = SumRegionStats(*system);
+        FMatchmakingStats stats = system->GetMatchmakingStats();
+        return {
+            {"Matches", 10, totals.matches},
+            {"Queue (s)", 12, 2, totals.avgQueueSeconds},
+            {"Latency", 8, 1, totals.avgLatencyMs, "ms"},
+            {"Range", 10, 1, stats.avgRatingRange},
+            {"Cut", 8, stats.batchBlocksCut},
+            {"CPU (ms)", 10, 1, totals.cpuMs + stats.batchSolveMs},
+        };
+    }
+
+    // Same load as RunRegionSharding with players dropping out of their matches, which queued solo players may take over
+    static FSectionRow RunBackfill(const FBackfillMode& mode, float simSeconds)
+    {
+        std::unique_ptr<MatchMakingSystem> system = MakeLoadSystem([&mode](FMatchSetting& setting)
+        {
+            setting.bBackfill = mode.bBackfill;
+            setting.backfillGrace = mode.backfillGrace;
+        });
+        FArrivalSetting arrival = system->GetArrivalSetting();
+        arrival.disconnectRate = mode.disconnectRate;
+        system->SetArrivalSetting(arrival);
+        RunPoissonLoad(system.get(), simSeconds);
+
+        // queue: wait of the players placed into new matches, wait: seconds a slot stayed open, gap: rating of the player who left
+        // minus the one who took over
+        FRegionTotals totals = SumRegionStats(*system);
+        FMatchmakingStats stats = system->GetMatchmakingStats();
+        return {
+            {"Matches", 10, totals.matches},
+            {"Drops", 10, system->GetArrivalStats().disconnects},
+            {"Filled", 10, stats.backfills},
+            {"Expired", 10, stats.expiredSlots},
+            {"Queue (s)", 12, 2, totals.avgQueueSeconds},
+            {"Wait (s)", 10, 2, stats.avgBackfillWait},
+            {"Gap", 10, 1, stats.avgBackfillGap},
+            {"CPU (ms)", 10, 1, totals.cpuMs},
+        };
+    }
+
+    // Random players with derived play styles, streaks and party situations, dealt into {numMatches} 5v5 matches
+    static FSectionRow RunOutcomes(const FOutcomeMode& mode, int numMatches)
+    {
+        SeedRandomGenerator(12345);
+        constexpr int TeamSize = 5;
+        std::vector<FOutcomePlayer> players(static_cast<size_t>(numMatches) * 2 * TeamSize);
+        for (size_t i = 0; i < players.size(); ++i)
+        {
+            VirtualPlayer player(static_cast<int>(i));
+            players[i].rating = RandomNormal(1500.0f, 200.0f);
+            players[i].style = player.GetPlayStyle();
+            players[i].traits = player.GetTraits();
+            players[i].streak = RandomInt(-5, 5);
+            players[i].matchesPlayed = RandomInt(0, 100);
+            players[i].bInParty = GetRandomResult(0.3f);
+            players[i].bPartyLeader = players[i].bInParty && GetRandomResult(0.4f);
+        }
+
+        FOutcomeModel model;
+        FOutcomeBatch batch;
+        double favoriteChance = 0.0;
+        auto evaluateAll = [&]()
+        {
+            favoriteChance = 0.0;
+            for (int first = 0; first < numMatches; first += mode.batchSize)
+            {
+                const int last = std::min(first + mode.batchSize, numMatches);
+                batch.Clear();
+                for (int match = first; match < last; ++match)
+                {
+                    batch.BeginMatch();
+                    for (int team = 0; team < 2; ++team)
+                    {
+                        batch.BeginTeam();
+                        for (int slot = 0; slot < TeamSize; ++slot)
+                        {
+                            batch.AddPlayer(players[(static_cast<size_t>(match) * 2 + team) * TeamSize + slot]);
+                        }
+                    }
+                }
+                batch.Evaluate(model);
+                for (int match = 0; match < last - first; ++match)
+                {
+                    favoriteChance += std::max(batch.GetWinChance(match, 0), batch.GetWinChance(match, 1));
+                }
+            }
+            floatSink = static_cast<float>(favoriteChance);
+        };
+
+        FBenchResult measured = MeasureRepeated("Outcomes", mode.name, numMatches, evaluateAll, static_cast<uint64_t>(numMatches));
+
+        // favorite: the win chance the model gives the stronger team, on average
+        const double avgFavoriteChance = numMatches > 0 ? favoriteChance / static_cast<double>(numMatches) : 0.0;
+        return {
+            {"Matches", 10, static_cast<int64_t>(numMatches)},
+            {"ns/match", 12, 1, measured.nsPerOp},
+            {"allocs/match", 12, 3, measured.allocsPerOp},
+            {"Favorite", 9, 1, avgFavoriteChance * 100.0, "%"},
+        };
+    }
+
+    // {numMatches} 5v5 matches between teams of random strength and stats, played out to 7 rounds
+    static FSectionRow RunRounds(const FRoundMode& mode, int numMatches)
+    {
+        SeedRandomGenerator(12345);
+        constexpr int RoundsToWin = 7;
+        std::vector<uint64_t> seeds(static_cast<size_t>(numMatches));
+        std::vector<float> strengths(seeds.size() * 2);
+        std::vector<float> stats(seeds.size() * 5);
+        for (size_t match = 0; match < seeds.size(); ++match)
+        {
+            seeds[match] = rng.Next();
+            strengths[match * 2] = RandomNormal(1500.0f, 100.0f);
+            strengths[match * 2 + 1] = RandomNormal(1500.0f, 100.0f);
+            for (int stat = 0; stat < 5; ++stat)
+            {
+                stats[match * 5 + stat] = RandomFloat(-3.0f, 3.0f); // aggressiveness, then endurance and grit of each team
+            }
+        }
+
+        FRoundModel model;
+        FRoundBatch batch;
+        int64_t rounds = 0;
+        int64_t favoriteWins = 0;
+        auto playAll = [&]()
+        {
+            batch.Clear();
+            for (size_t match = 0; match < seeds.size(); ++match)
+            {
+                batch.AddMatch(seeds[match], 1.0f, stats[match * 5]);
+                batch.AddTeam(strengths[match * 2], stats[match * 5 + 1], stats[match * 5 + 2]);
+                batch.AddTeam(strengths[match * 2 + 1], stats[match * 5 + 3], stats[match * 5 + 4]);
+            }
+            batch.Simulate(model, RoundsToWin, mode.numThreads);
+            rounds = 0;
+            favoriteWins = 0;
+            for (int match = 0; match < numMatches; ++match)
+            {
+                rounds += batch.GetRounds(match);
+                favoriteWins += batch.GetWinner(match) == (strengths[match * 2] >= strengths[match * 2 + 1] ? 0 : 1) ? 1 : 0;
+            }
+            intSink = static_cast<int>(rounds);
+        };
+
+        FBenchResult measured = MeasureRepeated("Rounds", mode.name, numMatches, playAll, static_cast<uint64_t>(numMatches));
+
+        // threads only change the time, every mode plays the same rounds
+        const double avgRounds = numMatches > 0 ? static_cast<double>(rounds) / static_cast<double>(numMatches) : 0.0;
+        const double favoriteWinRate = numMatches > 0 ? static_cast<double>(favoriteWins) / static_cast<double>(numMatches) : 0.0;
+        return {
+            {"Matches", 10, static_cast<int64_t>(numMatches)},
+            {"ns/match", 12, 1, measured.nsPerOp},
+            {"allocs/match", 12, 3, measured.allocsPerOp},
+            {"Rounds", 10, 2, avgRounds},
+            {"Favorite", 9, 1, favoriteWinRate * 100.0, "%"},
+        };
+    }
+
+    // {numPlayers} players with a hidden skill play 2v2v2v2 matches in {NumPasses} passes, every pass rated as one batch
+    static FSectionRow RunRatings(const FRatingMode& mode, int numPlayers)
+    {
+        SeedRandomGenerator(12345);
+        constexpr int NumPasses = 30;
+        constexpr int NumTeams = 4;
+        constexpr int TeamSize = 2;
+        constexpr int MatchSize = NumTeams * TeamSize;
+        constexpr int PassesPerPeriod = 5;
+        const int matchesPerPass = numPlayers / MatchSize;
+        std::vector<float> skills(static_cast<size_t>(numPlayers));
+        for (float& skill : skills)
+        {
+            skill = RandomNormal(1500.0f, 200.0f);
+        }
+        // every pass seats the players at random, the team that performs best wins
+        std::vector<int> seats(static_cast<size_t>(NumPasses * matchesPerPass * MatchSize));
+        std::vector<int> winners(static_cast<size_t>(NumPasses * matchesPerPass));
+        std::vector<int> order(skills.size());
+        for (int pass = 0; pass < NumPasses; ++pass)
+        {
+            for (int player = 0; player < numPlayers; ++player)
+            {
+                order[player] = player;
+            }
+            for (int player = numPlayers - 1; player > 0; --player)
+            {
+                std::swap(order[player], order[RandomInt(0, player)]);
+            }
+            for (int match = 0; match < matchesPerPass; ++match)
+            {
+                const int first = (pass * matchesPerPass + match) * MatchSize;
+                float best = 0.0f;
+                for (int team = 0; team < NumTeams; ++team)
+                {
+                    float performance = 0.0f;
+                    for (int slot = 0; slot < TeamSize; ++slot)
+                    {
+                        const int player = order[match * MatchSize + team * TeamSize + slot];
+                        seats[first + team * TeamSize + slot] = player;
+                        performance += RandomNormal(skills[player], 150.0f);
+                    }
+                    if (team == 0 || performance > best)
+                    {
+                        best = performance;
+                        winners[pass * matchesPerPass + match] = team;
+                    }
+                }
+            }
+        }
+
+        FRatingModel model;
+        FRatingTable table;
+        FRatingBatch batch;
+        std::vector<float> ratings(skills.size());
+        for (int player = 0; player < numPlayers; ++player)
+        {
+            table.AddPlayer(model);
+        }
+        auto rateAll = [&]()
+        {
+            for (int player = 0; player < numPlayers; ++player)
+            {
+                table.SetPlayer(player, model.initialDeviation, model.initialVolatility);
+            }
+            std::fill(ratings.begin(), ratings.end(), 1500.0f);
+            for (int pass = 0; pass < NumPasses; ++pass)
+            {
+                batch.Clear();
+                for (int match = 0; match < matchesPerPass; ++match)
+                {
+                    const int first = (pass * matchesPerPass + match) * MatchSize;
+                    batch.BeginMatch(winners[pass * matchesPerPass + match]);
+                    for (int seat = 0; seat < MatchSize; ++seat)
+                    {
+                        if (seat % TeamSize == 0)
+                        {
+                            batch.BeginTeam();
+                        }
+                        const int player = seats[first + seat];
+                        batch.AddPlayer(player, ratings[player], table.GetDeviation(player), table.GetVolatility(player), true);
+                    }
+                }
+                batch.Update(mode.system, model, mode.numThreads);
+                for (int i = 0; i < batch.NumPlayers(); ++i)
+                {
+                    const int player = batch.GetPlayerId(i);
+                    ratings[player] += batch.GetRatingChange(i);
+                    table.SetPlayer(player, batch.GetDeviation(i), batch.GetVolatility(i));
+                }
+                if (pass % PassesPerPeriod == PassesPerPeriod - 1)
+                {
+                    floatSink = table.Sweep(mode.system, model);
+                }
+            }
+        };
+
+        const int numMatches = NumPasses * matchesPerPass;
+        FBenchResult measured = MeasureRepeated("Ratings", mode.name, numMatches, rateAll, static_cast<uint64_t>(numMatches));
+
+        // Pearson correlation of the final ratings with the hidden skills
+        double skillMean = 0.0;
+        double ratingMean = 0.0;
+        for (int player = 0; player < numPlayers; ++player)
+        {
+            skillMean += skills[player];
+            ratingMean += ratings[player];
+        }
+        skillMean /= numPlayers;
+        ratingMean /= numPlayers;
+        double covariance = 0.0;
+        double skillVariance = 0.0;
+        double ratingVariance = 0.0;
+        for (int player = 0; player < numPlayers; ++player)
+        {
+            covariance += (skills[player] - skillMean) * (ratings[player] - ratingMean);
+            skillVariance += (skills[player] - skillMean) * (skills[player] - skillMean);
+            ratingVariance += (ratings[player] - ratingMean) * (ratings[player] - ratingMean);
+        }
+
+        // skill: correlation of the ratings with the players' hidden skill after every match was rated
+        const double skillCorrelation = skillVariance > 0.0 && ratingVariance > 0.0 ? covariance / std::sqrt(skillVariance * ratingVariance) : 0.0;
+        return {
+            {"Matches", 10, static_cast<int64_t>(numMatches)},
+            {"ns/match", 12, 1, measured.nsPerOp},
+            {"allocs/match", 12, 3, measured.allocsPerOp},
+            {"Skill", 10, 3, skillCorrelation},
+        };
+    }
+
+    // 5v5 under the outcome model, whose traits and stats the predictor can learn on top of ratings
+    static FSectionRow RunPredictor(const FPredictorMode& mode, float simSeconds)
+    {
+        std::unique_ptr<MatchMakingSystem> system = MakeLoadSystem([&mode](FMatchSetting& setting)
+        {
+            setting.bWinPredictor = mode.bWinPredictor;
+            setting.predictorLearningRate = mode.learningRate;
+            setting.bBalanceByPrediction = mode.bBalanceByPrediction;
+        });
+        auto start = std::chrono::steady_clock::now();
+        RunPoissonLoad(system.get(), simSeconds, 20.0f);
+
+        const double updateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // log loss and accuracy over the last results, favorite: the chance the likelier team was given as its match formed
+        FMatchmakingStats stats = system->GetMatchmakingStats();
+        return {
+            {"Matches", 10, SumRegionStats(*system).matches},
+            {"Update (ms)", 12, 1, updateMs},
+            {"Log loss", 10, 3, stats.predictorLogLoss},
+            {"Accuracy", 9, 1, stats.predictorAccuracy * 100.0, "%"},
+            {"Favorite", 9, 1, stats.avgPredictedFavorite * 100.0, "%"},
+        };
+    }
+
+    // A pool small enough that the same players keep meeting, avoidance trades those rematches for queue time
+    static FSectionRow RunRematch(const FRematchMode& mode, float simSeconds)
+    {
+        std::unique_ptr<MatchMakingSystem> system = MakeLoadSystem([&mode](FMatchSetting& setting)
+        {
+            setting.bRegionSharding = false;
+            setting.formation = EMatchFormation::Fifo;
+            setting.bAvoidRematches = mode.bAvoidRematches;
+            setting.rematchGraceSeconds = mode.graceSeconds;
+        });
+        RunPoissonLoad(system.get(), simSeconds);
+
+        // rematches: matches with two opponents who recently played each other, passed over: parties skipped while packing
+        FRegionTotals totals = SumRegionStats(*system);
+        FMatchmakingStats stats = system->GetMatchmakingStats();
+        const double rematchShare = totals.matches > 0 ? static_cast<double>(stats.rematchMatches) / static_cast<double>(totals.matches) : 0.0;
+        return {
+            {"Matches", 10, totals.matches},
+            {"Rematches", 9, 1, rematchShare * 100.0, "%"},
+            {"Passed over", 12, stats.rematchRejections},
+            {"Fallbacks", 10, stats.rematchFallbacks},
+            {"Queue (s)", 10, 1, totals.avgQueueSeconds},
+            {"CPU (ms)", 10, 1, totals.cpuMs},
+        };
+    }
+
+    // Default regions and patience, the load decides how long parties wait and so how many run out of patience first
+    static FSectionRow RunAbandonment(float arrivalRate, float simSeconds)
+    {
+        std::unique_ptr<MatchMakingSystem> system = MakeLoadSystem([](FMatchSetting&) {});
+        FArrivalSetting arrival = system->GetArrivalSetting();
+        arrival.bQueueAbandonment = true;
+        system->SetArrivalSetting(arrival);
+        RunPoissonLoad(system.get(), simSeconds, arrivalRate);
+
+        // abandoned: share of the parties that left the queue without a match, SLO: share that waited past it or abandoned
+        FRegionTotals totals = SumRegionStats(*system);
+        FArrivalStats arrivals = system->GetArrivalStats();
+        const int64_t parties = totals.matchedParties + arrivals.abandonments;
+        const double abandonedShare = parties > 0 ? static_cast<double>(arrivals.abandonments) / static_cast<double>(parties) : 0.0;
+        return {
+            {"Matches", 10, totals.matches},
+            {"Abandoned", 9, 1, abandonedShare * 100.0, "%"},
+            {"Abandon (s)", 12, 1, arrivals.avgAbandonSeconds},
+            {"Queue (s)", 10, 1, totals.avgQueueSeconds},
+            {"SLO breach", 11, 1, system->GetMatchmakingStats().sloBreachRate * 100.0, "%"},
+            {"Parties", 10, parties},
+        };
+    }
+
+private:
+    // Matchmaking summed over every data center, a global queue charges its waits and latencies to the hosting one
+    struct FRegionTotals
+    {
+        int64_t matches = 0;
+        int64_t spilledMatches = 0;
+        int64_t matchedParties = 0;
+        double cpuMs = 0.0;
+        double avgQueueSeconds = 0.0;   // over the matched parties
+        double avgLatencyMs = 0.0;      // over the matches
+    };
+
+    // A freshly seeded system forming 5v5 matches with adaptive scheduling, {tweak} edits the settings before they apply
+    template <typename FTweak>
+    static std::unique_ptr<MatchMakingSystem> MakeLoadSystem(FTweak&& tweak)
+    {
+        SeedRandomGenerator(12345);
+        std::unique_ptr<MatchMakingSystem> system = std::make_unique<MatchMakingSystem>();
+
+        FMatchSetting setting = system->GetMatchSetting();
+        setting.numTeams = 2;
+        setting.teamSize = 5;
+        setting.bAdaptiveScheduling = true;
+        tweak(setting);
+        system->SetMatchSetting(setting);
+        return system;
+    }
+
+    static FRegionTotals SumRegionStats(const MatchMakingSystem& system)
+    {
+        FRegionTotals totals;
+        double waitTotal = 0.0;
+        double latencyTotal = 0.0;
+        for (int region = 0; region < NumRegions; ++region)
+        {
+            FRegionStats stats = system.GetRegionStats(region);
+            totals.matches += stats.matches;
+            totals.spilledMatches += stats.spilledMatches;
+            totals.cpuMs += stats.cpuMs;
+            waitTotal += system.regionWaitTotals[region];
+            latencyTotal += system.regionLatencyTotals[region];
+            totals.matchedParties += system.regionMatchedParties[region];
+        }
+        totals.avgQueueSeconds = totals.matchedParties > 0 ? waitTotal / static_cast<double>(totals.matchedParties) : 0.0;
+        totals.avgLatencyMs = totals.matches > 0 ? latencyTotal / static_cast<double>(totals.matches) : 0.0;
+        return totals;
+    }
+
+    // {simSeconds} of Poisson arrivals thin enough that a queue waits for its ten players
+    static void RunPoissonLoad(MatchMakingSystem* system, float simSeconds, float arrivalRate = 1.0f)
+    {
+        FArrivalSetting arrival = system->GetArrivalSetting();
+        arrival.process = EArrivalProcess::Poisson;
+        arrival.arrivalRate = arrivalRate;
+        arrival.meanSessionLength = 120.0f;
+        system->SetArrivalSetting(arrival);
+
+        for (float time = 0.0f; time < simSeconds; time += 0.05f)
+        {
+            simClock.Advance(std::chrono::milliseconds(50));
+            system->Update();
+        }
+    }
+};
+
+void RunRandomBenchmarks(std::vector<FBenchResult>& results)
+{
+    SeedRandomGenerator(12345);
+    results.push_back(MeasureRepeated("RandomInt", "-", 0, []() { intSink = RandomInt(0, 100); }));
+    results.push_back(MeasureRepeated("RandomFloat", "-", 0, []() { floatSink = RandomFloat(); }));
+    results.push_back(MeasureRepeated("RandomFloat(min, max)", "-", 0, []() { floatSink = RandomFloat(1.0f, 5.0f); }));
+    results.push_back(MeasureRepeated("RandomFloatWithAnchor", "-", 0, []() { floatSink = RandomFloatWithAnchor(2.0f, 1.4f); }));
+    results.push_back(MeasureRepeated("GetRandomResult", "-", 0, []() { intSink = GetRandomResult(0.5f); }));
+    results.push_back(MeasureRepeated("GetRandomResult_IntPercentage", "-", 0, []() { intSink = GetRandomResult_IntPercentage(35); }));
+}
+
+// Records trace scopes on short-lived threads, once on bare threads and once on the round workers that every batch starts anew.
+// Returns false when the trace buffers grew with the threads started instead of staying at the most threads alive at once
+bool CheckTraceBuffers()
+{
+    constexpr int NumRepeats = 256;
+    const bool bWasEnabled = IsTraceEnabled();
+    SetTraceEnabled(true);
+
+    FRoundModel model;
+    FRoundBatch batch;
+    for (int match = 0; match < 256; ++match)
+    {
+        batch.AddMatch(static_cast<uint64_t>(match), 1.0f, 0.0f);
+        batch.AddTeam(1500.0f, 0.0f, 0.0f);
+        batch.AddTeam(1500.0f, 0.0f, 0.0f);
+    }
+
+    // warm up, the first threads allocate the buffers the later ones take over
+    std::thread([]() { MM_TRACE_SCOPE("TraceThread"); }).join();
+    batch.Simulate(model, 7, 4);
+    const size_t numBuffers = GetNumTraceBuffers();
+    for (int i = 0; i < NumRepeats; ++i)
+    {
+        std::thread([]() { MM_TRACE_SCOPE("TraceThread"); }).join();
+        batch.Simulate(model, 7, 4);
+    }
+    const bool bFlat = GetNumTraceBuffers() == numBuffers;
+    printf("Trace buffers after %d short-lived threads: %zu -> %zu\n", NumRepeats * 4, numBuffers, GetNumTraceBuffers());
+
+    ClearTrace();
+    SetTraceEnabled(bWasEnabled);
+    return bFlat;
+}
+
+// Balances the same matches of solo players rated around 1500 with the mode, every mode of a config gets the same matches
+FSectionRow RunBalancing(const FBalancingMode& mode, const FTeamConfig& config, std::vector<FBenchResult>& results)
+{
+    constexpr int NumMatches = 20000;
+    SeedRandomGenerator(777);
+    std::vector<std::vector<std::vector<FBalanceUnit>>> matches(NumMatches);
+    int nextId = 0;
+    for (std::vector<std::vector<FBalanceUnit>>& teams : matches)
+    {
+        teams.resize(config.numTeams);
+        for (std::vector<FBalanceUnit>& team : teams)
+        {
+            for (int i = 0; i < config.teamSize; ++i)
+            {
+                FBalanceUnit unit;
+                unit.leaderId = nextId++;
+                unit.rating = RandomNormal(1500.0f, 300.0f);
+                team.push_back(unit);
+            }
+        }
+    }
+
+    FTeamBalancer balancer;
+    std::string name = std::string("BalanceTeams ") + mode.name;
+    results.push_back(Measure(name.c_str(), config.name, NumMatches, [&]()
+    {
+        for (std::vector<std::vector<FBalanceUnit>>& teams : matches)
+        {
+            balancer.Balance(mode.mode, mode.bLocalSearch, teams);
+        }
+        return static_cast<uint64_t>(NumMatches);
+    }));
+
+    // spread: rating difference between the strongest and weakest team, averaged over the matches
+    double spread = 0.0;
+    for (const std::vector<std::vector<FBalanceUnit>>& teams : matches)
+    {
+        spread += FTeamBalancer::GetSpread(teams) / static_cast<double>(NumMatches);
+    }
+    return {
+        {"Spread", 12, 1, spread},
+        {"ns/match", 12, 1, results.back().nsPerOp},
+    };
+}
+
+void RunSection(FSection& section)
+{
+    for (size_t row = 0; row < section.labels.size(); ++row)
+    {
+        if (section.configs.empty())
+        {
+            printf("Running %s %s...\n", section.name, section.labels[row].c_str());
+        }
+        else
+        {
+            printf("Running %s %s, %s...\n", section.name, section.labels[row].c_str(), section.configs[row].c_str());
+        }
+        fflush(stdout);
+        section.rows.push_back(section.run(row));
+    }
+}
+
+void PrintSection(const FSection& section)
+{
+    if (section.rows.empty())
+    {
+        return;
+    }
+
+    printf("\n%-*s", section.labelWidth, section.name);
+    if (!section.configs.empty())
+    {
+        printf(" %-6s", "Config");
+    }
+    for (const FCell& cell : section.rows[0])
+    {
+        printf(" %*s", cell.width + static_cast<int>(strlen(cell.unit)), cell.title);
+    }
+    printf("\n");
+
+    for (size_t row = 0; row < section.rows.size(); ++row)
+    {
+        printf("%-*s", section.labelWidth, section.labels[row].c_str());
+        if (!section.configs.empty())
+        {
+            printf(" %-6s", section.configs[row].c_str());
+        }
+        for (const FCell& cell : section.rows[row])
+        {
+            printf(" %*.*f%s", cell.width, cell.precision, cell.value, cell.unit);
+        }
+        printf("\n");
+    }
+}
+
+void PrintResults(const std::vector<FBenchResult>& results)
+{
+    // scaling: ns/op relative to the smallest population of the same benchmark and config.
+    // ~1.0 means the per-op cost is flat, growing values show super-linear total cost
+    std::map<std::string, double> baseline;
+    std::string lastName;
+
+    printf("\n%-36s %-6s %12s %12s %14s %12s %9s\n", "Benchmark", "Config", "Population", "Ops", "ns/op", "allocs/op", "Scaling");
+    for (const FBenchResult& result : results)
+    {
+        if (result.name != lastName)
+        {
+            printf("\n");
+            lastName = result.name;
+        }
+
+        std::string key = result.name + "|" + result.config;
+        auto it = baseline.find(key);
+        if (it == baseline.end())
+        {
+            it = baseline.emplace(key, result.nsPerOp).first;
+        }
+        double scaling = it->second > 0.0 ? result.nsPerOp / it->second : 0.0;
+
+        printf("%-36s %-6s %12lld %12llu %14.1f %12.2f %8.2fx\n", result.name.c_str(), result.config.c_str(),
+            static_cast<long long>(result.population), static_cast<unsigned long long>(result.ops), result.nsPerOp, result.allocsPerOp, scaling);
+    }
+}
+
+// The benchmark table, then every section as a table of its own below a blank line
+bool WriteCsv(const std::string& path, const std::vector<FBenchResult>& results, const std::vector<FSection>& sections)
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file)
+    {
+        return false;
+    }
+    fprintf(file, "benchmark,config,population,ops,ns_per_op,allocs_per_op\n");
+    for (const FBenchResult& result : results)
+    {
+        fprintf(file, "\"%s\",%s,%lld,%llu,%.3f,%.3f\n", result.name.c_str(), result.config.c_str(),
+            static_cast<long long>(result.population), static_cast<unsigned long long>(result.ops), result.nsPerOp, result.allocsPerOp);
+    }
+
+    for (const FSection& section : sections)
+    {
+        if (section.rows.empty())
+        {
+            continue;
+        }
+        fprintf(file, "\n\"%s\"", section.name);
+        if (!section.configs.empty())
+        {
+            fprintf(file, ",config");
+        }
+        for (const FCell& cell : section.rows[0])
+        {
+            fprintf(file, *cell.unit ? ",\"%s (%s)\"" : ",\"%s\"", cell.title, cell.unit);
+        }
+        fprintf(file, "\n");
+        for (size_t row = 0; row < section.rows.size(); ++row)
+        {
+            fprintf(file, "\"%s\"", section.labels[row].c_str());
+            if (!section.configs.empty())
+            {
+                fprintf(file, ",%s", section.configs[row].c_str());
+            }
+            for (const FCell& cell : section.rows[row])
+            {
+                fprintf(file, ",%.*f", cell.precision > 0 ? 3 : 0, cell.value);
+            }
+            fprintf(file, "\n");
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    int64_t maxPopulation = 10000000;
+    std::string csvPath;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--max-population") == 0 && i + 1 < argc)
+        {
+            maxPopulation = strtoll(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+        {
+            csvPath = argv[++i];
+        }
+    }
+
+    // the simulation clock is driven by the benchmark, so timers expire exactly when needed
+    simClock.SetManual(true);
+
+    if (!CheckTraceBuffers())
+    {
+        printf("Trace buffers grew with the threads started\n");
+        return 1;
+    }
+
+    std::vector<FBenchResult> results;
+    RunRandomBenchmarks(results);
+
+    // the balancing rows join the benchmark table ahead of the pipeline
+    std::vector<FSection> sections;
+    sections.push_back(MakeSection("Balancing", 10, TeamConfigs, BalancingModes, [&results](const FBalancingMode& mode, const FTeamConfig& config)
+    {
+        return RunBalancing(mode, config, results);
+    }));
+    RunSection(sections.back());
+
+    std::vector<FBenchResult> pipelineResults;
+    for (int64_t population = 1000; population <= maxPopulation; population *= 10)
+    {
+        for (size_t c = 0; c < TeamConfigs.size(); ++c)
+        {
+            printf("Running population %lld, %s...\n", static_cast<long long>(population), TeamConfigs[c].name);
+            fflush(stdout);
+            FMatchMakingBenchmark::RunPipeline(population, TeamConfigs[c], c == 0, pipelineResults);
+        }
+    }
+
+    // group rows by benchmark and config so each scaling curve reads top to bottom
+    std::vector<std::string> order;
+    for (const FBenchResult& result : pipelineResults)
+    {
+        if (std::find(order.begin(), order.end(), result.name) == order.end())
+        {
+            order.push_back(result.name);
+        }
+    }
+    for (const std::string& name : order)
+    {
+        for (const FTeamConfig& config : TeamConfigs)
+        {
+            for (const FBenchResult& result : pipelineResults)
+            {
+                if (result.name == name && result.config == config.name)
+                {
+                    results.push_back(result);
+                }
+            }
+        }
+    }
+
+    const size_t firstSection = sections.size();
+    const int64_t mixPopulation = std::min<int64_t>(100000, maxPopulation);
+    int64_t soloMatches = 0;
+    sections.push_back(MakeSection("Mix", 8, PartyMixes, [&](const FPartyMix& mix)
+    {
+        return FMatchMakingBenchmark::RunPartyMix(mixPopulation, mix, soloMatches, results);
+    }));
+    sections.push_back(MakeSection("Sharding", 10, ShardingModes, [](const FShardingMode& mode)
+    {
+        return FMatchMakingBenchmark::RunRegionSharding(mode, 600.0f);
+    }));
+    sections.push_back(MakeSection("Policy", 13, PolicyModes, [](const FPolicyMode& mode)
+    {
+        return FMatchMakingBenchmark::RunPolicy(mode, 600.0f);
+    }));
+    sections.push_back(MakeSection("Roles", 12, RoleModes, [](const FRoleMode& mode)
+    {
+        return FMatchMakingBenchmark::RunRoles(mode, 600.0f);
+    }));
+    sections.push_back(MakeSection("Batch", 14, { TeamConfigs[0], TeamConfigs[3] }, BatchModes, [](const FBatchMode& mode, const FTeamConfig& config)
+    {
+        return FMatchMakingBenchmark::RunBatch(mode, config, 300.0f);
+    }));
+    sections.push_back(MakeSection("Backfill", 11, BackfillModes, [](const FBackfillMode& mode)
+    {
+        return FMatchMakingBenchmark::RunBackfill(mode, 600.0f);
+    }));
+    sections.push_back(MakeSection("Outcomes", 10, OutcomeModes, [](const FOutcomeMode& mode)
+    {
+        return FMatchMakingBenchmark::RunOutcomes(mode, 4096);
+    }));
+    sections.push_back(MakeSection("Rounds", 10, RoundModes, [](const FRoundMode& mode)
+    {
+        return FMatchMakingBenchmark::RunRounds(mode, 8192);
+    }));
+    sections.push_back(MakeSection("Predictor", 10, PredictorModes, [](const FPredictorMode& mode)
+    {
+        return FMatchMakingBenchmark::RunPredictor(mode, 600.0f);
+    }));
+    sections.push_back(MakeSection("Ratings", 12, RatingModes, [](const FRatingMode& mode)
+    {
+        return FMatchMakingBenchmark::RunRatings(mode, 4096);
+    }));
+    sections.push_back(MakeSection("Rematch", 10, RematchModes, [](const FRematchMode& mode)
+    {
+        return FMatchMakingBenchmark::RunRematch(mode, 1200.0f);
+    }));
+    sections.push_back(MakeSection("Arrivals/s", 12, AbandonmentRates, [](float arrivalRate)
+    {
+        return FMatchMakingBenchmark::RunAbandonment(arrivalRate, 900.0f);
+    }));
+    for (size_t section = firstSection; section < sections.size(); ++section)
+    {
+        RunSection(sections[section]);
+    }
+
+    PrintResults(results);
+    for (const FSection& section : sections)
+    {
+        PrintSection(section);
+    }
+    if (!csvPath.empty() && !WriteCsv(csvPath, results, sections))
+    {
+        printf("Failed to write %s\n", csvPath.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -1,10 +1,17 @@
 #pragma comment(lib, "d3d11.lib")
 
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 #include "D3DHelper.h"
 #include "UIConstructor.h"
 #include "MatchMaking/MatchMakingSystem.h"
 #include "MatchMaking/RandomGenerator.h"
+#include "MatchMaking/Profiler.h"
+#include "MatchMaking/ReplayRecorder.h"
+#include "MatchMaking/TraceRecorder.h"
 
 // Data
 namespace
@@ -15,10 +22,58 @@ namespace
 
 LRESULT WINAPI WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 MatchMakingSystem* mmSystem;
+FReplayRecorder* replayRecorder = nullptr;
+
+// Runs a recorded replay headless and prints whether it reproduced the original run
+int RunReplayMode(const std::string& path)
+{
+    FReplayReport report = RunReplay(path);
+    if (!report.bLoaded)
+    {
+        printf("Failed to load replay %s\n", path.c_str());
+        return 1;
+    }
+
+    printf("Replayed %zu events (%zu ticks, %.1fs simulated) in %.3fs\n", report.numEvents, report.numTicks, report.simulatedSeconds, report.wallSeconds);
+    if (report.bIdentical)
+    {
+        printf("Replay is identical, state hash %llu\n", static_cast<unsigned long long>(report.replayedHash));
+        return 0;
+    }
+
+    printf("Replay diverged at decision %zu: %s\n", report.firstMismatch, report.mismatchDetail.c_str());
+    printf("State hash recorded %llu, replayed %llu\n", static_cast<unsigned long long>(report.recordedHash), static_cast<unsigned long long>(report.replayedHash));
+    return 2;
+}
 
 // Main code
-int main(int, char**)
+// Usage: MMSimulator [--seed <n>] [--record <file>] [--trace <file>] | [--replay <file>]
+int main(int argc, char** argv)
 {
+    uint64_t seed = std::chrono::steady_clock::now().time_since_epoch().count(); // random seed unless given
+    std::string recordPath;
+    std::string tracePath;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            recordPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            tracePath = argv[++i];
+            SetTraceEnabled(true);
+        }
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            return RunReplayMode(argv[++i]);
+        }
+    }
+
     // Create application window
     WNDCLASSEXW wc = { sizeof(wc), CS_CLASSDC, WndProc, 0L, 0L, GetModuleHandle(nullptr), nullptr, nullptr, nullptr, nullptr, L"MMSim", nullptr };
     ::RegisterClassExW(&wc);
@@ -37,10 +92,14 @@ int main(int, char**)
     ::UpdateWindow(hwnd);
 
     // Initialize main systems: MMSIM, ImGui & RNG
-    uint64_t seed = std::chrono::steady_clock::now().time_since_epoch().count(); // random seed, FIXME: support seed input later
     SeedRandomGenerator(seed);
     InitImGui(hwnd, g_pd3dDevice, g_pd3dDeviceContext);
     mmSystem = new MatchMakingSystem;
+    if (!recordPath.empty())
+    {
+        replayRecorder = new FReplayRecorder;
+        mmSystem->SetReplayRecorder(replayRecorder);
+    }
     
     // Main loop
     bool done = false;
@@ -79,6 +138,28 @@ int main(int, char**)
         
         // Render UI by ImGui
         RenderUI(mmSystem);
+
+        EndProfilerFrame();
+    }
+
+    // Finish the replay with the final state so a replay can verify it. Loading a checkpoint stopped the recording, the inputs
+    // recorded before it can't reproduce the loaded state
+    if (replayRecorder && mmSystem->GetReplayRecorder() != replayRecorder)
+    {
+        printf("Replay %s not saved: recording stopped when a checkpoint was loaded\n", recordPath.c_str());
+    }
+    else if (replayRecorder)
+    {
+        replayRecorder->End(mmSystem->ComputeStateHash());
+        if (!replayRecorder->SaveToFile(recordPath))
+        {
+            printf("Failed to save replay %s\n", recordPath.c_str());
+        }
+    }
+
+    if (!tracePath.empty() && !DumpChromeTrace(tracePath))
+    {
+        printf("Failed to write trace %s\n", tracePath.c_str());
     }
 
     // Cleanup
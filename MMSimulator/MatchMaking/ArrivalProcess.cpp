@@ -0,0 +1,172 @@
+#include "ArrivalProcess.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "BinaryArchive.h"
+#include "RandomGenerator.h"
+
+void FArrivalSetting::Serialize(FBinaryArchive& Ar)
+{
+    Ar << process << arrivalRate << dayLength << diurnalCurve << bursts;
+    Ar << meanSessionLength << sessionLengthSpread << returningPlayerRatio << partySizeWeights << regionWeights;
+    Ar << disconnectRate << reconnectChance << meanReconnectDelay << reconnectWindow << reconnectLoadTime;
+    Ar << bQueueAbandonment << casualPatience << competitivePatience << patienceSpread;
+}
+
+void FArrivalProcess::Restart(const FArrivalSetting& setting, std::chrono::steady_clock::time_point now, bool bResetEpoch)
+{
+    if (bResetEpoch || !bActive)
+    {
+        epoch = now;
+    }
+    bActive = setting.process != EArrivalProcess::None;
+    candidateTime = now;
+    if (bActive)
+    {
+        DrawNextCandidate(setting);
+    }
+}
+
+bool FArrivalProcess::AcceptCandidate(const FArrivalSetting& setting)
+{
+    float bound = GetRateBound(setting, candidateTime);
+    bool bAccepted = bound > 0.0f && RandomFloat() * bound < GetRate(setting, candidateTime);
+    DrawNextCandidate(setting);
+    return bAccepted;
+}
+
+float FArrivalProcess::GetRate(const FArrivalSetting& setting, std::chrono::steady_clock::time_point time) const
+{
+    float rate = 0.0f;
+    switch (setting.process)
+    {
+    case EArrivalProcess::None:
+        return 0.0f;
+    case EArrivalProcess::Poisson:
+        rate = setting.arrivalRate;
+        break;
+    case EArrivalProcess::Diurnal:
+        if (!setting.diurnalCurve.empty())
+        {
+            size_t segment = static_cast<size_t>(GetTimeOfDay(setting, time) * static_cast<float>(setting.diurnalCurve.size()));
+            rate = setting.arrivalRate * setting.diurnalCurve[std::min(segment, setting.diurnalCurve.size() - 1)];
+        }
+        break;
+    }
+
+    float elapsed = GetElapsedSeconds(time);
+    for (const FArrivalBurst& burst : setting.bursts)
+    {
+        if (elapsed >= burst.startTime && elapsed < burst.startTime + burst.duration)
+        {
+            rate += burst.rate;
+        }
+    }
+    return std::max(rate, 0.0f);
+}
+
+float FArrivalProcess::GetElapsedSeconds(std::chrono::steady_clock::time_point time) const
+{
+    return std::chrono::duration<float>(time - epoch).count();
+}
+
+float FArrivalProcess::GetTimeOfDay(const FArrivalSetting& setting, std::chrono::steady_clock::time_point time) const
+{
+    if (setting.dayLength <= 0.0f)
+    {
+        return 0.0f;
+    }
+    float dayTime = std::fmod(GetElapsedSeconds(time), setting.dayLength);
+    return std::clamp(dayTime / setting.dayLength, 0.0f, 1.0f);
+}
+
+float FArrivalProcess::SampleSessionLength(const FArrivalSetting& setting)
+{
+    if (setting.sessionLengthSpread <= 0.0f)
+    {
+        return setting.meanSessionLength;
+    }
+    // log-normal with the configured mean: mu = ln(mean) - sigma^2 / 2
+    float sigma = setting.sessionLengthSpread;
+    float mu = std::log(std::max(setting.meanSessionLength, 0.001f)) - 0.5f * sigma * sigma;
+    return std::exp(RandomNormal(mu, sigma));
+}
+
+int FArrivalProcess::SamplePartySize(const FArrivalSetting& setting)
+{
+    // solo-only settings don't draw, so they consume the same random numbers as before parties existed
+    if (setting.partySizeWeights.size() <= 1)
+    {
+        return 1;
+    }
+    float total = 0.0f;
+    for (float weight : setting.partySizeWeights)
+    {
+        total += std::max(weight, 0.0f);
+    }
+    if (total <= 0.0f)
+    {
+        return 1;
+    }
+
+    float pick = RandomFloat() * total;
+    for (size_t i = 0; i < setting.partySizeWeights.size(); ++i)
+    {
+        pick -= std::max(setting.partySizeWeights[i], 0.0f);
+        if (pick < 0.0f)
+        {
+            return static_cast<int>(i) + 1;
+        }
+    }
+    return static_cast<int>(setting.partySizeWeights.size());
+}
+
+float FArrivalProcess::SamplePatience(const FArrivalSetting& setting, bool bCompetitive)
+{
+    const float meanPatience = std::max(bCompetitive ? setting.competitivePatience : setting.casualPatience, 0.0f);
+    if (setting.patienceSpread <= 0.0f)
+    {
+        return meanPatience;
+    }
+    float sigma = setting.patienceSpread;
+    float mu = std::log(std::max(meanPatience, 0.001f)) - 0.5f * sigma * sigma;
+    return std::exp(RandomNormal(mu, sigma));
+}
+
+void FArrivalProcess::Serialize(FBinaryArchive& Ar)
+{
+    Ar << bActive << epoch << candidateTime;
+}
+
+float FArrivalProcess::GetRateBound(const FArrivalSetting& setting, std::chrono::steady_clock::time_point time) const
+{
+    // bounds the rate from {time} onwards: the curve maximum plus every burst that hasn't ended yet
+    float bound = setting.arrivalRate;
+    if (setting.process == EArrivalProcess::Diurnal && !setting.diurnalCurve.empty())
+    {
+        bound *= *std::max_element(setting.diurnalCurve.begin(), setting.diurnalCurve.end());
+    }
+
+    float elapsed = GetElapsedSeconds(time);
+    for (const FArrivalBurst& burst : setting.bursts)
+    {
+        if (elapsed < burst.startTime + burst.duration)
+        {
+            bound += std::max(burst.rate, 0.0f);
+        }
+    }
+    return std::max(bound, 0.0f);
+}
+
+void FArrivalProcess::DrawNextCandidate(const FArrivalSetting& setting)
+{
+    float bound = GetRateBound(setting, candidateTime);
+    if (bound <= 0.0f)
+    {
+        // nothing can arrive until the settings change
+        bActive = false;
+        return;
+    }
+    candidateTime += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(RandomExponential(bound)));
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+class FBinaryArchive;
+
+// How new sessions arrive in the system
+enum class EArrivalProcess : uint8_t
+{
+    None,       // players only enter through CreatePlayer()
+    Poisson,    // constant rate
+    Diurnal,    // rate follows a piecewise-constant daily curve
+};
+
+// A storm on top of the regular arrivals, e.g. a login surge after maintenance
+struct FArrivalBurst
+{
+    float startTime = 0.0f; // seconds since the arrival process started
+    float duration = 10.0f;
+    float rate = 50.0f;     // extra arrivals per second while active
+};
+
+struct FArrivalSetting
+{
+    EArrivalProcess process = EArrivalProcess::None;
+    float arrivalRate = 5.0f;   // arrivals (parties) per second, scaled by the curve for Diurnal
+    float dayLength = 240.0f;   // simulated seconds per diurnal cycle
+    std::vector<float> diurnalCurve = {
+        0.35f, 0.25f, 0.20f, 0.15f, 0.15f, 0.20f, 0.30f, 0.45f, 0.60f, 0.70f, 0.75f, 0.80f,
+        0.85f, 0.85f, 0.90f, 0.95f, 1.05f, 1.20f, 1.40f, 1.60f, 1.70f, 1.50f, 1.00f, 0.60f,
+    }; // rate multiplier per equal segment of the day, hourly by default
+    std::vector<FArrivalBurst> bursts;
+
+    // session lengths are log-normal around the mean, a spread of 0 gives fixed-length sessions
+    float meanSessionLength = 120.0f;
+    float sessionLengthSpread = 0.5f;
+    float returningPlayerRatio = 0.8f; // chance an arrival is an offline player logging back in rather than a new player
+
+    // relative chance of an arrival being a party of 1, 2, 3... players, a party shares its session and queues as one entry
+    std::vector<float> partySizeWeights = { 1.0f };
+
+    // share of new players living in each region, in ERegion order
+    std::vector<float> regionWeights = { 0.25f, 0.2f, 0.08f, 0.27f, 0.13f, 0.07f };
+
+    // In-match disconnects: players disconnect at {disconnectRate} per minute of play. With {reconnectChance} they come back
+    // after an exponential delay around {meanReconnectDelay}, unless {reconnectWindow} runs out first and they are logged off
+    float disconnectRate = 0.0f;
+    float reconnectChance = 0.7f;
+    float meanReconnectDelay = 5.0f;
+    float reconnectWindow = 20.0f;
+    float reconnectLoadTime = 2.0f; // time spent Rejoining before the player is back in the game
+
+    // Queue abandonment: with {bQueueAbandonment} a party that waited out its patience without a match leaves the queue and
+    // goes back to idling. Patience is log-normal with {patienceSpread} around {competitivePatience} seconds when the leader is
+    // Competitive and {casualPatience} otherwise
+    bool bQueueAbandonment = false;
+    float casualPatience = 60.0f;
+    float competitivePatience = 180.0f;
+    float patienceSpread = 0.5f;
+
+    void Serialize(FBinaryArchive& Ar);
+};
+
+// Non-homogeneous Poisson arrivals generated by thinning: candidates are drawn at a rate that bounds the
+// current one and accepted with probability rate(t) / bound. Times are simulated, so runs replay exactly.
+class FArrivalProcess
+{
+public:
+    // (re)starts candidate generation at {now}, the day and burst times restart too when {bResetEpoch}
+    void Restart(const FArrivalSetting& setting, std::chrono::steady_clock::time_point now, bool bResetEpoch);
+    void Stop() { bActive = false; }
+
+    // Candidate loop: while HasCandidate(now) { if (AcceptCandidate(setting)) spawn; }
+    bool HasCandidate(std::chrono::steady_clock::time_point now) const { return bActive && candidateTime <= now; }
+    bool AcceptCandidate(const FArrivalSetting& setting); // consumes the current candidate and draws the next one
+
+    float GetRate(const FArrivalSetting& setting, std::chrono::steady_clock::time_point time) const; // arrivals per second at {time}
+    float GetElapsedSeconds(std::chrono::steady_clock::time_point time) const;
+    float GetTimeOfDay(const FArrivalSetting& setting, std::chrono::steady_clock::time_point time) const; // 0 - 1
+    bool IsActive() const { return bActive; }
+    std::chrono::steady_clock::time_point GetCandidateTime() const { return candidateTime; }
+
+    static float SampleSessionLength(const FArrivalSetting& setting);
+    static int SamplePartySize(const FArrivalSetting& setting);
+    static float SamplePatience(const FArrivalSetting& setting, bool bCompetitive);
+
+    void Serialize(FBinaryArchive& Ar);
+
+private:
+    float GetRateBound(const FArrivalSetting& setting, std::chrono::steady_clock::time_point time) const;
+    void DrawNextCandidate(const FArrivalSetting& setting);
+
+    bool bActive = false;
+    std::chrono::steady_clock::time_point epoch;
+    std::chrono::steady_clock::time_point candidateTime;
+};
@@ -0,0 +1,108 @@
+#include "Backfill.h"
+
+#include <cmath>
+#include <limits>
+
+void FBackfillIndex::Open(const FOpenSlot& slot)
+{
+    if (slot.departedId < 0 || slot.dataCenter < 0 || slot.dataCenter >= NumRegions || slot.role < -1 || slot.role >= NumRoles)
+    {
+        return;
+    }
+    Close(slot.departedId);
+    slots.emplace(slot.departedId, slot);
+    GetRatingSet(slot.dataCenter, slot.role).emplace(slot.rating, slot.departedId);
+    byFillBy.emplace(slot.fillBy, slot.departedId);
+}
+
+bool FBackfillIndex::Close(int departedId)
+{
+    auto it = slots.find(departedId);
+    if (it == slots.end())
+    {
+        return false;
+    }
+    const FOpenSlot& slot = it->second;
+    GetRatingSet(slot.dataCenter, slot.role).erase({ slot.rating, departedId });
+    byFillBy.erase({ slot.fillBy, departedId });
+    slots.erase(it);
+    return true;
+}
+
+int FBackfillIndex::Expire(std::chrono::steady_clock::time_point now)
+{
+    int expired = 0;
+    while (!byFillBy.empty() && byFillBy.begin()->first <= now)
+    {
+        Close(byFillBy.begin()->second);
+        ++expired;
+    }
+    return expired;
+}
+
+void FBackfillIndex::Clear()
+{
+    slots.clear();
+    for (FRatingSet& ratingSet : byRating)
+    {
+        ratingSet.clear();
+    }
+    byFillBy.clear();
+}
+
+int FBackfillIndex::FindSlot(int dataCenter, FRoleMask roles, float rating, float ratingWindow, float& outGap) const
+{
+    if (dataCenter < 0 || dataCenter >= NumRegions)
+    {
+        return -1;
+    }
+
+    // the neighbours of {rating} in the set of any-player slots and in the set of every role the player plays
+    int best = -1;
+    float bestGap = 0.0f;
+    auto consider = [&best, &bestGap, rating, ratingWindow](const std::pair<float, int>& entry)
+    {
+        float gap = std::abs(entry.first - rating);
+        if (gap <= ratingWindow && (best < 0 || gap < bestGap || (gap == bestGap && entry.second < best)))
+        {
+            best = entry.second;
+            bestGap = gap;
+        }
+    };
+    for (int role = -1; role < NumRoles; ++role)
+    {
+        if (role >= 0 && !(roles & GetRoleBit(role)))
+        {
+            continue;
+        }
+        const FRatingSet& ratingSet = GetRatingSet(dataCenter, role);
+        auto it = ratingSet.lower_bound({ rating, std::numeric_limits<int>::min() });
+        if (it != ratingSet.end())
+        {
+            consider(*it);
+        }
+        if (it != ratingSet.begin())
+        {
+            consider(*std::prev(it));
+        }
+    }
+    outGap = bestGap;
+    return best;
+}
+
+const FOpenSlot* FBackfillIndex::GetSlot(int departedId) const
+{
+    auto it = slots.find(departedId);
+    return it != slots.end() ? &it->second : nullptr;
+}
+
+std::vector<FOpenSlot> FBackfillIndex::ToVector() const
+{
+    std::vector<FOpenSlot> result;
+    result.reserve(slots.size());
+    for (const auto& entry : byFillBy)
+    {
+        result.push_back(slots.find(entry.second)->second);
+    }
+    return result;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Region.h"
+#include "Role.h"
+
+// A place in an ongoing match left by a player who dropped out, keyed by that player
+struct FOpenSlot
+{
+    int departedId = -1;
+    int matchId = -1;
+    int team = -1;
+    int role = -1;          // ERole of the slot, -1 when any player fits
+    int dataCenter = 0;     // the match's host
+    float rating = 0.0f;    // the departed player's
+    std::chrono::steady_clock::time_point openTime;
+    std::chrono::steady_clock::time_point fillBy; // after this too little of the match is left to be worth joining
+};
+
+// Open slots of ongoing matches, indexed by data center and role, then by rating. A queued player finds the closest slot with
+// one lookup per role they play, and nothing walks the ongoing matches. Slots are also ordered by fill-by time, so the ones
+// that ran out are dropped from the front
+class FBackfillIndex
+{
+public:
+    void Open(const FOpenSlot& slot); // replaces an open slot of the same departed player
+    bool Close(int departedId);
+    int Expire(std::chrono::steady_clock::time_point now); // closes the slots past their fill-by time, returns how many
+    void Clear();
+
+    // departed id of the slot closest to {rating}, within {ratingWindow}, that a player of {roles} can fill. -1 when none
+    int FindSlot(int dataCenter, FRoleMask roles, float rating, float ratingWindow, float& outGap) const;
+    const FOpenSlot* GetSlot(int departedId) const;
+    bool Empty() const { return slots.empty(); }
+    size_t Size() const { return slots.size(); }
+    std::vector<FOpenSlot> ToVector() const; // by fill-by time
+
+private:
+    using FRatingSet = std::set<std::pair<float, int>>; // (rating, departed id)
+
+    FRatingSet& GetRatingSet(int dataCenter, int role) { return byRating[dataCenter * (NumRoles + 1) + role + 1]; }
+    const FRatingSet& GetRatingSet(int dataCenter, int role) const { return byRating[dataCenter * (NumRoles + 1) + role + 1]; }
+
+    std::unordered_map<int, FOpenSlot> slots; // by departed id
+    std::array<FRatingSet, NumRegions * (NumRoles + 1)> byRating; // slots taking any player first, then one set per role
+    std::set<std::pair<std::chrono::steady_clock::time_point, int>> byFillBy;
+};
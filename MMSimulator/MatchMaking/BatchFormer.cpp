@@ -0,0 +1,558 @@
+#include "BatchFormer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#include "TraceRecorder.h"
+
+namespace
+{
+    // whether parties of the sizes left in {counts} can add up to {target} players
+    bool CanFill(int target, const std::array<int, FPartyQueue::MaxPartySize + 1>& counts)
+    {
+        if (target <= 0 || target >= 64)
+        {
+            return target == 0 || target >= 64;
+        }
+        const uint64_t mask = (uint64_t(2) << target) - 1;
+        uint64_t reachable = 1;
+        for (int size = 1; size <= FPartyQueue::MaxPartySize; ++size)
+        {
+            for (int k = 0; k < counts[size] && k < target / size; ++k)
+            {
+                reachable = (reachable | (reachable << size)) & mask;
+            }
+        }
+        return (reachable >> target) & 1;
+    }
+}
+
+void SolveAssignment(int n, const std::vector<double>& costs, std::vector<int>& outAssignment)
+{
+    // shortest augmenting paths with row and column potentials, rows and columns are 1-based and 0 is the virtual start
+    const double infinity = std::numeric_limits<double>::infinity();
+    std::vector<double> rowPotential(n + 1, 0.0);
+    std::vector<double> colPotential(n + 1, 0.0);
+    std::vector<int> colRow(n + 1, 0);  // row assigned to each column
+    std::vector<int> prevCol(n + 1, 0); // on the augmenting path
+    std::vector<double> minSlack(n + 1);
+    std::vector<char> visited(n + 1);
+    for (int row = 1; row <= n; ++row)
+    {
+        colRow[0] = row;
+        int col = 0;
+        std::fill(minSlack.begin(), minSlack.end(), infinity);
+        std::fill(visited.begin(), visited.end(), 0);
+        do
+        {
+            visited[col] = 1;
+            const int pathRow = colRow[col];
+            double delta = infinity;
+            int nextCol = 0;
+            for (int j = 1; j <= n; ++j)
+            {
+                if (visited[j])
+                {
+                    continue;
+                }
+                double slack = costs[static_cast<size_t>(pathRow - 1) * n + (j - 1)] - rowPotential[pathRow] - colPotential[j];
+                if (slack < minSlack[j])
+                {
+                    minSlack[j] = slack;
+                    prevCol[j] = col;
+                }
+                if (minSlack[j] < delta)
+                {
+                    delta = minSlack[j];
+                    nextCol = j;
+                }
+            }
+            for (int j = 0; j <= n; ++j)
+            {
+                if (visited[j])
+                {
+                    rowPotential[colRow[j]] += delta;
+                    colPotential[j] -= delta;
+                }
+                else
+                {
+                    minSlack[j] -= delta;
+                }
+            }
+            col = nextCol;
+        } while (colRow[col] != 0);
+
+        // flip the path back to the start
+        do
+        {
+            const int previous = prevCol[col];
+            colRow[col] = colRow[previous];
+            col = previous;
+        } while (col != 0);
+    }
+
+    outAssignment.assign(n, -1);
+    for (int j = 1; j <= n; ++j)
+    {
+        if (colRow[j] > 0)
+        {
+            outAssignment[colRow[j] - 1] = j - 1;
+        }
+    }
+}
+
+// ===== FBatchPlan BEGIN =====
+
+void FBatchPlan::Clear()
+{
+    matches.clear();
+    next = 0;
+}
+
+void FBatchPlan::Assign(std::vector<FPlannedMatch>&& inMatches)
+{
+    matches = std::move(inMatches);
+    next = 0;
+    std::stable_sort(matches.begin(), matches.end(), [](const FPlannedMatch& a, const FPlannedMatch& b) { return a.priority > b.priority; });
+}
+
+bool FBatchPlan::PopMatch(FPartyQueue& queue, std::vector<std::vector<int>>& outTeams)
+{
+    while (next < matches.size())
+    {
+        const FPlannedMatch& match = matches[next++];
+        bool bValid = true;
+        size_t party = 0;
+        for (const std::vector<int>& team : match.teams)
+        {
+            for (int leaderId : team)
+            {
+                bValid &= queue.GetPartySize(leaderId) == match.partySizes[party++];
+            }
+        }
+        if (!bValid)
+        {
+            continue;
+        }
+
+        for (const std::vector<int>& team : match.teams)
+        {
+            for (int leaderId : team)
+            {
+                queue.Remove(leaderId);
+            }
+        }
+        outTeams = match.teams;
+        return true;
+    }
+    return false;
+}
+
+void FBatchPlan::Serialize(FBinaryArchive& Ar)
+{
+    // only the matches not handed out yet
+    uint64_t numMatches = Remaining();
+    Ar << numMatches;
+    if (Ar.IsLoading())
+    {
+        if (Ar.HasError() || numMatches > Ar.GetData().size())
+        {
+            return;
+        }
+        matches.assign(static_cast<size_t>(numMatches), FPlannedMatch());
+        next = 0;
+    }
+    for (size_t i = next; i < matches.size() && !Ar.HasError(); ++i)
+    {
+        FPlannedMatch& match = matches[i];
+        Ar << match.teams << match.partySizes << match.priority << match.cost;
+    }
+}
+
+// ===== FBatchPlan END =====
+
+// ===== FBatchSolver BEGIN =====
+
+void FBatchSolver::Reset(int numQueues)
+{
+    inputs.resize(static_cast<size_t>(numQueues));
+    for (FQueueInput& input : inputs)
+    {
+        input.parties.clear();
+        input.host = -1;
+    }
+}
+
+int FBatchSolver::Solve(int inNumTeams, int inTeamSize, const FBatchCost& inCost, int numThreads, std::chrono::steady_clock::time_point deadline, int maxBlocks, FBatchPlan* outPlans)
+{
+    numTeams = inNumTeams;
+    teamSize = inTeamSize;
+    cost = inCost;
+
+    // parties close in data center and rating end up in the same block
+    blocks.clear();
+    for (int queue = 0; queue < static_cast<int>(inputs.size()); ++queue)
+    {
+        FQueueInput& input = inputs[queue];
+        auto closestDataCenter = [](const FBatchParty& party)
+        {
+            return static_cast<int>(std::min_element(party.latencies.begin(), party.latencies.end()) - party.latencies.begin());
+        };
+        std::sort(input.parties.begin(), input.parties.end(), [&input, &closestDataCenter](const FBatchParty& a, const FBatchParty& b)
+            {
+                if (input.host < 0)
+                {
+                    int dataCenterA = closestDataCenter(a);
+                    int dataCenterB = closestDataCenter(b);
+                    if (dataCenterA != dataCenterB)
+                    {
+                        return dataCenterA < dataCenterB;
+                    }
+                }
+                return a.rating != b.rating ? a.rating < b.rating : a.leaderId < b.leaderId;
+            });
+        const int numParties = static_cast<int>(input.parties.size());
+        for (int begin = 0; begin < numParties; begin += BlockParties)
+        {
+            FBlock& block = blocks.emplace_back();
+            block.queue = queue;
+            block.begin = begin;
+            block.end = std::min(numParties, begin + BlockParties);
+            for (int party = block.begin; party < block.end; ++party)
+            {
+                block.longestWait = std::max(block.longestWait, input.parties[party].waitSeconds);
+            }
+        }
+    }
+
+    // blocks a budget cut left behind waited longer, so they come first in the next batch
+    std::stable_sort(blocks.begin(), blocks.end(), [](const FBlock& a, const FBlock& b) { return a.longestWait > b.longestWait; });
+    blockMatches.resize(blocks.size());
+    for (std::vector<FBatchPlan::FPlannedMatch>& matches : blockMatches)
+    {
+        matches.clear();
+    }
+
+    // the first block is always solved so a tight budget can't stall the queue
+    const size_t limit = maxBlocks >= 0 ? std::min(blocks.size(), static_cast<size_t>(maxBlocks)) : blocks.size();
+    std::mutex mutex;
+    size_t nextBlock = 0;
+    bool bStopped = false;
+    auto worker = [&]()
+    {
+        for (;;)
+        {
+            size_t block = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (bStopped || nextBlock >= limit || (nextBlock > 0 && std::chrono::steady_clock::now() >= deadline))
+                {
+                    bStopped = true;
+                    return;
+                }
+                block = nextBlock++;
+            }
+            SolveBlock(blocks[block], blockMatches[block]);
+        }
+    };
+
+    if (numThreads <= 0)
+    {
+        numThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    numThreads = std::clamp(numThreads, 1, std::max(1, static_cast<int>(limit)));
+    std::vector<std::thread> threads;
+    threads.reserve(static_cast<size_t>(numThreads - 1));
+    for (int t = 1; t < numThreads; ++t)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (int queue = 0; queue < static_cast<int>(inputs.size()); ++queue)
+    {
+        std::vector<FBatchPlan::FPlannedMatch> matches;
+        for (size_t block = 0; block < nextBlock; ++block)
+        {
+            if (blocks[block].queue == queue)
+            {
+                std::move(blockMatches[block].begin(), blockMatches[block].end(), std::back_inserter(matches));
+            }
+        }
+        outPlans[queue].Assign(std::move(matches));
+    }
+    return static_cast<int>(nextBlock);
+}
+
+void FBatchSolver::SolveBlock(const FBlock& block, std::vector<FBatchPlan::FPlannedMatch>& outMatches) const
+{
+    MM_TRACE_SCOPE("SolveBlock");
+    if (numTeams == 2 && teamSize == 1)
+    {
+        SolvePairs(block, outMatches);
+    }
+    else
+    {
+        SolveClusters(block, outMatches);
+    }
+}
+
+float FBatchSolver::GetLatencyCost(const FBlock& block, const int* members, int numMembers) const
+{
+    const std::vector<FBatchParty>& parties = inputs[block.queue].parties;
+    const int host = inputs[block.queue].host;
+    int bestLatency = std::numeric_limits<int>::max();
+    for (int dataCenter = 0; dataCenter < NumRegions; ++dataCenter)
+    {
+        if (host >= 0 && dataCenter != host)
+        {
+            continue;
+        }
+        int latency = 0;
+        for (int m = 0; m < numMembers; ++m)
+        {
+            latency = std::max(latency, static_cast<int>(parties[members[m]].latencies[dataCenter]));
+        }
+        bestLatency = std::min(bestLatency, latency);
+    }
+    return cost.latencyWeight * static_cast<float>(bestLatency);
+}
+
+void FBatchSolver::SolvePairs(const FBlock& block, std::vector<FBatchPlan::FPlannedMatch>& outMatches) const
+{
+    const std::vector<FBatchParty>& parties = inputs[block.queue].parties;
+    std::vector<int> order;
+    for (int i = block.begin; i < block.end; ++i)
+    {
+        order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&parties](int a, int b)
+        {
+            return parties[a].rating != parties[b].rating ? parties[a].rating < parties[b].rating : parties[a].leaderId < parties[b].leaderId;
+        });
+
+    // side A (even ranks) are the rows, side B (odd ranks) the columns. Each side is padded with a stand-in for every player of
+    // the other side, pairing a player with a stand-in leaves them queued. Stand-ins pair with each other for free
+    std::vector<int> sideA;
+    std::vector<int> sideB;
+    for (size_t rank = 0; rank < order.size(); ++rank)
+    {
+        (rank % 2 == 0 ? sideA : sideB).push_back(order[rank]);
+    }
+    const int numA = static_cast<int>(sideA.size());
+    const int numB = static_cast<int>(sideB.size());
+    const int n = numA + numB;
+    if (numA == 0 || numB == 0)
+    {
+        return;
+    }
+
+    auto leaveCost = [this, &parties](int party)
+    {
+        return 0.5 * (static_cast<double>(cost.maxCost) + static_cast<double>(cost.costGrowth) * parties[party].waitSeconds);
+    };
+    auto pairCost = [this, &parties, &block](int a, int b)
+    {
+        const int members[2] = { a, b };
+        return static_cast<double>(std::abs(parties[a].rating - parties[b].rating)) + static_cast<double>(GetLatencyCost(block, members, 2));
+    };
+
+    std::vector<double> costs(static_cast<size_t>(n) * n, 0.0);
+    for (int row = 0; row < n; ++row)
+    {
+        for (int col = 0; col < n; ++col)
+        {
+            double& entry = costs[static_cast<size_t>(row) * n + col];
+            if (row < numA && col < numB)
+            {
+                entry = pairCost(sideA[row], sideB[col]);
+            }
+            else if (row < numA)
+            {
+                entry = leaveCost(sideA[row]);
+            }
+            else if (col < numB)
+            {
+                entry = leaveCost(sideB[col]);
+            }
+        }
+    }
+
+    std::vector<int> assignment;
+    SolveAssignment(n, costs, assignment);
+    for (int row = 0; row < numA; ++row)
+    {
+        const int col = assignment[row];
+        if (col < 0 || col >= numB)
+        {
+            continue;
+        }
+        const int a = sideA[row];
+        const int b = sideB[col];
+        const double matchCost = costs[static_cast<size_t>(row) * n + col];
+        if (matchCost > leaveCost(a) + leaveCost(b))
+        {
+            continue;
+        }
+        FBatchPlan::FPlannedMatch& match = outMatches.emplace_back();
+        match.teams = { { parties[a].leaderId }, { parties[b].leaderId } };
+        match.partySizes = { parties[a].size, parties[b].size };
+        match.priority = std::max(parties[a].waitSeconds, parties[b].waitSeconds);
+        match.cost = static_cast<float>(matchCost);
+    }
+}
+
+void FBatchSolver::SolveClusters(const FBlock& block, std::vector<FBatchPlan::FPlannedMatch>& outMatches) const
+{
+    const std::vector<FBatchParty>& parties = inputs[block.queue].parties;
+    const int playersPerMatch = numTeams * teamSize;
+    std::vector<char> used(static_cast<size_t>(block.end - block.begin), 0);
+    std::vector<int> window;
+    std::vector<int> members;
+    std::vector<std::vector<int>> teams(static_cast<size_t>(numTeams));
+    std::vector<int> bestMembers;
+    std::vector<std::vector<int>> bestTeams;
+
+    // fills the teams from {window}, its first party in the first team. Every slot takes the closest party of the largest size
+    // that fits and leaves a remainder the other sizes can still add up to
+    auto packWindow = [&]()
+    {
+        std::array<int, FPartyQueue::MaxPartySize + 1> counts{};
+        for (int party : window)
+        {
+            ++counts[parties[party].size];
+        }
+        std::vector<char> taken(window.size(), 0);
+        members.clear();
+        for (int t = 0; t < numTeams; ++t)
+        {
+            teams[t].clear();
+            int remaining = teamSize;
+            if (t == 0)
+            {
+                taken[0] = 1;
+                --counts[parties[window[0]].size];
+                remaining -= parties[window[0]].size;
+                teams[0].push_back(window[0]);
+                members.push_back(window[0]);
+            }
+            while (remaining > 0)
+            {
+                int pick = -1;
+                for (int size = std::min(remaining, FPartyQueue::MaxPartySize); size >= 1 && pick < 0; --size)
+                {
+                    if (counts[size] == 0)
+                    {
+                        continue;
+                    }
+                    --counts[size];
+                    if (CanFill(remaining - size, counts))
+                    {
+                        for (size_t w = 0; w < window.size(); ++w)
+                        {
+                            if (!taken[w] && parties[window[w]].size == size)
+                            {
+                                pick = static_cast<int>(w);
+                                break;
+                            }
+                        }
+                    }
+                    if (pick < 0)
+                    {
+                        ++counts[size];
+                    }
+                }
+                if (pick < 0)
+                {
+                    return false;
+                }
+                taken[pick] = 1;
+                remaining -= parties[window[pick]].size;
+                teams[t].push_back(window[pick]);
+                members.push_back(window[pick]);
+            }
+        }
+        return true;
+    };
+
+    for (;;)
+    {
+        float bestCost = std::numeric_limits<float>::max();
+        for (int anchor = block.begin; anchor < block.end; ++anchor)
+        {
+            if (used[anchor - block.begin])
+            {
+                continue;
+            }
+
+            // the window grows until it packs, its first match is this anchor's
+            window.clear();
+            int windowPlayers = 0;
+            for (int party = anchor; party < block.end && static_cast<int>(window.size()) < MaxWindowParties; ++party)
+            {
+                if (used[party - block.begin])
+                {
+                    continue;
+                }
+                window.push_back(party);
+                windowPlayers += parties[party].size;
+                if (windowPlayers < playersPerMatch || !packWindow())
+                {
+                    continue;
+                }
+
+                float lowest = std::numeric_limits<float>::max();
+                float highest = std::numeric_limits<float>::lowest();
+                float totalWait = 0.0f;
+                for (int member : members)
+                {
+                    lowest = std::min(lowest, parties[member].rating);
+                    highest = std::max(highest, parties[member].rating);
+                    totalWait += parties[member].waitSeconds;
+                }
+                const float matchCost = highest - lowest + GetLatencyCost(block, members.data(), static_cast<int>(members.size()));
+                const float costLimit = cost.maxCost + cost.costGrowth * totalWait / static_cast<float>(members.size());
+                if (matchCost <= costLimit && matchCost < bestCost)
+                {
+                    bestCost = matchCost;
+                    bestMembers = members;
+                    bestTeams = teams;
+                }
+                break;
+            }
+        }
+        if (bestMembers.empty())
+        {
+            return;
+        }
+
+        FBatchPlan::FPlannedMatch& match = outMatches.emplace_back();
+        match.cost = bestCost;
+        for (const std::vector<int>& team : bestTeams)
+        {
+            std::vector<int>& leaderIds = match.teams.emplace_back();
+            for (int party : team)
+            {
+                leaderIds.push_back(parties[party].leaderId);
+                match.partySizes.push_back(parties[party].size);
+                match.priority = std::max(match.priority, parties[party].waitSeconds);
+            }
+        }
+        for (int member : bestMembers)
+        {
+            used[member - block.begin] = 1;
+        }
+        bestMembers.clear();
+    }
+}
+
+// ===== FBatchSolver END =====
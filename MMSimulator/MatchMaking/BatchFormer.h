@@ -0,0 +1,107 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "BinaryArchive.h"
+#include "PlayerQueue.h"
+#include "Region.h"
+
+// A queued party as the batch solver sees it
+struct FBatchParty
+{
+    int leaderId = -1;
+    int size = 1;
+    float rating = 0.0f;        // average of the members
+    float waitSeconds = 0.0f;   // time the party has been queued
+    FLatencyVector latencies{}; // worst member's, per data center
+};
+
+// A match costs the rating range of its parties plus {latencyWeight} per ms of the worst latency at its host. It is only formed
+// below {maxCost}, which grows by {costGrowth} for every second its parties waited on average
+struct FBatchCost
+{
+    float latencyWeight = 2.0f;
+    float maxCost = 200.0f;
+    float costGrowth = 20.0f;
+};
+
+// Matches solved for one queue, handed out longest waiting first
+class FBatchPlan
+{
+public:
+    struct FPlannedMatch
+    {
+        std::vector<std::vector<int>> teams;    // leader ids
+        std::vector<int> partySizes;            // in team order, a party that changed since the solve voids the match
+        float priority = 0.0f;                  // longest wait among the parties
+        float cost = 0.0f;
+    };
+
+    void Clear();
+    void Assign(std::vector<FPlannedMatch>&& inMatches); // sorted by priority here
+    // the next planned match whose parties are all still queued as they were solved, the parties are popped
+    bool PopMatch(FPartyQueue& queue, std::vector<std::vector<int>>& outTeams);
+    size_t Remaining() const { return matches.size() - next; }
+    void Serialize(FBinaryArchive& Ar);
+
+private:
+    std::vector<FPlannedMatch> matches;
+    size_t next = 0;
+};
+
+// Solves the queues of a matchmaking cycle for the set of matches with the lowest total cost.
+// Each queue is sorted by closest data center and rating and cut into blocks of up to BlockParties parties. Blocks are solved
+// on their own, by as many threads as asked for, and their matches are put together in block order, so the plan doesn't depend
+// on the threads.
+// - 1v1 between solo players is an assignment problem: the block is split into two sides alternating in rating order, so every
+//   player has their closest neighbours on the other side, and the Hungarian method pairs the sides. A player may also stay
+//   queued, at half the cost limit of a match
+// - Other matches are clustered: the cheapest window of consecutive parties that packs into full teams becomes a match, until no
+//   window is under its cost limit. A window holds at most MaxWindowParties parties
+// Blocks are handed out longest waiting first while the deadline allows, so the solved ones are always a prefix of that order.
+// The others wait for the next batch, where they come first
+class FBatchSolver
+{
+public:
+    static constexpr int BlockParties = 96;
+    static constexpr int MaxWindowParties = 32;
+
+    void Reset(int numQueues);
+    std::vector<FBatchParty>& GetParties(int queue) { return inputs[queue].parties; } // filled before Solve
+    void SetHost(int queue, int dataCenter) { inputs[queue].host = dataCenter; } // -1: the data center closest to each match
+
+    // returns how many blocks were solved, at most {maxBlocks} when it isn't negative, and fills one plan per queue
+    int Solve(int numTeams, int teamSize, const FBatchCost& cost, int numThreads, std::chrono::steady_clock::time_point deadline, int maxBlocks, FBatchPlan* outPlans);
+    int GetNumBlocks() const { return static_cast<int>(blocks.size()); }
+
+private:
+    struct FQueueInput
+    {
+        std::vector<FBatchParty> parties;
+        int host = -1;
+    };
+
+    struct FBlock
+    {
+        int queue = 0;
+        int begin = 0;
+        int end = 0;
+        float longestWait = 0.0f;
+    };
+
+    void SolveBlock(const FBlock& block, std::vector<FBatchPlan::FPlannedMatch>& outMatches) const;
+    void SolvePairs(const FBlock& block, std::vector<FBatchPlan::FPlannedMatch>& outMatches) const;
+    void SolveClusters(const FBlock& block, std::vector<FBatchPlan::FPlannedMatch>& outMatches) const;
+    float GetLatencyCost(const FBlock& block, const int* members, int numMembers) const; // at the block's host
+
+    std::vector<FQueueInput> inputs;
+    std::vector<FBlock> blocks;
+    std::vector<std::vector<FBatchPlan::FPlannedMatch>> blockMatches;
+    int numTeams = 2;
+    int teamSize = 1;
+    FBatchCost cost;
+};
+
+// Minimum cost assignment of an n x n matrix (Hungarian method, O(n^3)). {outAssignment}[row] is the column given to the row
+void SolveAssignment(int n, const std::vector<double>& costs, std::vector<int>& outAssignment);
@@ -0,0 +1,129 @@
+#include "BinaryArchive.h"
+
+#include <fstream>
+
+FBinaryArchive FBinaryArchive::ForSaving()
+{
+    FBinaryArchive archive(false);
+    archive.data.reserve(1 << 16);
+    return archive;
+}
+
+FBinaryArchive FBinaryArchive::ForLoading(std::vector<char>&& inData)
+{
+    FBinaryArchive archive(true);
+    archive.data = std::move(inData);
+    return archive;
+}
+
+void FBinaryArchive::SerializeBytes(void* bytes, size_t size)
+{
+    if (bIsLoading)
+    {
+        if (bHasError || size > data.size() - cursor)
+        {
+            bHasError = true;
+            std::memset(bytes, 0, size);
+            return;
+        }
+        std::memcpy(bytes, data.data() + cursor, size);
+        cursor += size;
+        return;
+    }
+
+    const char* src = static_cast<const char*>(bytes);
+    data.insert(data.end(), src, src + size);
+}
+
+void FBinaryArchive::SerializeVarUInt(uint64_t& value)
+{
+    if (bIsLoading)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            uint8_t byte = 0;
+            SerializeBytes(&byte, 1);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0 || bHasError)
+            {
+                return;
+            }
+        }
+        bHasError = true; // more than 10 bytes, not a valid encoding
+        return;
+    }
+
+    uint64_t remaining = value;
+    do
+    {
+        uint8_t byte = static_cast<uint8_t>(remaining & 0x7F);
+        remaining >>= 7;
+        if (remaining != 0)
+        {
+            byte |= 0x80;
+        }
+        data.push_back(static_cast<char>(byte));
+    } while (remaining != 0);
+}
+
+void FBinaryArchive::SerializeVarInt(int64_t& value)
+{
+    uint64_t encoded = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    SerializeVarUInt(encoded);
+    if (bIsLoading)
+    {
+        value = static_cast<int64_t>(encoded >> 1) ^ -static_cast<int64_t>(encoded & 1);
+    }
+}
+
+FBinaryArchive& FBinaryArchive::operator<<(std::chrono::steady_clock::time_point& value)
+{
+    int64_t offset = 0;
+    if (IsSaving())
+    {
+        offset = (value - referenceTime).count();
+    }
+    *this << offset;
+    if (IsLoading())
+    {
+        value = referenceTime + std::chrono::steady_clock::duration(offset);
+    }
+    return *this;
+}
+
+FBinaryArchive& FBinaryArchive::operator<<(std::string& value)
+{
+    std::vector<char> chars(value.begin(), value.end());
+    *this << chars;
+    if (IsLoading())
+    {
+        value.assign(chars.begin(), chars.end());
+    }
+    return *this;
+}
+
+bool FBinaryArchive::SaveToFile(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        return false;
+    }
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(file);
+}
+
+bool FBinaryArchive::ReadFile(const std::string& path, std::vector<char>& outData)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        return false;
+    }
+    std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+
+    outData.resize(static_cast<size_t>(size));
+    return size == 0 || static_cast<bool>(file.read(outData.data(), size));
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Values that can be copied as raw bytes. Time points are excluded because they are stored relative to the archive's reference time
+template <typename T>
+constexpr bool IsRawSerializable = std::is_trivially_copyable_v<T> && !std::is_same_v<T, std::chrono::steady_clock::time_point>;
+
+// Minimal binary archive used to persist simulation state.
+// A single Serialize(FBinaryArchive&) function handles both directions: when saving, values are appended to the buffer,
+// when loading, the same calls read them back in the same order.
+class FBinaryArchive
+{
+public:
+    static FBinaryArchive ForSaving();
+    static FBinaryArchive ForLoading(std::vector<char>&& inData);
+
+    bool IsLoading() const { return bIsLoading; }
+    bool IsSaving() const { return !bIsLoading; }
+    bool HasError() const { return bHasError; } // true when a read went past the end of the data
+    bool AtEnd() const { return cursor >= data.size(); }
+    const std::vector<char>& GetData() const { return data; }
+    std::vector<char> TakeData() { return std::move(data); } // moves the buffer out, the archive is empty afterwards
+
+    // time points are stored as offsets from this reference, so they stay valid across processes
+    void SetReferenceTime(std::chrono::steady_clock::time_point inTime) { referenceTime = inTime; }
+
+    void SerializeBytes(void* bytes, size_t size);
+
+    // variable-length (LEB128) integers, small values take a single byte. Signed values are zigzag encoded
+    void SerializeVarUInt(uint64_t& value);
+    void SerializeVarInt(int64_t& value);
+
+    // file helpers, whole file is read in a single call so loading is a straight memcpy walk over one buffer
+    bool SaveToFile(const std::string& path) const;
+    static bool ReadFile(const std::string& path, std::vector<char>& outData);
+
+    // Trivially copyable values (ints, floats, enums, durations, plain structs) are copied as raw bytes
+    template <typename T, typename = std::enable_if_t<IsRawSerializable<T>>>
+    FBinaryArchive& operator<<(T& value)
+    {
+        SerializeBytes(&value, sizeof(T));
+        return *this;
+    }
+
+    FBinaryArchive& operator<<(std::chrono::steady_clock::time_point& value);
+    FBinaryArchive& operator<<(std::string& value);
+
+    template <typename A, typename B>
+    FBinaryArchive& operator<<(std::pair<A, B>& value)
+    {
+        return *this << value.first << value.second;
+    }
+
+    template <typename T>
+    FBinaryArchive& operator<<(std::vector<T>& values)
+    {
+        uint64_t count = values.size();
+        *this << count;
+        if (bIsLoading)
+        {
+            // guard against corrupted sizes before allocating
+            if (bHasError || count > data.size() - cursor)
+            {
+                bHasError = true;
+                return *this;
+            }
+            values.resize(static_cast<size_t>(count));
+        }
+
+        if constexpr (IsRawSerializable<T>)
+        {
+            if (count > 0)
+            {
+                SerializeBytes(values.data(), static_cast<size_t>(count) * sizeof(T));
+            }
+        }
+        else
+        {
+            for (T& value : values)
+            {
+                *this << value;
+            }
+        }
+        return *this;
+    }
+
+private:
+    FBinaryArchive(bool bInIsLoading) : bIsLoading(bInIsLoading) {}
+
+    bool bIsLoading = false;
+    bool bHasError = false;
+    std::vector<char> data;
+    size_t cursor = 0;
+    std::chrono::steady_clock::time_point referenceTime;
+};
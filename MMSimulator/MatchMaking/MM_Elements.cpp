@@ -1,9 +1,12 @@
 #include "MM_Elements.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <queue>
 
+#include "BinaryArchive.h"
 #include "RandomGenerator.h"
+#include "SimClock.h"
 #include <random>
 #include <sstream>
 
@@ -11,6 +14,7 @@ VirtualPlayer::VirtualPlayer(int inId, EPlayerTrait inTrait)
 {
     id = inId;
     traits = inTrait;
+    DerivePlayStyle();
 }
 
 VirtualPlayer::VirtualPlayer(int inId)
@@ -18,6 +22,8 @@ VirtualPlayer::VirtualPlayer(int inId)
     id = inId;
     traits = GenerateRandomTraits();
     ValidateTraits();
+    DerivePlayStyle();
+    roles = GenerateRoles();
 }
 
 EPlayerTrait VirtualPlayer::GenerateRandomTraits()
@@ -44,6 +50,40 @@ void VirtualPlayer::ValidateTraits()
     HandleConflictTrait_PickOne({EPlayerTrait::Casual, EPlayerTrait::Competitive});
 }
 
+FPlayStyle VirtualPlayer::GetPlayStyle() const
+{
+    return { static_cast<int8_t>(agr), static_cast<int8_t>(fle), static_cast<int8_t>(gri), static_cast<int8_t>(end),
+        static_cast<int8_t>(ins), static_cast<int8_t>(cre), static_cast<int8_t>(pre) };
+}
+
+void VirtualPlayer::DerivePlayStyle()
+{
+    std::array<int, NumPlayStyleStats> stats;
+    stats.fill(PlayStyleBase);
+    for (const auto& [trait, info] : TraitDatabase)
+    {
+        if (HasTrait(trait))
+        {
+            const int modifiers[NumPlayStyleStats] = { info.agr, info.fle, info.gri, info.end, info.ins, info.cre, info.pre };
+            for (int stat = 0; stat < NumPlayStyleStats; ++stat)
+            {
+                stats[stat] += modifiers[stat];
+            }
+        }
+    }
+    for (int& stat : stats)
+    {
+        stat = std::clamp(stat, 0, MaxPlayStyleStat);
+    }
+    agr = stats[0];
+    fle = stats[1];
+    gri = stats[2];
+    end = stats[3];
+    ins = stats[4];
+    cre = stats[5];
+    pre = stats[6];
+}
+
 void VirtualPlayer::HandleConflictTrait_PickOne(const std::vector<EPlayerTrait>& conflictingTraits)
 {
     if (conflictingTraits.size() > 1)
@@ -76,10 +116,12 @@ void VirtualPlayer::RegisterMatchResult(int matchId, bool bIsWon)
     if (bIsWon)
     {
         wonMatches.push_back(matchId);
+        streak = std::max(streak, 0) + 1;
     }
     else
     {
         lostMatches.push_back(matchId);
+        streak = std::min(streak, 0) - 1;
     }
     
     UpdateWinRate();
@@ -88,7 +130,7 @@ void VirtualPlayer::RegisterMatchResult(int matchId, bool bIsWon)
 std::chrono::steady_clock::time_point VirtualPlayer::SetNextRejoiningTime()
 {
     currentIdleTime = RandomFloatWithAnchor(2.0f, 1.4f);
-    return std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(currentIdleTime));
+    return SimNow() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(currentIdleTime));
 }
 
 void VirtualPlayer::UpdateWinRate()
@@ -115,10 +157,28 @@ void VirtualPlayer::SetState(EPlayerState inState, std::string& logMsg)
         logMsg = logEntry.str();
     }
 
+    if (inState == EPlayerState::Offline)
+    {
+        logEntry << "Player " << id << " logs off...";
+        logMsg = logEntry.str();
+    }
+
+    if (inState == EPlayerState::Disconnected)
+    {
+        logEntry << "Player " << id << " disconnected from match " << currentMatchId << "...";
+        logMsg = logEntry.str();
+    }
+
+    if (inState == EPlayerState::Rejoining)
+    {
+        logEntry << "Player " << id << " is reconnecting...";
+        logMsg = logEntry.str();
+    }
+
     // Records
     if (state != inState)
     {
-        auto now = std::chrono::steady_clock::now();
+        auto now = SimNow();
         auto durationInState = now - stateChangeTimeStamp;
 
         // record by cases
@@ -145,9 +205,33 @@ void VirtualPlayer::SetState(EPlayerState inState, std::string& logMsg)
         // finished recording, update to new state
         state = inState;
         stateChangeTimeStamp = now;
+        ++stateSerial;
     }
 }
 
+void VirtualPlayer::Serialize(FBinaryArchive& Ar)
+{
+    Ar << id << state << traits;
+    Ar << wonMatches << lostMatches;
+    Ar << currentIdleTime << winRate << rating << streak;
+    Ar << agr << fle << gri << end << ins << cre << pre;
+    Ar << stateChangeTimeStamp << totalOnlineTime << queueTimePair << gameTimePair;
+    Ar << bEndlessSession << sessionEndTime << stateSerial << sessionSerial << currentMatchId << partyLeaderId;
+    Ar << region << latencies << roles;
+}
+
+void VirtualPlayer::StartSession(float sessionLength)
+{
+    ++sessionSerial;
+    bEndlessSession = sessionLength <= 0.0f;
+    sessionEndTime = SimNow() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(sessionLength));
+}
+
+bool VirtualPlayer::IsSessionOver() const
+{
+    return !bEndlessSession && SimNow() >= sessionEndTime;
+}
+
 float VirtualPlayer::GetAvgQueueTime() const
 {
     int total = static_cast<int>(std::chrono::duration_cast<std::chrono::seconds>(queueTimePair.second).count());
@@ -205,9 +289,20 @@ std::string VirtualPlayer::TraitsToString() const
     return result.empty() ? "None" : result;
 }
 
+void VirtualPlayer::AssignRegion(int inRegion)
+{
+    region = inRegion;
+    latencies = GenerateLatencies(inRegion);
+}
+
+float VirtualPlayer::GetSecondsInState() const
+{
+    return std::chrono::duration<float>(SimNow() - stateChangeTimeStamp).count();
+}
+
 int VirtualPlayer::GetTimeInCurrentState_Sec() const
 {
-    return static_cast<int>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - stateChangeTimeStamp).count());
+    return static_cast<int>(std::chrono::duration_cast<std::chrono::seconds>(SimNow() - stateChangeTimeStamp).count());
 }
 
 // ===== FMath BEGIN =====
@@ -234,7 +329,12 @@ std::ostringstream FMatch::CreateTeamVersusMessage() const
     {
         for (size_t p = 0; p < teams[t].size(); ++p)
         {
-            logEntry << "[" << teams[t][p].GetId() << "]";
+            logEntry << "[" << teams[t][p].GetId();
+            if (t < teamRoles.size() && p < teamRoles[t].size())
+            {
+                logEntry << " " << GetRoleName(static_cast<int>(teamRoles[t][p]));
+            }
+            logEntry << "]";
             if (p < teams[t].size() - 1)
             {
                 logEntry << "&";
@@ -248,19 +348,19 @@ std::ostringstream FMatch::CreateTeamVersusMessage() const
     return logEntry;
 }
 
-void FMatch::StartMatch()
+void FMatch::StartMatch(float inDuration)
 {
-    // Set a unique randomized duration for each started match, this can be affected by game mode and player stats
-    matchDuration = RandomFloatWithAnchor(matchDuration, 1.5f);
-    matchStartTime = std::chrono::steady_clock::now();
+    matchDuration = inDuration;
+    matchStartTime = SimNow();
     state = EMatchState::Ongoing;
 }
 
-void FMatch::EndMatch()
+void FMatch::EndMatch(int inWinningTeamIndex)
 {
-    if (teams.size() > 1)
+    if (inWinningTeamIndex >= 0 && inWinningTeamIndex < static_cast<int>(teams.size()))
     {
-        winningTeam = teams[RandomInt(0,static_cast<int>(teams.size()) - 1)];
+        winningTeamIndex = inWinningTeamIndex;
+        winningTeam = teams[winningTeamIndex];
     }
     state = EMatchState::Completed;
 }
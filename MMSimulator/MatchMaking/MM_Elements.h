@@ -1,10 +1,16 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <chrono>
 #include <string>
 
+#include "PlayStyle.h"
 #include "PlayerTrait.h"
+#include "Region.h"
+#include "Role.h"
+
+class FBinaryArchive;
 
 // ===== VIRTUAL PLAYER BEGIN =====
 
@@ -30,6 +36,36 @@ public:
     void RegisterMatchResult(int matchId, bool bIsWon);
     void UpdateWinRate();
     void SetState(EPlayerState inState, std::string& logMsg);
+    void Serialize(FBinaryArchive& Ar); // checkpoint save / load
+
+    // Sessions: a player logs out at the first idle moment after the session is over, a length <= 0 never ends
+    void StartSession(float sessionLength);
+    bool IsSessionOver() const;
+
+    // Serials invalidate timed events scheduled for an earlier state or session
+    uint32_t GetStateSerial() const { return stateSerial; }
+    uint32_t GetSessionSerial() const { return sessionSerial; }
+    int GetCurrentMatchId() const { return currentMatchId; }
+    void SetCurrentMatchId(int matchId) { currentMatchId = matchId; }
+
+    // Parties queue and play together under their leader's id, solo players have no leader
+    bool IsInParty() const { return partyLeaderId >= 0; }
+    bool IsPartyLeader() const { return partyLeaderId == id; }
+    int GetPartyLeaderId() const { return partyLeaderId; }
+    void SetPartyLeaderId(int leaderId) { partyLeaderId = leaderId; }
+
+    // Geography: the region the player lives in and the round trip time to every data center
+    void AssignRegion(int inRegion);
+    int GetRegion() const { return region; }
+    int GetLatency(int dataCenter) const { return latencies[dataCenter]; }
+
+    // Roles the player is willing to fill, role queues can put them into any of these
+    FRoleMask GetRoles() const { return roles; }
+    void SetRoles(FRoleMask inRoles) { roles = inRoles; }
+
+    // Play style: the seven stats as derived from the traits
+    FPlayStyle GetPlayStyle() const;
+    void DerivePlayStyle(); // PlayStyleBase plus the modifiers of every trait the player has, clamped to [0, MaxPlayStyleStat]
 
     // information & getters
     float GetAvgQueueTime() const;
@@ -42,7 +78,12 @@ public:
     std::vector<int> GetWonMatches() const { return wonMatches; }
     std::vector<int> GetLostMatches() const { return lostMatches; }
     float GetWinRate() const { return winRate; }
+    int GetStreak() const { return streak; } // consecutive wins (> 0) or losses (< 0)
+    int GetMatchesPlayed() const { return static_cast<int>(wonMatches.size() + lostMatches.size()); }
+    float GetRating() const { return rating; }
+    void SetRating(float inRating) { rating = inRating; }
     float GetCurrentIdleTime() const { return currentIdleTime; }
+    float GetSecondsInState() const; // e.g. the queue time so far while InQueue
 
     // Trait management
     static EPlayerTrait GenerateRandomTraits();
@@ -66,6 +107,8 @@ private:
     // idle time: time when player stays online but not in queue
     float currentIdleTime = 0.0f;
     float winRate = 0.0f;
+    float rating = 1500.0f; // Elo, updated from match results
+    int streak = 0;
 
     // Quantified play style
     int agr = 0; // Aggressiveness - Willingness to take risks and engage in high-pressure plays
@@ -78,10 +121,20 @@ private:
     
     // time when last state changed. Use this to record player activity history
     std::chrono::steady_clock::time_point stateChangeTimeStamp;
-    std::chrono::steady_clock::duration totalOnlineTime;
+    std::chrono::steady_clock::duration totalOnlineTime{};
     std::pair<int, std::chrono::steady_clock::duration> queueTimePair;
     std::pair<int, std::chrono::steady_clock::duration> gameTimePair;
 
+    bool bEndlessSession = true;
+    std::chrono::steady_clock::time_point sessionEndTime;
+    uint32_t stateSerial = 0;
+    uint32_t sessionSerial = 0;
+    int currentMatchId = -1; // the match the player belongs to until it ends, even while disconnected
+    int partyLeaderId = -1;
+    int region = 0;
+    FLatencyVector latencies{};
+    FRoleMask roles = AllRoles;
+
     int GetTimeInCurrentState_Sec() const;
     std::chrono::steady_clock::time_point SetNextRejoiningTime();
 };
@@ -104,12 +157,17 @@ struct FMatch
     // general information
     int matchId = -1;
     std::vector<std::vector<VirtualPlayer>> teams; // supports multiple team and uneven player counts on each team
+    std::vector<std::vector<ERole>> teamRoles; // role of every team member when formed from role queues, empty otherwise
+    int dataCenter = 0; // region hosting the match
     std::chrono::steady_clock::time_point matchStartTime;
     float matchDuration = 3.0f;
     EMatchState state = EMatchState::Initiated;
+    std::vector<int> roundScores; // rounds each team took when the match was played out in rounds, empty otherwise
+    std::vector<float> predictedChances; // win chance of each team as the match formed, empty without the win predictor
 
     // end of match info
     std::vector<VirtualPlayer> winningTeam;
+    int winningTeamIndex = -1;
 
     // display
     std::ostringstream CreateMatchStartMessage() const;
@@ -117,8 +175,8 @@ struct FMatch
     std::ostringstream CreateTeamVersusMessage() const;
 
     // Process
-    void StartMatch();
-    void EndMatch();
+    void StartMatch(float inDuration); // seconds
+    void EndMatch(int inWinningTeamIndex); // -1 for no winner
     
     bool IsPlayerWinner(int playerId) const;
     std::string StateToString() const;
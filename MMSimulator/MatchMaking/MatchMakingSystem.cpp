@@ -3,183 +3,1878 @@
 #include <iomanip>
 #include <sstream>
 #include <algorithm>
+#include <cmath>
 #include <numeric>
+#include <type_traits>
 
+#include "BinaryArchive.h"
 #include "MM_Elements.h"
-#include "../D3DHelper.h"
+#include "Profiler.h"
+#include "RandomGenerator.h"
+#include "ReplayRecorder.h"
+
+namespace
+{
+    // checkpoint file header, bump the version whenever the serialized layout changes
+    constexpr uint32_t CheckpointMagic = 0x50434D4D; // "MMCP"
+    constexpr uint32_t CheckpointVersion = 22;
+
+    // simulated time over which the achieved formation rate is averaged
+    constexpr float RateWindowSeconds = 2.0f;
+
+    // backlog counts stop here, so reporting a login storm stays cheap
+    constexpr size_t BacklogCountLimit = 100000;
+
+    // a widening event due at a step boundary can read the time in queue as a hair short of it
+    constexpr float WindowStepTolerance = 1e-3f;
+
+    // solo players of a queue looked at per backfill pass
+    constexpr int MaxBackfillScan = 256;
+
+    // results the win predictor's recent log loss and accuracy average over
+    constexpr double PredictorWindow = 100.0;
+
+    FOutcomePlayer MakeOutcomePlayer(const VirtualPlayer& player)
+    {
+        FOutcomePlayer outcomePlayer;
+        outcomePlayer.rating = player.GetRating();
+        outcomePlayer.style = player.GetPlayStyle();
+        outcomePlayer.traits = player.GetTraits();
+        outcomePlayer.streak = player.GetStreak();
+        outcomePlayer.matchesPlayed = player.GetMatchesPlayed();
+        outcomePlayer.bInParty = player.IsInParty();
+        outcomePlayer.bPartyLeader = player.IsPartyLeader();
+        return outcomePlayer;
+    }
+
+    FMatchEnd MakeMatchEnd(const FMatch& match)
+    {
+        FMatchEnd matchEnd;
+        matchEnd.matchId = match.matchId;
+        matchEnd.endTime = match.matchStartTime +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(match.matchDuration));
+        return matchEnd;
+    }
+
+    std::chrono::steady_clock::time_point MakeDeadline(std::chrono::steady_clock::time_point start, float budgetMs)
+    {
+        if (budgetMs <= 0.0f)
+        {
+            return std::chrono::steady_clock::time_point::max();
+        }
+        return start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float, std::milli>(budgetMs));
+    }
+}
+
+void FMatchSetting::Serialize(FBinaryArchive& Ar)
+{
+    Ar << numTeams << teamSize << matchDuration << matchesPerCycle;
+    Ar << bAdaptiveScheduling << cycleBudgetMs << minCycleDelay << maxCycleDelay;
+    Ar << updateBudgetMs;
+    Ar << teamBalancing << bBalancingLocalSearch;
+    Ar << bRegionSharding << spilloverWait << maxSpilloverLatency;
+    Ar << formation << ratingBucketWidth << searchWindow << searchWindowGrowth << searchWindowInterval << maxSearchWindow;
+    Ar << roleComposition;
+    Ar << batchWindowMs << batchLatencyWeight << batchMaxCost << batchCostGrowth << batchBudgetMs << batchThreads;
+    Ar << playStyleDistance;
+    Ar << bBackfill << backfillGrace << backfillRatingWindow << backfillMinRemaining;
+    Ar << bOutcomeModel;
+    Ar << bRoundSimulation << roundsToWin << roundThreads;
+    Ar << bWinPredictor << predictorLearningRate << bBalanceByPrediction;
+    Ar << ratingSystem << ratingPeriodSeconds << ratingThreads;
+    Ar << bAvoidRematches << rematchGraceSeconds;
+    Ar << waitSloSeconds;
+}
 
 MatchMakingSystem::MatchMakingSystem()
 {
-    matchLog.reserve(1000);
-    playerLog.reserve(1000);
+    matchLog.reserve(1000);
+    playerLog.reserve(1000);
+    replayWorkLimits.fill(-1);
+    rateWindowStart = SimNow();
+    lastRatingPeriod = SimNow();
+    for (FPartyQueue& queue : regionQueues)
+    {
+        queue.SetRatingIndex(UsesRatingIndex(MatchSetting.formation));
+        queue.SetRoleIndex(UsesRoleIndex(MatchSetting.formation));
+        queue.SetStyleIndex(UsesStyleIndex(MatchSetting.formation));
+    }
+}
+
+void MatchMakingSystem::Update()
+{
+    MM_PROFILE_SCOPE("Update");
+    simClock.Tick();
+    if (replayRecorder)
+    {
+        replayRecorder->RecordTick(SimNow() - lastUpdateTime);
+    }
+    lastUpdateTime = SimNow();
+
+    // every phase below stops at the shared deadline and resumes from where it left off on the next call
+    auto updateStart = std::chrono::steady_clock::now();
+    updateDeadline = MakeDeadline(updateStart, MatchSetting.updateBudgetMs);
+
+    Update_Arrivals();
+    Update_PlayerEvents();
+    Update_Matches();
+    Update_RatingPeriod();
+
+    // The main system function, runs periodically
+    Update_Matchmake(MatchSetting.bAdaptiveScheduling ? cycleDelay : matchMakingSystemDelay);
+
+    updateDeadline = std::chrono::steady_clock::time_point::max();
+    updateBacklog.lastUpdateMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - updateStart).count();
+    if (updateBacklog.playerEvents > 0 || updateBacklog.matchEnds > 0 || updateBacklog.matchmakeMatches > 0 || updateBacklog.arrivalLagMs > 0.0f)
+    {
+        ++updateBacklog.slicedUpdates;
+    }
+
+    // replay work limits only apply to the tick they were recorded in
+    replayWorkLimits.fill(-1);
+}
+
+void MatchMakingSystem::CreatePlayer()
+{
+    if (replayRecorder)
+    {
+        replayRecorder->RecordCreatePlayer();
+    }
+
+    LogInPlayer(AddNewPlayer(), 0.0f);
+}
+
+VirtualPlayer& MatchMakingSystem::AddNewPlayer(int region)
+{
+    int id = nextPlayerId++;
+    VirtualPlayer& player = allPlayersLookupMap.emplace(id, VirtualPlayer(id)).first->second;
+    ratingTable.AddPlayer(ratingModel);
+    recentOpponents.AddPlayer();
+    player.AssignRegion(region >= 0 ? region : SampleRegion(ArrivalSetting.regionWeights));
+    return player;
+}
+
+void MatchMakingSystem::LogInPlayer(VirtualPlayer& player, float sessionLength)
+{
+    player.StartSession(sessionLength);
+    if (sessionLength > 0.0f)
+    {
+        SchedulePlayerEvent(player, EPlayerEvent::SessionEnd, sessionLength);
+    }
+    ++numOnlinePlayers;
+    SetPlayerIdle(player);
+}
+
+void MatchMakingSystem::LogOutPlayer(VirtualPlayer& player)
+{
+    int playerId = player.GetId();
+    if (player.IsInParty())
+    {
+        DisbandParty(player.GetPartyLeaderId());
+    }
+    RemoveQueuedParty(playerId);
+
+    std::string log;
+    player.SetState(EPlayerState::Offline, log);
+    RecordToLog(playerLog, log);
+    --numOnlinePlayers;
+    ++numDepartures;
+    offlinePlayerIds.push_back(playerId);
+
+    // pending events of an offline player are dropped when they come due, because the player is no longer active.
+    // Timestamps are stored against a fixed reference, they are all reset when the player logs back in
+    FBinaryArchive Ar = FBinaryArchive::ForSaving();
+    Ar.SetReferenceTime(std::chrono::steady_clock::time_point());
+    player.Serialize(Ar);
+    std::vector<char> blob = Ar.TakeData();
+    blob.shrink_to_fit();
+    coldStorageBytes += blob.size();
+    coldPlayers[playerId] = std::move(blob);
+    allPlayersLookupMap.erase(playerId);
+}
+
+VirtualPlayer* MatchMakingSystem::RestoreFromColdStorage(int playerId)
+{
+    auto coldIt = coldPlayers.find(playerId);
+    if (coldIt == coldPlayers.end())
+    {
+        return nullptr;
+    }
+    coldStorageBytes -= coldIt->second.size();
+    FBinaryArchive Ar = FBinaryArchive::ForLoading(std::move(coldIt->second));
+    Ar.SetReferenceTime(std::chrono::steady_clock::time_point());
+    coldPlayers.erase(coldIt);
+
+    VirtualPlayer player;
+    player.Serialize(Ar);
+    return &allPlayersLookupMap.insert_or_assign(playerId, std::move(player)).first->second;
+}
+
+void MatchMakingSystem::FormParty(const std::vector<int>& memberIds)
+{
+    if (memberIds.size() < 2)
+    {
+        return;
+    }
+    for (int memberId : memberIds)
+    {
+        auto it = allPlayersLookupMap.find(memberId);
+        if (it != allPlayersLookupMap.end())
+        {
+            it->second.SetPartyLeaderId(memberIds[0]);
+        }
+    }
+    parties[memberIds[0]] = memberIds;
+}
+
+void MatchMakingSystem::DisbandParty(int leaderId)
+{
+    auto partyIt = parties.find(leaderId);
+    if (partyIt == parties.end())
+    {
+        return;
+    }
+    std::vector<int> memberIds = std::move(partyIt->second);
+    parties.erase(partyIt);
+    bool bWasQueued = RemoveQueuedParty(leaderId);
+
+    for (int memberId : memberIds)
+    {
+        auto it = allPlayersLookupMap.find(memberId);
+        if (it == allPlayersLookupMap.end())
+        {
+            continue;
+        }
+        VirtualPlayer& member = it->second;
+        member.SetPartyLeaderId(-1);
+
+        // queued members keep their place in line as solo players, idle members get a JoinQueue event of their own
+        // because the one they had may have been skipped while they followed the leader
+        if (bWasQueued && member.GetState() == EPlayerState::InQueue)
+        {
+            QueueParty(memberId, 1);
+            if (memberId != leaderId)
+            {
+                ScheduleAbandonment(member);
+            }
+        }
+        else if (member.GetState() == EPlayerState::Online)
+        {
+            SchedulePlayerEvent(member, EPlayerEvent::JoinQueue, member.GetCurrentIdleTime());
+        }
+    }
+}
+
+void MatchMakingSystem::EnqueueParty(VirtualPlayer& leader)
+{
+    std::string log;
+    auto partyIt = parties.find(leader.GetId());
+    if (partyIt == parties.end())
+    {
+        leader.SetState(EPlayerState::InQueue, log);
+        RecordToLog(playerLog, log);
+        QueueParty(leader.GetId(), 1);
+        ScheduleAbandonment(leader);
+        return;
+    }
+
+    // a party that can't fit in one team would never be matched, its members queue on their own instead. Role queues only
+    // place solo players
+    const std::vector<int>& memberIds = partyIt->second;
+    if (static_cast<int>(memberIds.size()) > MatchSetting.teamSize || MatchSetting.formation == EMatchFormation::Roles)
+    {
+        ++matchmakingStats.splitParties;
+        DisbandParty(leader.GetId());
+        EnqueueParty(leader);
+        return;
+    }
+
+    // the party queues as one entry once every member is idle, the leader waits another idle period otherwise
+    for (int memberId : memberIds)
+    {
+        auto it = allPlayersLookupMap.find(memberId);
+        if (it == allPlayersLookupMap.end() || it->second.GetState() != EPlayerState::Online)
+        {
+            SchedulePlayerEvent(leader, EPlayerEvent::JoinQueue, std::max(leader.GetCurrentIdleTime(), 1.0f));
+            return;
+        }
+    }
+    for (int memberId : memberIds)
+    {
+        allPlayersLookupMap.find(memberId)->second.SetState(EPlayerState::InQueue, log);
+        RecordToLog(playerLog, log);
+    }
+    QueueParty(leader.GetId(), static_cast<int>(memberIds.size()));
+    ScheduleAbandonment(leader);
+}
+
+void MatchMakingSystem::QueueParty(int leaderId, int partySize)
+{
+    auto leaderIt = allPlayersLookupMap.find(leaderId);
+    if (leaderIt == allPlayersLookupMap.end())
+    {
+        return;
+    }
+    if (leaderId >= static_cast<int>(queuedPartyInfo.size()))
+    {
+        queuedPartyInfo.resize(std::max(static_cast<size_t>(leaderId) + 1, queuedPartyInfo.size() * 2));
+    }
+
+    // members of a disbanded party queue on with the window they already waited for
+    FQueuedParty& info = queuedPartyInfo[leaderId];
+    int homeRegion = MatchSetting.bRegionSharding ? GetBestDataCenter(leaderId) : 0;
+    info.homeRegion = static_cast<int8_t>(homeRegion);
+    info.size = static_cast<uint8_t>(partySize);
+    info.rating = GetPartyRating(leaderId);
+    const bool bSearchWindows = MatchSetting.formation == EMatchFormation::SkillWindows;
+    info.searchWindow = bSearchWindows ? GetSearchWindow(leaderIt->second.GetSecondsInState()) : FPartyQueue::AnyRating;
+    info.roles = leaderIt->second.GetRoles();
+    info.style = GetPartyPlayStyle(leaderId);
+    regionQueues[homeRegion].Enqueue(leaderId, partySize, info.rating, info.searchWindow, info.roles, info.style);
+    numQueuedPlayers += partySize;
+    ++numQueuedParties;
+    for (int role = 0; role < NumRoles && partySize == 1; ++role)
+    {
+        numQueuedByRole[role] += (info.roles & GetRoleBit(role)) ? 1 : 0;
+    }
+
+    if (MatchSetting.bRegionSharding)
+    {
+        SchedulePlayerEvent(leaderIt->second, EPlayerEvent::Spillover, std::max(MatchSetting.spilloverWait, 0.0f));
+    }
+    if (bSearchWindows)
+    {
+        ScheduleWindowWidening(leaderIt->second, info.searchWindow);
+    }
+}
+
+bool MatchMakingSystem::RemoveQueuedParty(int leaderId)
+{
+    if (leaderId < 0 || leaderId >= static_cast<int>(queuedPartyInfo.size()) || queuedPartyInfo[leaderId].homeRegion < 0)
+    {
+        return false;
+    }
+    for (FPartyQueue& queue : regionQueues)
+    {
+        queue.Remove(leaderId);
+    }
+    const FQueuedParty& info = queuedPartyInfo[leaderId];
+    numQueuedPlayers -= info.size;
+    --numQueuedParties;
+    for (int role = 0; role < NumRoles && info.size == 1; ++role)
+    {
+        numQueuedByRole[role] -= (info.roles & GetRoleBit(role)) ? 1 : 0;
+    }
+    queuedPartyInfo[leaderId] = FQueuedParty();
+    return true;
+}
+
+void MatchMakingSystem::SpillOver(VirtualPlayer& leader)
+{
+    const int leaderId = leader.GetId();
+    if (!MatchSetting.bRegionSharding || leaderId >= static_cast<int>(queuedPartyInfo.size()) || queuedPartyInfo[leaderId].homeRegion < 0)
+    {
+        return;
+    }
+
+    // the n-th spillover is due after n waits, so duplicate events from a disbanded party can't make it spill early
+    int numQueues = 0;
+    int nextRegion = -1;
+    int nextLatency = 0;
+    for (int region = 0; region < NumRegions; ++region)
+    {
+        if (regionQueues[region].Contains(leaderId))
+        {
+            ++numQueues;
+            continue;
+        }
+        int latency = GetPartyLatency(leaderId, region);
+        if (latency <= MatchSetting.maxSpilloverLatency && (nextRegion < 0 || latency < nextLatency))
+        {
+            nextRegion = region;
+            nextLatency = latency;
+        }
+    }
+    if (nextRegion < 0)
+    {
+        return;
+    }
+
+    const float wait = std::max(MatchSetting.spilloverWait, 0.001f);
+    float dueIn = wait * static_cast<float>(numQueues) - leader.GetSecondsInState();
+    if (dueIn <= 0.0f)
+    {
+        const FQueuedParty& info = queuedPartyInfo[leaderId];
+        regionQueues[nextRegion].Enqueue(leaderId, info.size, info.rating, info.searchWindow, info.roles, info.style);
+        dueIn = wait;
+    }
+    SchedulePlayerEvent(leader, EPlayerEvent::Spillover, dueIn);
+}
+
+void MatchMakingSystem::ScheduleAbandonment(const VirtualPlayer& leader)
+{
+    // the leader's patience decides for the whole party
+    if (!ArrivalSetting.bQueueAbandonment)
+    {
+        return;
+    }
+    float patience = FArrivalProcess::SamplePatience(ArrivalSetting, leader.HasTrait(EPlayerTrait::Competitive));
+    SchedulePlayerEvent(leader, EPlayerEvent::Abandon, std::max(patience - leader.GetSecondsInState(), 0.0f));
+}
+
+void MatchMakingSystem::AbandonQueue(VirtualPlayer& leader)
+{
+    const int leaderId = leader.GetId();
+    if (leader.GetState() != EPlayerState::InQueue || !RemoveQueuedParty(leaderId))
+    {
+        return;
+    }
+    const float waitedSeconds = leader.GetSecondsInState();
+    ++numAbandonments;
+    totalAbandonSeconds += waitedSeconds;
+    ++numSloParties;
+    ++numSloBreaches;
+
+    // the members idle again and queue anew after their idle time, or log off if their session is over. A member logging off
+    // disbands the party, so the members are copied first
+    auto partyIt = parties.find(leaderId);
+    const std::vector<int> memberIds = partyIt != parties.end() ? partyIt->second : std::vector<int>{ leaderId };
+    for (int memberId : memberIds)
+    {
+        auto it = allPlayersLookupMap.find(memberId);
+        if (it != allPlayersLookupMap.end() && it->second.GetState() == EPlayerState::InQueue)
+        {
+            ++numAbandonedPlayers;
+            SetPlayerIdle(it->second);
+        }
+    }
+}
+
+void MatchMakingSystem::WidenSearchWindow(VirtualPlayer& leader)
+{
+    const int leaderId = leader.GetId();
+    if (MatchSetting.formation != EMatchFormation::SkillWindows || leaderId >= static_cast<int>(queuedPartyInfo.size()) || queuedPartyInfo[leaderId].homeRegion < 0)
+    {
+        return;
+    }
+
+    // the window follows the time spent waiting, so duplicate events from a disbanded party can't widen it twice
+    FQueuedParty& info = queuedPartyInfo[leaderId];
+    float window = GetSearchWindow(leader.GetSecondsInState());
+    if (window != info.searchWindow)
+    {
+        info.searchWindow = window;
+        for (FPartyQueue& queue : regionQueues)
+        {
+            queue.SetSearchWindow(leaderId, window);
+        }
+        ++matchmakingStats.windowWidenings;
+    }
+    ScheduleWindowWidening(leader, window);
+}
+
+void MatchMakingSystem::ScheduleWindowWidening(const VirtualPlayer& leader, float searchWindow)
+{
+    const float interval = MatchSetting.searchWindowInterval;
+    if (interval <= 0.0f || MatchSetting.searchWindowGrowth <= 0.0f || searchWindow >= MatchSetting.maxSearchWindow)
+    {
+        return;
+    }
+    float seconds = leader.GetSecondsInState();
+    float steps = std::floor(seconds / interval + WindowStepTolerance);
+    SchedulePlayerEvent(leader, EPlayerEvent::WidenWindow, std::max((steps + 1.0f) * interval - seconds, 0.0f));
+}
+
+float MatchMakingSystem::GetSearchWindow(float secondsInQueue) const
+{
+    // precomputed steps rather than continuous growth, so a window only changes when its event fires
+    const float maxWindow = std::max(MatchSetting.maxSearchWindow, MatchSetting.searchWindow);
+    if (MatchSetting.searchWindowInterval <= 0.0f)
+    {
+        return maxWindow;
+    }
+    float steps = std::floor(std::max(secondsInQueue, 0.0f) / MatchSetting.searchWindowInterval + WindowStepTolerance);
+    return std::min(MatchSetting.searchWindow + steps * std::max(MatchSetting.searchWindowGrowth, 0.0f), maxWindow);
+}
+
+float MatchMakingSystem::GetPartyRating(int leaderId) const
+{
+    auto partyIt = parties.find(leaderId);
+    if (partyIt == parties.end())
+    {
+        auto it = allPlayersLookupMap.find(leaderId);
+        return it != allPlayersLookupMap.end() ? it->second.GetRating() : 0.0f;
+    }
+    float total = 0.0f;
+    for (int memberId : partyIt->second)
+    {
+        auto it = allPlayersLookupMap.find(memberId);
+        total += it != allPlayersLookupMap.end() ? it->second.GetRating() : 0.0f;
+    }
+    return partyIt->second.empty() ? 0.0f : total / static_cast<float>(partyIt->second.size());
+}
+
+FPlayStyle MatchMakingSystem::GetPartyPlayStyle(int leaderId) const
+{
+    auto partyIt = parties.find(leaderId);
+    if (partyIt == parties.end())
+    {
+        auto it = allPlayersLookupMap.find(leaderId);
+        return it != allPlayersLookupMap.end() ? it->second.GetPlayStyle() : FPlayStyle{};
+    }
+    std::array<int, NumPlayStyleStats> totals{};
+    int numMembers = 0;
+    for (int memberId : partyIt->second)
+    {
+        auto it = allPlayersLookupMap.find(memberId);
+        if (it != allPlayersLookupMap.end())
+        {
+            const FPlayStyle memberStyle = it->second.GetPlayStyle();
+            for (int stat = 0; stat < NumPlayStyleStats; ++stat)
+            {
+                totals[stat] += memberStyle[stat];
+            }
+            ++numMembers;
+        }
+    }
+    FPlayStyle style{};
+    for (int stat = 0; stat < NumPlayStyleStats && numMembers > 0; ++stat)
+    {
+        style[stat] = static_cast<int8_t>((totals[stat] * 2 + numMembers) / (numMembers * 2));
+    }
+    return style;
+}
+
+void MatchMakingSystem::RebuildRegionQueues()
+{
+    // parties keep their order within each former queue
+    std::vector<std::pair<int, int>> queued;
+    for (int region = 0; region < NumRegions; ++region)
+    {
+        for (int leaderId : regionQueues[region].ToVector())
+        {
+            if (queuedPartyInfo[leaderId].homeRegion == region)
+            {
+                queued.emplace_back(leaderId, queuedPartyInfo[leaderId].size);
+            }
+        }
+    }
+    for (const std::pair<int, int>& entry : queued)
+    {
+        RemoveQueuedParty(entry.first);
+    }
+    for (const std::pair<int, int>& entry : queued)
+    {
+        QueueParty(entry.first, entry.second);
+        if (entry.second > 1 && MatchSetting.formation == EMatchFormation::Roles)
+        {
+            ++matchmakingStats.splitParties;
+            DisbandParty(entry.first);
+        }
+    }
+}
+
+int MatchMakingSystem::GetPartyLatency(int leaderId, int dataCenter) const
+{
+    auto partyIt = parties.find(leaderId);
+    if (partyIt == parties.end())
+    {
+        auto it = allPlayersLookupMap.find(leaderId);
+        return it != allPlayersLookupMap.end() ? it->second.GetLatency(dataCenter) : 0;
+    }
+    int latency = 0;
+    for (int memberId : partyIt->second)
+    {
+        auto it = allPlayersLookupMap.find(memberId);
+        if (it != allPlayersLookupMap.end())
+        {
+            latency = std::max(latency, it->second.GetLatency(dataCenter));
+        }
+    }
+    return latency;
+}
+
+int MatchMakingSystem::GetBestDataCenter(int leaderId) const
+{
+    int best = 0;
+    int bestLatency = GetPartyLatency(leaderId, 0);
+    for (int region = 1; region < NumRegions; ++region)
+    {
+        int latency = GetPartyLatency(leaderId, region);
+        if (latency < bestLatency)
+        {
+            best = region;
+            bestLatency = latency;
+        }
+    }
+    return best;
+}
+
+void MatchMakingSystem::SetPlayerIdle(VirtualPlayer& player)
+{
+    if (player.IsSessionOver())
+    {
+        LogOutPlayer(player);
+        return;
+    }
+
+    std::string log;
+    player.SetState(EPlayerState::Online, log);
+    RecordToLog(playerLog, log);
+    SchedulePlayerEvent(player, EPlayerEvent::JoinQueue, player.GetCurrentIdleTime());
+}
+
+void MatchMakingSystem::SchedulePlayerEvent(const VirtualPlayer& player, EPlayerEvent type, float delaySeconds)
+{
+    FPlayerEvent event;
+    event.time = SimNow() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(delaySeconds));
+    event.playerId = player.GetId();
+    event.serial = type == EPlayerEvent::SessionEnd ? player.GetSessionSerial() : player.GetStateSerial();
+    event.type = type;
+    playerEvents.push(event);
+}
+
+void MatchMakingSystem::ScheduleDisconnect(const VirtualPlayer& player, float remainingMatchTime)
+{
+    // time to the next disconnect is exponential, most players finish their match before it comes
+    if (ArrivalSetting.disconnectRate <= 0.0f)
+    {
+        return;
+    }
+    float timeToDisconnect = RandomExponential(ArrivalSetting.disconnectRate / 60.0f);
+    if (timeToDisconnect < remainingMatchTime)
+    {
+        SchedulePlayerEvent(player, EPlayerEvent::Disconnect, timeToDisconnect);
+    }
+}
+
+void MatchMakingSystem::HandlePlayerEvent(const FPlayerEvent& event)
+{
+    auto it = allPlayersLookupMap.find(event.playerId);
+    if (it == allPlayersLookupMap.end())
+    {
+        return;
+    }
+    VirtualPlayer& player = it->second;
+
+    // the state (or session) changed since the event was scheduled
+    uint32_t serial = event.type == EPlayerEvent::SessionEnd ? player.GetSessionSerial() : player.GetStateSerial();
+    if (event.serial != serial)
+    {
+        return;
+    }
+
+    std::string log;
+    switch (event.type)
+    {
+    case EPlayerEvent::JoinQueue:
+        // party members queue together with their leader
+        if (!player.IsInParty() || player.IsPartyLeader())
+        {
+            EnqueueParty(player);
+        }
+        break;
+
+    case EPlayerEvent::SessionEnd:
+        // players in a match log off once they become idle again
+        if (player.GetState() == EPlayerState::Online || player.GetState() == EPlayerState::InQueue)
+        {
+            LogOutPlayer(player);
+        }
+        break;
+
+    case EPlayerEvent::Disconnect:
+    {
+        player.SetState(EPlayerState::Disconnected, log);
+        RecordToLog(playerLog, log);
+        ++numDisconnects;
+
+        EPlayerEvent next = EPlayerEvent::ReconnectTimeout;
+        float delay = ArrivalSetting.reconnectWindow;
+        if (GetRandomResult(ArrivalSetting.reconnectChance))
+        {
+            float reconnectDelay = RandomExponential(1.0f / std::max(ArrivalSetting.meanReconnectDelay, 0.001f));
+            if (reconnectDelay < ArrivalSetting.reconnectWindow)
+            {
+                next = EPlayerEvent::Reconnect;
+                delay = reconnectDelay;
+            }
+        }
+        SchedulePlayerEvent(player, next, delay);
+        if (MatchSetting.bBackfill)
+        {
+            SchedulePlayerEvent(player, EPlayerEvent::ReleaseSlot, std::max(MatchSetting.backfillGrace, 0.0f));
+        }
+        break;
+    }
+
+    case EPlayerEvent::Reconnect:
+        // an open slot that wasn't filled yet is still the player's
+        backfillIndex.Close(player.GetId());
+        player.SetState(EPlayerState::Rejoining, log);
+        RecordToLog(playerLog, log);
+        ++numReconnects;
+        SchedulePlayerEvent(player, EPlayerEvent::ReconnectComplete, ArrivalSetting.reconnectLoadTime);
+        break;
+
+    case EPlayerEvent::ReconnectTimeout:
+        ++numReconnectTimeouts;
+        OpenBackfillSlot(player);
+        LogOutPlayer(player);
+        break;
+
+    case EPlayerEvent::Spillover:
+        SpillOver(player);
+        break;
+
+    case EPlayerEvent::WidenWindow:
+        WidenSearchWindow(player);
+        break;
+
+    case EPlayerEvent::ReleaseSlot:
+        OpenBackfillSlot(player);
+        break;
+
+    case EPlayerEvent::Abandon:
+        AbandonQueue(player);
+        break;
+
+    case EPlayerEvent::ReconnectComplete:
+    {
+        // back into the match if it is still running, it can disconnect again for the time that is left
+        auto matchIt = allMatchesLookupMap.find(player.GetCurrentMatchId());
+        if (matchIt != allMatchesLookupMap.end() && ongoingMatchIds.find(matchIt->first) != ongoingMatchIds.end())
+        {
+            player.SetState(EPlayerState::InGame, log);
+            float remaining = matchIt->second.matchDuration - std::chrono::duration<float>(SimNow() - matchIt->second.matchStartTime).count();
+            ScheduleDisconnect(player, remaining);
+        }
+        else
+        {
+            SetPlayerIdle(player);
+        }
+        break;
+    }
+    }
+}
+
+void MatchMakingSystem::SetArrivalSetting(const FArrivalSetting& Settings)
+{
+    ArrivalSetting = Settings;
+    arrivalProcess.Restart(ArrivalSetting, SimNow(), false);
+    if (replayRecorder)
+    {
+        replayRecorder->RecordArrivalSetting(ArrivalSetting);
+    }
+}
+
+FArrivalStats MatchMakingSystem::GetArrivalStats() const
+{
+    auto now = SimNow();
+    FArrivalStats stats;
+    stats.currentRate = arrivalProcess.IsActive() ? arrivalProcess.GetRate(ArrivalSetting, now) : 0.0f;
+    stats.timeOfDay = arrivalProcess.GetTimeOfDay(ArrivalSetting, now);
+    stats.onlinePlayers = numOnlinePlayers;
+    stats.offlinePlayers = static_cast<int>(offlinePlayerIds.size());
+    stats.arrivals = numArrivals;
+    stats.departures = numDepartures;
+    stats.disconnects = numDisconnects;
+    stats.reconnects = numReconnects;
+    stats.reconnectTimeouts = numReconnectTimeouts;
+    stats.abandonments = numAbandonments;
+    stats.abandonedPlayers = numAbandonedPlayers;
+    stats.avgAbandonSeconds = numAbandonments > 0 ? static_cast<float>(totalAbandonSeconds / static_cast<double>(numAbandonments)) : 0.0f;
+    stats.coldStorageBytes = coldStorageBytes;
+    return stats;
+}
+
+void MatchMakingSystem::SetMatchSetting(FMatchSetting Settings)
+{
+    // queued parties are placed and given windows again under the new rules
+    bool bRequeue = Settings.bRegionSharding != MatchSetting.bRegionSharding || Settings.formation != MatchSetting.formation
+        || Settings.searchWindow != MatchSetting.searchWindow || Settings.searchWindowGrowth != MatchSetting.searchWindowGrowth
+        || Settings.searchWindowInterval != MatchSetting.searchWindowInterval || Settings.maxSearchWindow != MatchSetting.maxSearchWindow;
+    MatchSetting = Settings;
+    if (!MatchSetting.bBackfill)
+    {
+        backfillIndex.Clear();
+    }
+    // a plan holds matches of the old shape
+    for (FBatchPlan& plan : batchPlans)
+    {
+        plan.Clear();
+    }
+    if (MatchSetting.formation == EMatchFormation::Roles)
+    {
+        MatchSetting.teamSize = std::max(GetCompositionSize(MatchSetting.roleComposition), 1);
+    }
+    if (bRequeue)
+    {
+        for (FPartyQueue& queue : regionQueues)
+        {
+            queue.SetRatingIndex(UsesRatingIndex(MatchSetting.formation));
+            queue.SetRoleIndex(UsesRoleIndex(MatchSetting.formation));
+            queue.SetStyleIndex(UsesStyleIndex(MatchSetting.formation));
+        }
+        RebuildRegionQueues();
+    }
+    if (replayRecorder)
+    {
+        replayRecorder->RecordMatchSetting(Settings);
+    }
+}
+
+void MatchMakingSystem::Update_Matchmake(const int& Interval)
+{
+    MM_PROFILE_SCOPE("Update_Matchmake");
+    auto now = SimNow();
+    const bool bResuming = matchmakeCarryOver > 0;
+    const bool bBatch = MatchSetting.formation == EMatchFormation::Batch;
+    const int interval = bBatch ? std::max(Interval, MatchSetting.batchWindowMs) : Interval;
+    if (!bResuming && std::chrono::duration_cast<std::chrono::milliseconds>(now - lastMatchmakingTime).count() < interval)
+    {
+        return;
+    }
+    
+    int startedMatches = 0;
+    bool bBudgetLimited = false;
+    const int playersPerMatch = MatchSetting.numTeams * MatchSetting.teamSize;
+
+    /*
+     * For every {matchMakingSystemDelay} ms, the system can handle initiating up to {matchesPerCycle} matches
+     * With adaptive scheduling the cycle is sized to the queue instead, and is sliced into {cycleBudgetMs} long runs
+     * A cycle that runs out of budget carries its remaining matches into the next call, ahead of the next interval
+     * Each match needs {numTeams} teams and {teamSize} players on each team
+     * Parties are packed into teams from the size buckets of the queue, anchored by the longest-waiting party (see FPartyQueue),
+     * then redistributed between the teams to even out their ratings (see FTeamBalancer)
+     * With region sharding each data center only packs its own queue, which also lists the parties that spilled over into it
+     * How a match is picked from a queue and which queues are visited are policies (see MatchmakingPolicy.h)
+     */
+    int maxMatches = matchmakeCarryOver;
+    if (!bResuming)
+    {
+        // a role the last cycle couldn't fill held matchmaking up until now
+        const double cycleSeconds = std::chrono::duration<double>(now - lastMatchmakingTime).count();
+        for (int role = 0; role < NumRoles; ++role)
+        {
+            roleStarvedSeconds[role] += (cycleMissingRoles & GetRoleBit(role)) ? cycleSeconds : 0.0;
+        }
+        cycleMissingRoles = 0;
+
+        lastMatchmakingTime = now;
+        ++matchmakingStats.totalCycles;
+        Update_Backfill();
+        maxMatches = MatchSetting.matchesPerCycle;
+        if (MatchSetting.bAdaptiveScheduling)
+        {
+            maxMatches = playersPerMatch > 0 ? numQueuedPlayers / playersPerMatch : 0;
+        }
+        if (bBatch)
+        {
+            SolveBatches();
+        }
+    }
+    auto deadline = updateDeadline;
+    if (MatchSetting.bAdaptiveScheduling)
+    {
+        deadline = std::min(deadline, MakeDeadline(std::chrono::steady_clock::now(), MatchSetting.cycleBudgetMs));
+    }
+
+    // the policies are resolved here, once per cycle, the loop forming the matches is compiled for each of them
+    WithFormation(MatchSetting.formation, [&](auto formation)
+    {
+        using TFormation = decltype(formation);
+        if constexpr (std::is_same_v<TFormation, FSkillBucketFormation>)
+        {
+            formation.bucketWidth = MatchSetting.ratingBucketWidth;
+        }
+        else if constexpr (std::is_same_v<TFormation, FRoleFormation>)
+        {
+            formation.composition = MatchSetting.roleComposition;
+        }
+        else if constexpr (std::is_same_v<TFormation, FBatchFormation>)
+        {
+            formation.queues = regionQueues.data();
+            formation.plans = batchPlans.data();
+        }
+        else if constexpr (std::is_same_v<TFormation, FPlayStyleFormation>)
+        {
+            formation.maxDistance = MatchSetting.playStyleDistance;
+        }
+        MatchmakeRegions(formation, maxMatches, deadline, startedMatches, bBudgetLimited);
+    });
+    if (!startingMatches.empty())
+    {
+        PlayRounds();
+    }
+
+    // back off while the queue can't fill a match, come back quickly while there is work
+    if (MatchSetting.bAdaptiveScheduling)
+    {
+        int minDelay = std::max(1, MatchSetting.minCycleDelay);
+        int maxDelay = std::max(minDelay, MatchSetting.maxCycleDelay);
+        // every queue was tried unless the budget ran out, so no match means none of them could be packed
+        if (startedMatches > 0 || bBudgetLimited)
+        {
+            cycleDelay = minDelay;
+        }
+        else
+        {
+            cycleDelay = std::clamp(cycleDelay * 2, minDelay, maxDelay);
+        }
+    }
+    else
+    {
+        cycleDelay = Interval;
+    }
+
+    // an interrupted cycle only ends when the queue can no longer fill a match
+    matchmakeCarryOver = 0;
+    if (bBudgetLimited && numQueuedPlayers >= playersPerMatch)
+    {
+        matchmakeCarryOver = maxMatches - startedMatches;
+        if (!bResuming)
+        {
+            ++matchmakingStats.budgetLimitedCycles;
+        }
+    }
+    updateBacklog.matchmakeMatches = matchmakeCarryOver;
+
+    matchmakingStats.lastCycleMatches = bResuming ? matchmakingStats.lastCycleMatches + startedMatches : startedMatches;
+
+    rateWindowMatches += startedMatches;
+    float windowSeconds = std::chrono::duration<float>(now - rateWindowStart).count();
+    if (windowSeconds >= RateWindowSeconds)
+    {
+        matchmakingStats.achievedRate = static_cast<float>(rateWindowMatches) / windowSeconds;
+        rateWindowMatches = 0;
+        rateWindowStart = now;
+    }
+}
+
+template <typename TFormation>
+void MatchMakingSystem::MatchmakeRegions(const TFormation& formation, int maxMatches, std::chrono::steady_clock::time_point deadline, int& startedMatches, bool& bBudgetLimited)
+{
+    if (MatchSetting.bRegionSharding)
+    {
+        MatchmakeQueues<TFormation, FRegionShardPolicy>(formation, maxMatches, deadline, startedMatches, bBudgetLimited);
+    }
+    else
+    {
+        MatchmakeQueues<TFormation, FGlobalQueuePolicy>(formation, maxMatches, deadline, startedMatches, bBudgetLimited);
+    }
+}
+
+template <typename TFormation, typename TRegions>
+void MatchMakingSystem::MatchmakeQueues(const TFormation& formation, int maxMatches, std::chrono::steady_clock::time_point deadline, int& startedMatches, bool& bBudgetLimited)
+{
+    const int playersPerMatch = MatchSetting.numTeams * MatchSetting.teamSize;
+    std::vector<std::vector<int>> teamLeaders;
+    int attempts = 0; // a failed pack moves on to the next region without forming, replays cut by attempts so they stop at the same check
+    rematchGuard.Bind(&recentOpponents, &parties);
+
+    // with sharding every data center forms matches from its own queue, the starting region rotates so a small cap doesn't favor one region
+    for (int visited = 0; visited < TRegions::NumQueues && startedMatches < maxMatches && !bBudgetLimited; ++visited)
+    {
+        const int region = TRegions::bSharded ? (matchmakeRegion + visited) % NumRegions : 0;
+        FPartyQueue& queue = regionQueues[region];
+        queue.SetRematchGuard(MatchSetting.bAvoidRematches ? &rematchGuard : nullptr);
+        auto regionStart = std::chrono::steady_clock::now();
+        while (startedMatches < maxMatches && static_cast<int>(queue.NumPlayers()) >= playersPerMatch)
+        {
+            // always form at least one match so a tight budget can't stall the queue
+            if (startedMatches > 0 && IsOverBudget(EUpdatePhase::Matchmake, attempts, deadline))
+            {
+                bBudgetLimited = true;
+                matchmakeRegion = region;
+                break;
+            }
+            ++attempts;
+            bool bFormed = formation.FormTeams(queue, MatchSetting.numTeams, MatchSetting.teamSize, teamLeaders);
+            if (!bFormed && MatchSetting.bAvoidRematches)
+            {
+                // the longest waiting party has waited out the grace period, a rematch beats waiting any longer
+                const int oldestId = queue.GetOldestLeader();
+                auto oldestIt = allPlayersLookupMap.find(oldestId);
+                if (oldestIt != allPlayersLookupMap.end() && oldestIt->second.GetSecondsInState() >= MatchSetting.rematchGraceSeconds)
+                {
+                    queue.SetRematchGuard(nullptr);
+                    bFormed = formation.FormTeams(queue, MatchSetting.numTeams, MatchSetting.teamSize, teamLeaders);
+                    queue.SetRematchGuard(&rematchGuard);
+                    numRematchFallbacks += bFormed ? 1 : 0;
+                }
+            }
+            if (!bFormed)
+            {
+                if constexpr (TFormation::bRoleIndex)
+                {
+                    const FRoleMask missingRoles = queue.GetMissingRoles();
+                    for (int role = 0; role < NumRoles; ++role)
+                    {
+                        matchmakingStats.roleMisses[role] += (missingRoles & GetRoleBit(role)) ? 1 : 0;
+                    }
+                    cycleMissingRoles |= missingRoles;
+                }
+                else if constexpr (TFormation::bStyleIndex)
+                {
+                    ++matchmakingStats.styleMisses;
+                }
+                else
+                {
+                    ++(TFormation::bRatingIndex ? matchmakingStats.ratingMisses : matchmakingStats.packingFailures);
+                }
+                break;
+            }
+            FormMatch(teamLeaders, TRegions::bSharded ? region : GetLowestLatencyDataCenter(teamLeaders));
+            ++startedMatches;
+        }
+        regionStats[region].cpuMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - regionStart).count();
+    }
+    if (TRegions::bSharded && !bBudgetLimited)
+    {
+        matchmakeRegion = (matchmakeRegion + 1) % NumRegions;
+    }
+}
+
+void MatchMakingSystem::SolveBatches()
+{
+    MM_PROFILE_SCOPE("SolveBatches");
+    auto solveStart = std::chrono::steady_clock::now();
+    const int numQueues = MatchSetting.bRegionSharding ? NumRegions : 1;
+    batchSolver.Reset(numQueues);
+    for (int region = 0; region < numQueues; ++region)
+    {
+        const FPartyQueue& queue = regionQueues[region];
+        std::vector<FBatchParty>& batch = batchSolver.GetParties(region);
+        batchSolver.SetHost(region, MatchSetting.bRegionSharding ? region : -1);
+        for (int partySize = 1; partySize <= FPartyQueue::MaxPartySize; ++partySize)
+        {
+            const FPlayerQueue& bucket = queue.GetBucket(partySize);
+            for (int leaderId = bucket.Front(); leaderId != FPlayerQueue::None; leaderId = bucket.Next(leaderId))
+            {
+                FBatchParty& party = batch.emplace_back();
+                party.leaderId = leaderId;
+                party.size = partySize;
+                party.rating = queue.GetRating(leaderId);
+                auto it = allPlayersLookupMap.find(leaderId);
+                party.waitSeconds = it != allPlayersLookupMap.end() ? it->second.GetSecondsInState() : 0.0f;
+                for (int dataCenter = 0; dataCenter < NumRegions; ++dataCenter)
+                {
+                    party.latencies[dataCenter] = static_cast<uint16_t>(GetPartyLatency(leaderId, dataCenter));
+                }
+            }
+        }
+    }
+
+    // the blocks a live solve reached depend on wall time, so a cut is recorded and replays solve the same blocks
+    const int recordedLimit = bReplayPlayback ? replayWorkLimits[static_cast<size_t>(EUpdatePhase::BatchSolve)] : -1;
+    auto deadline = bReplayPlayback ? std::chrono::steady_clock::time_point::max() : MakeDeadline(solveStart, MatchSetting.batchBudgetMs);
+    FBatchCost cost{ MatchSetting.batchLatencyWeight, MatchSetting.batchMaxCost, MatchSetting.batchCostGrowth };
+    const int solvedBlocks = batchSolver.Solve(MatchSetting.numTeams, MatchSetting.teamSize, cost, MatchSetting.batchThreads, deadline, recordedLimit, batchPlans.data());
+    if (solvedBlocks < batchSolver.GetNumBlocks())
+    {
+        numBatchBlocksCut += batchSolver.GetNumBlocks() - solvedBlocks;
+        if (replayRecorder && !bReplayPlayback)
+        {
+            replayRecorder->RecordWorkLimit(EUpdatePhase::BatchSolve, solvedBlocks);
+        }
+    }
+    ++numBatchSolves;
+    totalBatchSolveMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - solveStart).count();
 }
 
-void MatchMakingSystem::Update()
+void MatchMakingSystem::Update_Backfill()
 {
-    Update_RejoiningPlayers();
-    Update_Matches();
+    MM_PROFILE_SCOPE("Update_Backfill");
+    numExpiredSlots += backfillIndex.Expire(SimNow());
+    if (backfillIndex.Empty())
+    {
+        return;
+    }
 
-    // The main system function, runs periodically
-    Update_Matchmake(matchMakingSystemDelay);
+    // oldest solo players first. A sharded queue only fills the slots its own data center hosts, the global queue those of the
+    // data centers within maxSpilloverLatency of the player
+    const int numQueues = MatchSetting.bRegionSharding ? NumRegions : 1;
+    for (int region = 0; region < numQueues && !backfillIndex.Empty(); ++region)
+    {
+        const FPlayerQueue& solos = regionQueues[region].GetBucket(1);
+        int playerId = solos.Front();
+        for (int scanned = 0; scanned < MaxBackfillScan && playerId != FPlayerQueue::None && !backfillIndex.Empty(); ++scanned)
+        {
+            const int nextId = solos.Next(playerId);
+            auto it = allPlayersLookupMap.find(playerId);
+            if (it != allPlayersLookupMap.end())
+            {
+                VirtualPlayer& player = it->second;
+                int bestSlot = -1;
+                float bestGap = 0.0f;
+                for (int dataCenter = 0; dataCenter < NumRegions; ++dataCenter)
+                {
+                    if (MatchSetting.bRegionSharding ? dataCenter != region : player.GetLatency(dataCenter) > MatchSetting.maxSpilloverLatency)
+                    {
+                        continue;
+                    }
+                    float gap = 0.0f;
+                    int slotId = backfillIndex.FindSlot(dataCenter, player.GetRoles(), player.GetRating(), MatchSetting.backfillRatingWindow, gap);
+                    if (slotId >= 0 && (bestSlot < 0 || gap < bestGap))
+                    {
+                        bestSlot = slotId;
+                        bestGap = gap;
+                    }
+                }
+                if (bestSlot >= 0)
+                {
+                    FillSlot(*backfillIndex.GetSlot(bestSlot), player);
+                }
+            }
+            playerId = nextId;
+        }
+    }
 }
 
-void MatchMakingSystem::CreatePlayer()
+void MatchMakingSystem::OpenBackfillSlot(const VirtualPlayer& player)
+{
+    const int matchId = player.GetCurrentMatchId();
+    if (!MatchSetting.bBackfill || backfillIndex.GetSlot(player.GetId()) || ongoingMatchIds.find(matchId) == ongoingMatchIds.end())
+    {
+        return;
+    }
+    const FMatch& match = allMatchesLookupMap.find(matchId)->second;
+
+    // only worth filling while enough of the match is left
+    const float minRemaining = match.matchDuration * std::clamp(MatchSetting.backfillMinRemaining, 0.0f, 1.0f);
+    auto fillBy = MakeMatchEnd(match).endTime - std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(minRemaining));
+    if (SimNow() >= fillBy)
+    {
+        return;
+    }
+
+    for (size_t t = 0; t < match.teams.size(); ++t)
+    {
+        for (size_t p = 0; p < match.teams[t].size(); ++p)
+        {
+            if (match.teams[t][p].GetId() != player.GetId())
+            {
+                continue;
+            }
+            FOpenSlot slot;
+            slot.departedId = player.GetId();
+            slot.matchId = matchId;
+            slot.team = static_cast<int>(t);
+            slot.role = t < match.teamRoles.size() && p < match.teamRoles[t].size() ? static_cast<int>(match.teamRoles[t][p]) : -1;
+            slot.dataCenter = match.dataCenter;
+            slot.rating = player.GetRating();
+            slot.openTime = SimNow();
+            slot.fillBy = fillBy;
+            backfillIndex.Open(slot);
+            return;
+        }
+    }
+}
+
+void MatchMakingSystem::FillSlot(const FOpenSlot& slot, VirtualPlayer& player)
 {
-    int id = static_cast<int>(allPlayersLookupMap.size());
-    allPlayersLookupMap.emplace(id, VirtualPlayer(id));
+    // copied, the index entry goes away here
+    const FOpenSlot filled = slot;
+    backfillIndex.Close(filled.departedId);
+    auto matchIt = allMatchesLookupMap.find(filled.matchId);
+    if (matchIt == allMatchesLookupMap.end() || ongoingMatchIds.find(filled.matchId) == ongoingMatchIds.end())
+    {
+        return;
+    }
+    FMatch& match = matchIt->second;
+    std::vector<VirtualPlayer>& team = match.teams[filled.team];
+    auto placeIt = std::find_if(team.begin(), team.end(), [&filled](const VirtualPlayer& member) { return member.GetId() == filled.departedId; });
+    if (placeIt == team.end())
+    {
+        return;
+    }
+
+    // the player who left no longer belongs to the match, a later reconnect takes them back to idle
+    auto departedIt = allPlayersLookupMap.find(filled.departedId);
+    if (departedIt != allPlayersLookupMap.end())
+    {
+        departedIt->second.SetCurrentMatchId(-1);
+    }
 
-    VirtualPlayer& newP = allPlayersLookupMap.find(id)->second;
+    totalBackfillWait += std::chrono::duration<double>(SimNow() - filled.openTime).count();
+    totalBackfillGap += std::abs(player.GetRating() - filled.rating);
+    ++numBackfills;
 
     std::string log;
-    newP.SetState(EPlayerState::Online, log);
-    RecordToLog(playerLog, log);
+    RemoveQueuedParty(player.GetId());
+    player.SetState(EPlayerState::InGame, log);
+    player.SetCurrentMatchId(match.matchId);
+    *placeIt = player;
+    ScheduleDisconnect(player, std::chrono::duration<float>(MakeMatchEnd(match).endTime - SimNow()).count());
+    if (replayRecorder)
+    {
+        replayRecorder->RecordBackfill(match.matchId, filled.departedId, player.GetId());
+    }
 
-    AddPlayerToRejoiningQueue(&newP);
+    std::ostringstream logEntry;
+    logEntry << "Backfill [" << match.matchId << "]: [" << player.GetId() << "] for [" << filled.departedId << "]";
+    RecordToLog(matchLog, logEntry.str());
 }
 
-void MatchMakingSystem::Update_Matchmake(const int& Interval)
+int MatchMakingSystem::GetLowestLatencyDataCenter(const std::vector<std::vector<int>>& teamLeaders) const
 {
-    auto now = std::chrono::steady_clock::now();
-    if (std::chrono::duration_cast<std::chrono::milliseconds>(now - lastMatchmakingTime).count() < Interval)
+    int dataCenter = 0;
+    int bestLatency = 0;
+    for (int region = 0; region < NumRegions; ++region)
     {
-        return;
+        int latency = 0;
+        for (const std::vector<int>& leaderIds : teamLeaders)
+        {
+            for (int leaderId : leaderIds)
+            {
+                latency = std::max(latency, GetPartyLatency(leaderId, region));
+            }
+        }
+        if (region == 0 || latency < bestLatency)
+        {
+            bestLatency = latency;
+            dataCenter = region;
+        }
     }
-    lastMatchmakingTime = now;
-    
-    int startedMatches = 0;
-    std::vector<VirtualPlayer*> queuedPlayers;
+    return dataCenter;
+}
 
-    // only loop over known queued players
-    for (int playerId : queuedPlayerIDs)
+void MatchMakingSystem::FormMatch(const std::vector<std::vector<int>>& teamLeaders, int dataCenter)
+{
+    // the packed parties leave every queue they were in, spilled ones are still listed in their other data centers
+    float lowestRating = 0.0f;
+    float highestRating = 0.0f;
+    bool bFirstParty = true;
+    FPlayStyle firstStyle{};
+    double styleDistance = 0.0;
+    int numStyleParties = 0;
+    for (const std::vector<int>& leaderIds : teamLeaders)
     {
-        auto it = allPlayersLookupMap.find(playerId);
-        if (it != allPlayersLookupMap.end())
+        for (int leaderId : leaderIds)
+        {
+            if (leaderId >= 0 && leaderId < static_cast<int>(queuedPartyInfo.size()) && queuedPartyInfo[leaderId].homeRegion >= 0)
+            {
+                const FQueuedParty& info = queuedPartyInfo[leaderId];
+                lowestRating = bFirstParty ? info.rating : std::min(lowestRating, info.rating);
+                highestRating = bFirstParty ? info.rating : std::max(highestRating, info.rating);
+                firstStyle = bFirstParty ? info.style : firstStyle;
+                styleDistance += GetPlayStyleDistance(firstStyle, info.style);
+                ++numStyleParties;
+                bFirstParty = false;
+                if (info.searchWindow >= 0.0f)
+                {
+                    totalMatchedWindow += info.searchWindow;
+                    ++numWindowParties;
+                }
+            }
+            RemoveQueuedParty(leaderId);
+        }
+    }
+    totalRatingRange += highestRating - lowestRating;
+    if (numStyleParties > 1)
+    {
+        totalStyleDistance += styleDistance / static_cast<double>(numStyleParties - 1);
+        ++numStyleDistances;
+    }
+
+    {
+        MM_PROFILE_SCOPE("BalanceTeams");
+        // role packing lists each team role by role in composition order, the units keep their role through balancing
+        const bool bRoles = MatchSetting.formation == EMatchFormation::Roles;
+        const bool bPredictedStrength = MatchSetting.bWinPredictor && MatchSetting.bBalanceByPrediction;
+        balanceTeams.resize(teamLeaders.size());
+        for (size_t t = 0; t < teamLeaders.size(); ++t)
+        {
+            balanceTeams[t].clear();
+            int role = 0;
+            int roleSlot = 0;
+            for (int leaderId : teamLeaders[t])
+            {
+                while (bRoles && role < NumRoles && roleSlot >= MatchSetting.roleComposition[role])
+                {
+                    ++role;
+                    roleSlot = 0;
+                }
+                ++roleSlot;
+                FBalanceUnit& unit = balanceTeams[t].emplace_back();
+                unit.leaderId = leaderId;
+                unit.role = bRoles && role < NumRoles ? role : -1;
+                auto partyIt = parties.find(leaderId);
+                unit.size = partyIt != parties.end() ? static_cast<int>(partyIt->second.size()) : 1;
+                for (int memberIndex = 0; memberIndex < unit.size; ++memberIndex)
+                {
+                    auto it = allPlayersLookupMap.find(partyIt != parties.end() ? partyIt->second[memberIndex] : leaderId);
+                    if (it != allPlayersLookupMap.end())
+                    {
+                        unit.rating += bPredictedStrength ? winPredictor.GetPlayerStrength(MakeOutcomePlayer(it->second)) : it->second.GetRating();
+                    }
+                }
+            }
+        }
+        totalPackedSpread += FTeamBalancer::GetSpread(balanceTeams);
+        teamBalancer.Balance(MatchSetting.teamBalancing, MatchSetting.bBalancingLocalSearch, balanceTeams);
+        totalTeamSpread += FTeamBalancer::GetSpread(balanceTeams);
+        ++numBalancedMatches;
+    }
+
+    // queue time is read from the leaders before they change state
+    FRegionStats& stats = regionStats[dataCenter];
+    int matchLatency = 0;
+    bool bSpilled = false;
+    for (const std::vector<FBalanceUnit>& units : balanceTeams)
+    {
+        for (const FBalanceUnit& unit : units)
         {
-            queuedPlayers.emplace_back(&(it->second));
+            auto it = allPlayersLookupMap.find(unit.leaderId);
+            const float queueSeconds = it != allPlayersLookupMap.end() ? it->second.GetSecondsInState() : 0.0f;
+            regionWaitTotals[dataCenter] += queueSeconds;
+            ++regionMatchedParties[dataCenter];
+            ++numSloParties;
+            numSloBreaches += queueSeconds > MatchSetting.waitSloSeconds ? 1 : 0;
+            if (unit.role >= 0)
+            {
+                roleWaitTotals[unit.role] += queueSeconds;
+                ++roleMatchedPlayers[unit.role];
+            }
+            matchLatency = std::max(matchLatency, GetPartyLatency(unit.leaderId, dataCenter));
+            bSpilled |= MatchSetting.bRegionSharding && it != allPlayersLookupMap.end() && GetBestDataCenter(unit.leaderId) != dataCenter;
         }
     }
+    ++stats.matches;
+    stats.spilledMatches += bSpilled ? 1 : 0;
+    regionLatencyTotals[dataCenter] += matchLatency;
 
-    /*
-     * For every {matchMakingSystemDelay} ms, the system can handle initiating up to {matchesPerCycle} matches
-     * Each match needs {numTeams} teams and {teamSize} players on each team
-     * After each match is created, players are removed from queue and queuedPlayerIDs should be updated properly
-     */
-    for (int i = 0; i < MatchSetting.matchesPerCycle; ++i)
+    FMatch newMatch;
+    int id = static_cast<int>(allMatchesLookupMap.size());
+    auto addToTeam = [this, id](int playerId, std::vector<VirtualPlayer>& team)
     {
-        if (static_cast<int>(queuedPlayers.size()) < MatchSetting.numTeams * MatchSetting.teamSize)
+        auto it = allPlayersLookupMap.find(playerId);
+        if (it != allPlayersLookupMap.end())
         {
-            break;
+            std::string log;
+            team.emplace_back(it->second);
+            it->second.SetState(EPlayerState::InGame, log);
+            it->second.SetCurrentMatchId(id);
         }
+    };
 
-        FMatch newMatch;
-        
-        for (int t = 0; t < MatchSetting.numTeams; ++t)
+    if (MatchSetting.formation == EMatchFormation::Roles)
+    {
+        newMatch.teamRoles.resize(balanceTeams.size());
+    }
+    for (const std::vector<FBalanceUnit>& units : balanceTeams)
+    {
+        std::vector<VirtualPlayer> team;
+        for (const FBalanceUnit& unit : units)
         {
-            std::vector<VirtualPlayer> team;
-            for (int j = 0; j < MatchSetting.teamSize; ++j)
+            auto partyIt = parties.find(unit.leaderId);
+            if (partyIt == parties.end())
             {
-                if(VirtualPlayer* playerRef = queuedPlayers.back())
+                addToTeam(unit.leaderId, team);
+                if (unit.role >= 0)
                 {
-                    std::string log;
-                    team.emplace_back(*playerRef);
-                    playerRef->SetState(EPlayerState::InGame, log);
-                    
-                    //SetPlayerState(playerRef->GetId(), EPlayerState::InGame);
-                    queuedPlayerIDs.erase(playerRef->GetId());
-                    queuedPlayers.pop_back();
+                    newMatch.teamRoles[newMatch.teams.size()].push_back(static_cast<ERole>(unit.role));
                 }
+                continue;
+            }
+            for (int memberId : partyIt->second)
+            {
+                addToTeam(memberId, team);
             }
-            newMatch.teams.push_back(std::move(team));
         }
+        newMatch.teams.push_back(std::move(team));
+    }
+    numRematchMatches += IsRematch(newMatch) ? 1 : 0;
+
+    newMatch.matchId = id;
+    newMatch.dataCenter = dataCenter;
+    if (MatchSetting.bWinPredictor)
+    {
+        GetPredictorFeatures(newMatch);
+        newMatch.predictedChances.resize(newMatch.teams.size());
+        winPredictor.Predict(predictorTeams.data(), static_cast<int>(newMatch.teams.size()), newMatch.predictedChances.data());
+        totalPredictedFavorite += newMatch.predictedChances.empty() ? 0.0f : *std::max_element(newMatch.predictedChances.begin(), newMatch.predictedChances.end());
+        ++numPredictions;
+    }
+    allMatchesLookupMap.emplace(id, newMatch);
+
+    FMatch& matchRef = allMatchesLookupMap.find(id)->second;
+
+    // matches played out in rounds only know their duration once the cycle's matches have been played out together
+    if (MatchSetting.bRoundSimulation)
+    {
+        startingMatches.push_back(&matchRef);
+    }
+    else
+    {
+        const float duration = static_cast<float>(MatchSetting.matchDuration);
+        StartMatch(matchRef, RandomFloatWithAnchor(duration, duration * 0.5f));
+    }
+    if (replayRecorder)
+    {
+        replayRecorder->RecordMatchFormed(matchRef);
+    }
 
-        int id = static_cast<int>(allMatchesLookupMap.size());
-        newMatch.matchId = id;
-        allMatchesLookupMap.emplace(id, newMatch);
+    RecordToLog(matchLog, matchRef.CreateMatchStartMessage().str());
+}
 
-        FMatch& matchRef = allMatchesLookupMap.find(id)->second;
-        
-        matchRef.StartMatch();
-        ongoingMatchIds.insert(id);
-        
-        RecordToLog(matchLog, matchRef.CreateMatchStartMessage().str());
-        
-        ++startedMatches;
+void MatchMakingSystem::StartMatch(FMatch& match, float duration)
+{
+    match.StartMatch(duration);
+    ongoingMatchIds.insert(match.matchId);
+    matchEnds.push(MakeMatchEnd(match));
+    for (const std::vector<VirtualPlayer>& team : match.teams)
+    {
+        for (const VirtualPlayer& player : team)
+        {
+            auto it = allPlayersLookupMap.find(player.GetId());
+            if (it != allPlayersLookupMap.end())
+            {
+                ScheduleDisconnect(it->second, match.matchDuration);
+            }
+        }
     }
+    ++numStartedMatches;
+    totalMatchSeconds += match.matchDuration;
 }
 
-void MatchMakingSystem::Update_Matches()
+void MatchMakingSystem::PlayRounds()
 {
-    if (ongoingMatchIds.empty())
+    MM_PROFILE_SCOPE("PlayRounds");
+    auto roundsStart = std::chrono::steady_clock::now();
+
+    // team strengths from the outcome model, whether or not it decides the matches that aren't played out
+    outcomeBatch.Clear();
+    for (const FMatch* match : startingMatches)
     {
-        return;
+        AddOutcomeMatch(*match, outcomeBatch);
     }
+    outcomeBatch.Evaluate(outcomeModel);
 
-    auto now = std::chrono::steady_clock::now();
+    // a match that goes the distance plays every round but one of each team's winning count
+    const int roundsToWin = std::max(MatchSetting.roundsToWin, 1);
+    const float roundSeconds = static_cast<float>(MatchSetting.matchDuration) / static_cast<float>(roundsToWin * 2 - 1);
+    roundBatch.Clear();
+    for (size_t m = 0; m < startingMatches.size(); ++m)
+    {
+        // the seeds come from the shared generator in match order, the rounds themselves don't touch it
+        // stats above base: aggressiveness over the match, endurance and grit per team
+        const FMatch& match = *startingMatches[m];
+        float aggressiveness = 0.0f;
+        int numPlayers = 0;
+        for (const std::vector<VirtualPlayer>& team : match.teams)
+        {
+            for (const VirtualPlayer& player : team)
+            {
+                aggressiveness += static_cast<float>(player.GetPlayStyle()[0] - PlayStyleBase);
+                ++numPlayers;
+            }
+        }
+        roundBatch.AddMatch(rng.Next(), roundSeconds, aggressiveness / static_cast<float>(std::max(numPlayers, 1)));
+        for (size_t t = 0; t < match.teams.size(); ++t)
+        {
+            float endurance = 0.0f;
+            float grit = 0.0f;
+            for (const VirtualPlayer& player : match.teams[t])
+            {
+                const FPlayStyle style = player.GetPlayStyle();
+                endurance += static_cast<float>(style[3] - PlayStyleBase);
+                grit += static_cast<float>(style[2] - PlayStyleBase);
+            }
+            const float teamPlayers = static_cast<float>(std::max(match.teams[t].size(), static_cast<size_t>(1)));
+            roundBatch.AddTeam(outcomeBatch.GetTeamStrength(static_cast<int>(m), static_cast<int>(t)), endurance / teamPlayers, grit / teamPlayers);
+        }
+    }
+    roundBatch.Simulate(roundModel, roundsToWin, MatchSetting.roundThreads);
 
-    std::vector<FMatch*> queuedMatches;
-    for (int matchId : ongoingMatchIds)
+    for (size_t m = 0; m < startingMatches.size(); ++m)
     {
-        auto it = allMatchesLookupMap.find(matchId);
-        if (it != allMatchesLookupMap.end())
+        FMatch& match = *startingMatches[m];
+        const int batchIndex = static_cast<int>(m);
+        match.roundScores.resize(match.teams.size());
+        for (int t = 0; t < roundBatch.GetNumTeams(batchIndex); ++t)
         {
-            queuedMatches.emplace_back(&(it->second));
+            match.roundScores[t] = roundBatch.GetScore(batchIndex, t);
         }
+        totalRounds += roundBatch.GetRounds(batchIndex);
+        StartMatch(match, roundBatch.GetDuration(batchIndex));
     }
-    
-    for (FMatch* match : queuedMatches)
+    numRoundMatches += static_cast<int64_t>(startingMatches.size());
+    ++numRoundBatches;
+    totalRoundMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - roundsStart).count();
+    startingMatches.clear();
+}
+
+bool MatchMakingSystem::IsOverBudget(EUpdatePhase phase, int processed, std::chrono::steady_clock::time_point deadline)
+{
+    // wall time differs between runs, so a live cut is recorded and replays stop at the same amount of work
+    const int limit = replayWorkLimits[static_cast<size_t>(phase)];
+    if (bReplayPlayback)
+    {
+        return limit >= 0 && processed >= limit;
+    }
+    if (deadline == std::chrono::steady_clock::time_point::max() || std::chrono::steady_clock::now() < deadline)
+    {
+        return false;
+    }
+    if (replayRecorder)
+    {
+        replayRecorder->RecordWorkLimit(phase, processed);
+    }
+    return true;
+}
+
+FRegionStats MatchMakingSystem::GetRegionStats(int region) const
+{
+    FRegionStats stats = regionStats[region];
+    stats.queuedPlayers = static_cast<int>(regionQueues[region].NumPlayers());
+    if (regionMatchedParties[region] > 0)
+    {
+        stats.avgQueueSeconds = static_cast<float>(regionWaitTotals[region] / static_cast<double>(regionMatchedParties[region]));
+    }
+    if (stats.matches > 0)
+    {
+        stats.avgLatencyMs = static_cast<float>(regionLatencyTotals[region] / static_cast<double>(stats.matches));
+    }
+    return stats;
+}
+
+FMatchmakingStats MatchMakingSystem::GetMatchmakingStats() const
+{
+    FMatchmakingStats stats = matchmakingStats;
+    stats.configuredCap = matchMakingSystemDelay > 0 ? static_cast<float>(MatchSetting.matchesPerCycle) * 1000.0f / static_cast<float>(matchMakingSystemDelay) : 0.0f;
+    stats.cycleDelay = cycleDelay;
+    stats.activeParties = static_cast<int>(parties.size());
+    stats.avgQueuedPartySize = numQueuedParties > 0 ? static_cast<float>(numQueuedPlayers) / static_cast<float>(numQueuedParties) : 0.0f;
+    if (numBalancedMatches > 0)
+    {
+        stats.avgPackedSpread = static_cast<float>(totalPackedSpread / static_cast<double>(numBalancedMatches));
+        stats.avgTeamSpread = static_cast<float>(totalTeamSpread / static_cast<double>(numBalancedMatches));
+        stats.avgRatingRange = static_cast<float>(totalRatingRange / static_cast<double>(numBalancedMatches));
+    }
+    if (numStyleDistances > 0)
+    {
+        stats.avgStyleDistance = static_cast<float>(totalStyleDistance / static_cast<double>(numStyleDistances));
+    }
+    if (numWindowParties > 0)
     {
-        auto elapsed = std::chrono::duration<float>(now - match->matchStartTime);
-        if (elapsed.count() >= match->matchDuration)
+        stats.avgMatchedWindow = static_cast<float>(totalMatchedWindow / static_cast<double>(numWindowParties));
+    }
+    for (int role = 0; role < NumRoles; ++role)
+    {
+        stats.roleStarvedSeconds[role] = static_cast<float>(roleStarvedSeconds[role]);
+        stats.avgRoleQueueSeconds[role] = roleMatchedPlayers[role] > 0 ? static_cast<float>(roleWaitTotals[role] / static_cast<double>(roleMatchedPlayers[role])) : 0.0f;
+        stats.queuedByRole[role] = numQueuedByRole[role];
+    }
+    stats.batchSolves = numBatchSolves;
+    stats.batchBlocksCut = numBatchBlocksCut;
+    stats.batchSolveMs = static_cast<float>(totalBatchSolveMs);
+    stats.avgBatchSolveMs = numBatchSolves > 0 ? static_cast<float>(totalBatchSolveMs / static_cast<double>(numBatchSolves)) : 0.0f;
+    stats.openSlots = static_cast<int>(backfillIndex.Size());
+    stats.backfills = numBackfills;
+    stats.expiredSlots = numExpiredSlots;
+    stats.outcomeBatches = numOutcomeBatches;
+    if (numOutcomeBatches > 0)
+    {
+        stats.avgOutcomeBatch = static_cast<float>(numOutcomeMatches) / static_cast<float>(numOutcomeBatches);
+    }
+    if (numModelResults > 0)
+    {
+        stats.favoriteWinRate = static_cast<float>(numFavoriteWins) / static_cast<float>(numModelResults);
+        stats.avgWinnerChance = static_cast<float>(totalWinnerChance / static_cast<double>(numModelResults));
+    }
+    stats.roundMatches = numRoundMatches;
+    if (numRoundBatches > 0)
+    {
+        stats.avgRounds = static_cast<float>(static_cast<double>(totalRounds) / static_cast<double>(numRoundMatches));
+        stats.avgRoundBatchMs = static_cast<float>(totalRoundMs / static_cast<double>(numRoundBatches));
+    }
+    if (numStartedMatches > 0)
+    {
+        stats.avgMatchSeconds = static_cast<float>(totalMatchSeconds / static_cast<double>(numStartedMatches));
+    }
+    stats.predictorUpdates = winPredictor.GetNumUpdates();
+    stats.avgPredictedFavorite = numPredictions > 0 ? static_cast<float>(totalPredictedFavorite / static_cast<double>(numPredictions)) : 0.0f;
+    stats.predictorLogLoss = static_cast<float>(recentLogLoss);
+    stats.predictorAccuracy = static_cast<float>(recentAccuracy);
+    stats.predictorRatingWeight = winPredictor.GetWeight(FWinPredictor::RatingFeature);
+    stats.ratedMatches = numRatedMatches;
+    stats.ratingPeriods = numRatingPeriods;
+    stats.avgRatingBatchMs = numRatingBatches > 0 ? static_cast<float>(totalRatingMs / static_cast<double>(numRatingBatches)) : 0.0f;
+    stats.avgDeviation = lastAvgDeviation;
+    stats.rematchMatches = numRematchMatches;
+    stats.rematchRejections = rematchGuard.GetRejections();
+    stats.rematchFallbacks = numRematchFallbacks;
+    stats.sloBreaches = numSloBreaches;
+    stats.sloBreachRate = numSloParties > 0 ? static_cast<float>(static_cast<double>(numSloBreaches) / static_cast<double>(numSloParties)) : 0.0f;
+    if (numBackfills > 0)
+    {
+        stats.avgBackfillWait = static_cast<float>(totalBackfillWait / static_cast<double>(numBackfills));
+        stats.avgBackfillGap = static_cast<float>(totalBackfillGap / static_cast<double>(numBackfills));
+    }
+    return stats;
+}
+
+void MatchMakingSystem::Update_Matches()
+{
+    MM_PROFILE_SCOPE("Update_Matches");
+    auto now = SimNow();
+    int processed = 0;
+    updateBacklog.matchEnds = 0;
+
+    // matches come off the heap in end time order, so only finished matches are visited. They are taken in batches whose outcomes
+    // are evaluated in one pass, then ended one by one. A random draw per match picks its winner as it ends, so the matches a
+    // budget cut puts back on the heap haven't used any. The ratings of the matches that ended move together before their
+    // players leave, so a player whose session is over logs off with the rating they earned
+    bool bBudgetLimited = false;
+    while (!bBudgetLimited && !matchEnds.empty() && matchEnds.top().endTime <= now)
+    {
+        endingMatches.clear();
+        outcomeBatch.Clear();
+        ratingBatch.Clear();
+        while (endingMatches.size() < MaxOutcomeBatch && !matchEnds.empty() && matchEnds.top().endTime <= now)
+        {
+            int matchId = matchEnds.top().matchId;
+            matchEnds.pop();
+            auto matchIt = allMatchesLookupMap.find(matchId);
+            if (matchIt != allMatchesLookupMap.end() && ongoingMatchIds.find(matchId) != ongoingMatchIds.end())
+            {
+                endingMatches.push_back(&matchIt->second);
+                AddOutcomeMatch(matchIt->second, outcomeBatch);
+            }
+        }
+        if (MatchSetting.bOutcomeModel)
+        {
+            MM_PROFILE_SCOPE("EvaluateOutcomes");
+            outcomeBatch.Evaluate(outcomeModel);
+            ++numOutcomeBatches;
+            numOutcomeMatches += static_cast<int64_t>(endingMatches.size());
+        }
+
+        size_t numEnded = 0;
+        for (size_t m = 0; m < endingMatches.size(); ++m)
         {
-            match->EndMatch();
+            FMatch* match = endingMatches[m];
+            if (processed > 0 && IsOverBudget(EUpdatePhase::Matches, processed, updateDeadline))
+            {
+                for (size_t rest = m; rest < endingMatches.size(); ++rest)
+                {
+                    matchEnds.push(MakeMatchEnd(*endingMatches[rest]));
+                }
+                updateBacklog.matchEnds = static_cast<int>(matchEnds.CountDue(now, BacklogCountLimit));
+                bBudgetLimited = true;
+                break;
+            }
+
+            // a match played out in rounds was won as it started, the model still scores how likely that was
+            const int numTeams = static_cast<int>(match->teams.size());
+            const bool bPlayedRounds = !match->roundScores.empty();
+            int winningTeamIndex = -1;
+            if (bPlayedRounds)
+            {
+                winningTeamIndex = static_cast<int>(std::max_element(match->roundScores.begin(), match->roundScores.end()) - match->roundScores.begin());
+            }
+            if (numTeams > 1 && MatchSetting.bOutcomeModel)
+            {
+                const int batchIndex = static_cast<int>(m);
+                if (!bPlayedRounds)
+                {
+                    winningTeamIndex = outcomeBatch.SampleWinner(batchIndex, RandomFloat());
+                }
+                float bestChance = 0.0f;
+                for (int t = 0; t < numTeams; ++t)
+                {
+                    bestChance = std::max(bestChance, outcomeBatch.GetWinChance(batchIndex, t));
+                }
+                const float winnerChance = outcomeBatch.GetWinChance(batchIndex, winningTeamIndex);
+                ++numModelResults;
+                numFavoriteWins += winnerChance >= bestChance ? 1 : 0;
+                totalWinnerChance += winnerChance;
+            }
+            else if (numTeams > 1 && !bPlayedRounds)
+            {
+                winningTeamIndex = RandomInt(0, numTeams - 1);
+            }
+            match->EndMatch(winningTeamIndex);
             ReportMatchResult(*match);
+            numEnded = m + 1;
+            ++processed;
+        }
+        RateMatches();
 
+        for (size_t m = 0; m < numEnded; ++m)
+        {
+            FMatch* match = endingMatches[m];
             for (const std::vector<VirtualPlayer>& team : match->teams)
             {
                 for (const VirtualPlayer& player : team)
                 {
+                    // slots still open are only listed under the players who left, so closing them needs no search
+                    backfillIndex.Close(player.GetId());
+
+                    // players that timed out while disconnected are already offline
                     auto it = allPlayersLookupMap.find(player.GetId());
-                    if (it != allPlayersLookupMap.end())
+                    if (it == allPlayersLookupMap.end())
                     {
-                        std::string log;
-                        it->second.SetState(EPlayerState::Online, log);
-                        RecordToLog(playerLog, log);
+                        continue;
+                    }
+                    it->second.SetCurrentMatchId(-1);
 
-                        queuedPlayerIDs.erase(it->second.GetId());
-                        AddPlayerToRejoiningQueue(&it->second);
+                    // disconnected and reconnecting players become idle through their pending events
+                    if (it->second.GetState() == EPlayerState::InGame)
+                    {
+                        RemoveQueuedParty(it->second.GetId());
+                        SetPlayerIdle(it->second);
                     }
                 }
             }
-            
-            UpdateLeaderboard(*match);
-            ongoingMatchIds.erase(match->matchId);
+
+            UpdateLeaderboard(*match);
+            ongoingMatchIds.erase(match->matchId);
+        }
+    }
+}
+
+void MatchMakingSystem::AddOutcomeMatch(const FMatch& match, FOutcomeBatch& batch)
+{
+    // the players as they are now, the match only holds copies taken when it formed. Players that went offline left the game
+    batch.BeginMatch();
+    for (const std::vector<VirtualPlayer>& team : match.teams)
+    {
+        batch.BeginTeam();
+        for (const VirtualPlayer& copy : team)
+        {
+            auto it = allPlayersLookupMap.find(copy.GetId());
+            if (it == allPlayersLookupMap.end())
+            {
+                batch.AddAbsentPlayer();
+                continue;
+            }
+            batch.AddPlayer(MakeOutcomePlayer(it->second));
+        }
+    }
+}
+
+void MatchMakingSystem::GetPredictorFeatures(const FMatch& match)
+{
+    // like the outcome model, from the players as they are now and counting the ones who went offline as gone
+    predictorTeams.resize(match.teams.size());
+    for (size_t t = 0; t < match.teams.size(); ++t)
+    {
+        FWinPredictor::FFeatures& features = predictorTeams[t];
+        features.fill(0.0f);
+        int numPresent = 0;
+        for (const VirtualPlayer& copy : match.teams[t])
+        {
+            auto it = allPlayersLookupMap.find(copy.GetId());
+            if (it != allPlayersLookupMap.end())
+            {
+                FWinPredictor::AddPlayer(features, MakeOutcomePlayer(it->second));
+                ++numPresent;
+            }
         }
+        FWinPredictor::FinishTeam(features, numPresent, static_cast<int>(match.teams[t].size()) - numPresent);
     }
 }
 
-void MatchMakingSystem::Update_RejoiningPlayers()
+void MatchMakingSystem::LearnMatchResult(const FMatch& match)
 {
-    auto now = std::chrono::steady_clock::now();
-    while (!rejoiningPlayers.empty() && rejoiningPlayers.top().rejoinTime <= now)
+    MM_PROFILE_SCOPE("LearnMatchResult");
+    const int numTeams = static_cast<int>(match.teams.size());
+    const int winner = match.winningTeamIndex;
+    if (numTeams < 2 || winner < 0 || winner >= numTeams)
+    {
+        return;
+    }
+
+    // scored on the chances given when the match formed, then trained on the teams as they finished it
+    if (static_cast<int>(match.predictedChances.size()) == numTeams)
     {
-        VirtualPlayer* player = rejoiningPlayers.top().player;
-        rejoiningPlayers.pop();
+        const float winnerChance = std::max(match.predictedChances[winner], 1e-6f);
+        const bool bFavoriteWon = winnerChance >= *std::max_element(match.predictedChances.begin(), match.predictedChances.end());
+        const double weight = 1.0 / std::min(static_cast<double>(numScoredPredictions + 1), PredictorWindow);
+        recentLogLoss += (-std::log(static_cast<double>(winnerChance)) - recentLogLoss) * weight;
+        recentAccuracy += ((bFavoriteWon ? 1.0 : 0.0) - recentAccuracy) * weight;
+        ++numScoredPredictions;
+    }
 
-        if (player)
+    GetPredictorFeatures(match);
+    predictorChances.resize(static_cast<size_t>(numTeams));
+    winPredictor.Predict(predictorTeams.data(), numTeams, predictorChances.data());
+    winPredictor.Update(predictorTeams.data(), predictorChances.data(), numTeams, winner, MatchSetting.predictorLearningRate);
+}
+
+void MatchMakingSystem::Update_PlayerEvents()
+{
+    MM_PROFILE_SCOPE("Update_PlayerEvents");
+    auto now = SimNow();
+    int processed = 0;
+    updateBacklog.playerEvents = 0;
+    while (!playerEvents.empty() && playerEvents.top().time <= now)
+    {
+        if (processed > 0 && IsOverBudget(EUpdatePhase::PlayerEvents, processed, updateDeadline))
         {
-            std::string log;
-            player->SetState(EPlayerState::InQueue, log);
-            RecordToLog(playerLog, log);
-            
-            queuedPlayerIDs.insert(player->GetId());
+            updateBacklog.playerEvents = static_cast<int>(playerEvents.CountDue(now, BacklogCountLimit));
+            break;
         }
+
+        FPlayerEvent event = playerEvents.top();
+        playerEvents.pop();
+        HandlePlayerEvent(event);
+        ++processed;
     }
 }
 
-void MatchMakingSystem::AddPlayerToRejoiningQueue(VirtualPlayer* player)
+void MatchMakingSystem::Update_Arrivals()
 {
-    FPlayerRejoin playerRejoin = FPlayerRejoin(player);
-    rejoiningPlayers.push(playerRejoin);
+    MM_PROFILE_SCOPE("Update_Arrivals");
+    auto now = SimNow();
+    int processed = 0;
+    updateBacklog.arrivalLagMs = 0.0f;
+    while (arrivalProcess.HasCandidate(now))
+    {
+        if (processed > 0 && IsOverBudget(EUpdatePhase::Arrivals, processed, updateDeadline))
+        {
+            updateBacklog.arrivalLagMs = std::chrono::duration<float, std::milli>(now - arrivalProcess.GetCandidateTime()).count();
+            break;
+        }
+        ++processed;
+        if (!arrivalProcess.AcceptCandidate(ArrivalSetting))
+        {
+            continue;
+        }
+
+        // an arrival is a party that plays one session together, each member is either a returning offline player or a brand new one
+        float sessionLength = std::max(FArrivalProcess::SampleSessionLength(ArrivalSetting), 0.001f);
+        int partySize = std::min(FArrivalProcess::SamplePartySize(ArrivalSetting), FPartyQueue::MaxPartySize);
+        std::vector<int> memberIds;
+        for (int i = 0; i < partySize; ++i)
+        {
+            ++numArrivals;
+            VirtualPlayer* player = nullptr;
+            if (!offlinePlayerIds.empty() && GetRandomResult(ArrivalSetting.returningPlayerRatio))
+            {
+                size_t index = static_cast<size_t>(RandomInt(0, static_cast<int>(offlinePlayerIds.size()) - 1));
+                int playerId = offlinePlayerIds[index];
+                offlinePlayerIds[index] = offlinePlayerIds.back();
+                offlinePlayerIds.pop_back();
+                player = RestoreFromColdStorage(playerId);
+            }
+            else
+            {
+                // new players join from the region of the player who brought them
+                player = &AddNewPlayer(memberIds.empty() ? -1 : allPlayersLookupMap.find(memberIds[0])->second.GetRegion());
+            }
+
+            if (player)
+            {
+                memberIds.push_back(player->GetId());
+                LogInPlayer(*player, sessionLength);
+            }
+        }
+        FormParty(memberIds);
+    }
 }
 
 void MatchMakingSystem::RecordToLog(std::vector<std::string>& targetLog, const std::string& message, bool bTimeStamp)
@@ -204,6 +1899,7 @@ void MatchMakingSystem::RecordToLog(std::vector<std::string>& targetLog, const s
 
 void MatchMakingSystem::UpdateLeaderboard(const FMatch& match)
 {
+    MM_PROFILE_SCOPE("UpdateLeaderboard");
     VirtualPlayer* bestP = nullptr;
     float highestWinRate = -1;
     
@@ -233,10 +1929,16 @@ void MatchMakingSystem::UpdateLeaderboard(const FMatch& match)
 
 void MatchMakingSystem::ReportMatchResult(const FMatch& match)
 {
-    // Process match results efficiently
-    for (auto& team : match.teams)
+    MM_PROFILE_SCOPE("ReportMatchResult");
+    // before the ratings move, the predictor learns from the players as they played
+    if (MatchSetting.bWinPredictor)
     {
-        for (const auto& player : team)
+        LearnMatchResult(match);
+    }
+
+    for (const std::vector<VirtualPlayer>& team : match.teams)
+    {
+        for (const VirtualPlayer& player : team)
         {
             auto it = allPlayersLookupMap.find(player.GetId());
             if (it != allPlayersLookupMap.end())
@@ -245,10 +1947,123 @@ void MatchMakingSystem::ReportMatchResult(const FMatch& match)
             }
         }
     }
+    AddRatedMatch(match);
+    RecordOpponents(match);
+    
+    if (replayRecorder)
+    {
+        replayRecorder->RecordMatchResult(match);
+    }
     
     RecordToLog(matchLog, match.CreateMatchFinishedMessage().str());
 }
 
+void MatchMakingSystem::AddRatedMatch(const FMatch& match)
+{
+    // players that went offline count with the rating they logged off with and keep it
+    ratingBatch.BeginMatch(match.winningTeamIndex);
+    for (const std::vector<VirtualPlayer>& team : match.teams)
+    {
+        ratingBatch.BeginTeam();
+        for (const VirtualPlayer& copy : team)
+        {
+            const int playerId = copy.GetId();
+            auto it = allPlayersLookupMap.find(playerId);
+            const bool bOnline = it != allPlayersLookupMap.end();
+            ratingBatch.AddPlayer(playerId, bOnline ? it->second.GetRating() : copy.GetRating(), ratingTable.GetDeviation(playerId),
+                ratingTable.GetVolatility(playerId), bOnline);
+        }
+    }
+}
+
+void MatchMakingSystem::RecordOpponents(const FMatch& match)
+{
+    // every pair across teams, both ways, offline players included
+    for (size_t t = 0; t < match.teams.size(); ++t)
+    {
+        for (size_t other = t + 1; other < match.teams.size(); ++other)
+        {
+            for (const VirtualPlayer& player : match.teams[t])
+            {
+                for (const VirtualPlayer& opponent : match.teams[other])
+                {
+                    recentOpponents.Record(player.GetId(), opponent.GetId());
+                    recentOpponents.Record(opponent.GetId(), player.GetId());
+                }
+            }
+        }
+    }
+}
+
+bool MatchMakingSystem::IsRematch(const FMatch& match) const
+{
+    for (size_t t = 0; t < match.teams.size(); ++t)
+    {
+        for (size_t other = t + 1; other < match.teams.size(); ++other)
+        {
+            for (const VirtualPlayer& player : match.teams[t])
+            {
+                for (const VirtualPlayer& opponent : match.teams[other])
+                {
+                    if (recentOpponents.HasPlayed(player.GetId(), opponent.GetId()))
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void MatchMakingSystem::RateMatches()
+{
+    MM_PROFILE_SCOPE("RateMatches");
+    if (ratingBatch.NumMatches() == 0)
+    {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ratingBatch.Update(MatchSetting.ratingSystem, ratingModel, MatchSetting.ratingThreads);
+    for (int i = 0; i < ratingBatch.NumPlayers(); ++i)
+    {
+        if (!ratingBatch.IsRated(i))
+        {
+            continue;
+        }
+        // changes rather than new ratings, a player who left a match and is playing another by now is rated for both
+        const int playerId = ratingBatch.GetPlayerId(i);
+        auto it = allPlayersLookupMap.find(playerId);
+        if (it != allPlayersLookupMap.end())
+        {
+            it->second.SetRating(it->second.GetRating() + ratingBatch.GetRatingChange(i));
+            ratingTable.SetPlayer(playerId, ratingBatch.GetDeviation(i), ratingBatch.GetVolatility(i));
+        }
+    }
+    ++numRatingBatches;
+    numRatedMatches += ratingBatch.NumMatches();
+    totalRatingMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void MatchMakingSystem::Update_RatingPeriod()
+{
+    // periods end on a fixed grid of simulated time, however the updates fall. Elo has no deviations to grow
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<float>(std::max(MatchSetting.ratingPeriodSeconds, 1.0f)));
+    const auto now = SimNow();
+    while (now - lastRatingPeriod >= period)
+    {
+        lastRatingPeriod += period;
+        if (MatchSetting.ratingSystem != ERatingSystem::Elo)
+        {
+            MM_PROFILE_SCOPE("RatingPeriod");
+            lastAvgDeviation = ratingTable.Sweep(MatchSetting.ratingSystem, ratingModel);
+            ++numRatingPeriods;
+        }
+    }
+}
+
 std::vector<VirtualPlayer*> MatchMakingSystem::GetTopPlayersByWinRate() const
 {
     std::vector<VirtualPlayer*> topPlayers;
@@ -292,3 +2107,433 @@ float MatchMakingSystem::GetAvgQueueTime() const
     }
     return 0.0f;
 }
+
+
+bool MatchMakingSystem::SaveCheckpoint(const std::string& path)
+{
+    FBinaryArchive Ar = FBinaryArchive::ForSaving();
+    Ar.SetReferenceTime(SimNow());
+
+    uint32_t magic = CheckpointMagic;
+    uint32_t version = CheckpointVersion;
+    Ar << magic << version;
+    Ar << rng.state[0] << rng.state[1] << rng.state[2] << rng.state[3];
+    SerializeState(Ar);
+
+    bool bSaved = Ar.SaveToFile(path);
+    RecordToLog(matchLog, (bSaved ? "Checkpoint saved to " : "Failed to save checkpoint to ") + path);
+    return bSaved;
+}
+
+bool MatchMakingSystem::LoadCheckpoint(const std::string& path)
+{
+    std::vector<char> data;
+    if (!FBinaryArchive::ReadFile(path, data))
+    {
+        RecordToLog(matchLog, "Failed to read checkpoint " + path);
+        return false;
+    }
+
+    FBinaryArchive Ar = FBinaryArchive::ForLoading(std::move(data));
+    Ar.SetReferenceTime(SimNow());
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    Ar << magic << version;
+    if (magic != CheckpointMagic || version != CheckpointVersion)
+    {
+        RecordToLog(matchLog, "Checkpoint " + path + " has an unknown format or version");
+        return false;
+    }
+
+    Xoshiro256SS loadedRng;
+    Ar << loadedRng.state[0] << loadedRng.state[1] << loadedRng.state[2] << loadedRng.state[3];
+
+    // restore into a fresh system so a corrupted file leaves the current simulation untouched
+    MatchMakingSystem loaded;
+    loaded.SerializeState(Ar);
+    if (Ar.HasError())
+    {
+        RecordToLog(matchLog, "Checkpoint " + path + " is truncated or corrupted");
+        return false;
+    }
+
+    // keep the UI logs of this session
+    loaded.matchLog = std::move(matchLog);
+    loaded.playerLog = std::move(playerLog);
+    bool bWasRecording = replayRecorder != nullptr;
+    *this = std::move(loaded);
+    rng = loadedRng;
+
+    // a replay can only reproduce a run from its start, so recording ends here
+    if (bWasRecording)
+    {
+        RecordToLog(matchLog, "Replay recording stopped: checkpoint loaded");
+    }
+
+    RecordToLog(matchLog, "Checkpoint loaded from " + path + " (" + std::to_string(allPlayersLookupMap.size()) + " active players, " + std::to_string(coldPlayers.size()) + " offline)");
+    return true;
+}
+
+void MatchMakingSystem::SetReplayRecorder(FReplayRecorder* inRecorder)
+{
+    replayRecorder = inRecorder;
+    lastUpdateTime = SimNow();
+    if (replayRecorder)
+    {
+        replayRecorder->Begin(GetRandomSeed(), MatchSetting, ArrivalSetting);
+    }
+}
+
+uint64_t MatchMakingSystem::ComputeStateHash() const
+{
+    // FNV-1a over the state in id order, so it doesn't depend on hash container layout
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    auto mix = [&hash](uint64_t value)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 0x100000001b3ULL;
+        }
+    };
+
+    for (int i = 0; i < nextPlayerId; ++i)
+    {
+        auto it = allPlayersLookupMap.find(i);
+        if (it == allPlayersLookupMap.end())
+        {
+            auto coldIt = coldPlayers.find(i);
+            if (coldIt != coldPlayers.end())
+            {
+                mix(static_cast<uint64_t>(i));
+                mix(coldIt->second.size());
+            }
+            continue;
+        }
+        const VirtualPlayer& player = it->second;
+        mix(static_cast<uint64_t>(player.GetId()));
+        mix(static_cast<uint64_t>(player.GetState()));
+        mix(static_cast<uint64_t>(player.GetTraits()));
+        mix(player.GetWonMatches().size());
+        mix(player.GetLostMatches().size());
+        mix(static_cast<uint64_t>(player.GetPartyLeaderId()));
+        mix(static_cast<uint64_t>(std::llround(player.GetRating() * 100.0f)));
+        mix(static_cast<uint64_t>(player.GetRegion()));
+        mix(static_cast<uint64_t>(player.GetRoles()));
+    }
+
+    for (int i = 0; i < static_cast<int>(allMatchesLookupMap.size()); ++i)
+    {
+        auto it = allMatchesLookupMap.find(i);
+        if (it == allMatchesLookupMap.end())
+        {
+            continue;
+        }
+        const FMatch& match = it->second;
+        mix(static_cast<uint64_t>(match.matchId));
+        mix(static_cast<uint64_t>(match.state));
+        mix(static_cast<uint64_t>(match.winningTeamIndex));
+        mix(static_cast<uint64_t>(match.dataCenter));
+        for (const std::vector<VirtualPlayer>& team : match.teams)
+        {
+            for (const VirtualPlayer& player : team)
+            {
+                mix(static_cast<uint64_t>(player.GetId()));
+            }
+        }
+    }
+
+    mix(static_cast<uint64_t>(numQueuedPlayers));
+    mix(static_cast<uint64_t>(numQueuedParties));
+    for (const FPartyQueue& queue : regionQueues)
+    {
+        mix(queue.NumParties());
+    }
+    for (const FQueuedParty& info : queuedPartyInfo)
+    {
+        if (info.homeRegion >= 0)
+        {
+            mix(static_cast<uint64_t>(std::llround(info.searchWindow * 100.0f)));
+        }
+    }
+    mix(static_cast<uint64_t>(matchmakeRegion));
+    mix(backfillIndex.Size());
+    for (const FBatchPlan& plan : batchPlans)
+    {
+        mix(plan.Remaining());
+    }
+    mix(parties.size());
+    mix(ongoingMatchIds.size());
+    mix(static_cast<uint64_t>(matchmakeCarryOver));
+    mix(static_cast<uint64_t>(numOnlinePlayers));
+    mix(offlinePlayerIds.size());
+    mix(static_cast<uint64_t>(numArrivals));
+    mix(playerEvents.size());
+    mix(static_cast<uint64_t>(numDisconnects));
+    mix(static_cast<uint64_t>(numReconnectTimeouts));
+    mix(static_cast<uint64_t>(numAbandonments));
+    mix(static_cast<uint64_t>(numSloParties));
+    mix(static_cast<uint64_t>(numSloBreaches));
+    for (uint64_t state : rng.state)
+    {
+        mix(state);
+    }
+    for (int feature = 0; feature < FWinPredictor::NumFeatures; ++feature)
+    {
+        mix(static_cast<uint64_t>(std::llround(winPredictor.GetWeight(feature) * 10000.0f)));
+    }
+    for (int playerId = 0; playerId < ratingTable.NumPlayers(); ++playerId)
+    {
+        mix(static_cast<uint64_t>(std::llround(ratingTable.GetDeviation(playerId) * 100.0f)));
+    }
+    for (int playerId = 0; playerId < recentOpponents.NumPlayers(); ++playerId)
+    {
+        mix(static_cast<uint64_t>(static_cast<uint32_t>(recentOpponents.GetOpponents(playerId)[0])));
+    }
+    return hash;
+}
+
+void MatchMakingSystem::SerializeState(FBinaryArchive& Ar)
+{
+    MatchSetting.Serialize(Ar);
+    ArrivalSetting.Serialize(Ar);
+    arrivalProcess.Serialize(Ar);
+    Ar << nextPlayerId << matchMakingSystemDelay << lastMatchmakingTime << cycleDelay << matchmakeCarryOver;
+
+    // players
+    uint64_t numPlayers = allPlayersLookupMap.size();
+    Ar << numPlayers;
+    if (Ar.IsSaving())
+    {
+        for (auto& it : allPlayersLookupMap)
+        {
+            it.second.Serialize(Ar);
+        }
+    }
+    else
+    {
+        allPlayersLookupMap.reserve(static_cast<size_t>(numPlayers));
+        for (uint64_t i = 0; i < numPlayers && !Ar.HasError(); ++i)
+        {
+            VirtualPlayer player;
+            player.Serialize(Ar);
+            allPlayersLookupMap.emplace(player.GetId(), std::move(player));
+        }
+    }
+
+    // matches, team members are stored by id and rebuilt from the player table
+    uint64_t numMatches = allMatchesLookupMap.size();
+    Ar << numMatches;
+    if (Ar.IsLoading())
+    {
+        allMatchesLookupMap.reserve(static_cast<size_t>(numMatches));
+    }
+    auto matchIt = allMatchesLookupMap.begin();
+    for (uint64_t i = 0; i < numMatches && !Ar.HasError(); ++i)
+    {
+        FMatch loadedMatch;
+        FMatch& match = Ar.IsSaving() ? (matchIt++)->second : loadedMatch;
+
+        std::vector<std::vector<int>> teamIds;
+        if (Ar.IsSaving())
+        {
+            for (const std::vector<VirtualPlayer>& team : match.teams)
+            {
+                std::vector<int>& ids = teamIds.emplace_back();
+                for (const VirtualPlayer& player : team)
+                {
+                    ids.push_back(player.GetId());
+                }
+            }
+        }
+
+        Ar << match.matchId << match.matchDuration << match.matchStartTime << match.state << match.winningTeamIndex << match.dataCenter;
+        Ar << teamIds << match.teamRoles << match.roundScores << match.predictedChances;
+
+        if (Ar.IsLoading())
+        {
+            for (const std::vector<int>& ids : teamIds)
+            {
+                std::vector<VirtualPlayer>& team = match.teams.emplace_back();
+                for (int playerId : ids)
+                {
+                    auto it = allPlayersLookupMap.find(playerId);
+                    team.emplace_back(it != allPlayersLookupMap.end() ? it->second : VirtualPlayer(playerId, EPlayerTrait::None));
+                }
+            }
+            if (match.winningTeamIndex >= 0 && match.winningTeamIndex < static_cast<int>(match.teams.size()))
+            {
+                match.winningTeam = match.teams[match.winningTeamIndex];
+            }
+            allMatchesLookupMap.emplace(match.matchId, std::move(match));
+        }
+    }
+
+    // parties (leader first), every region queue in join order and ongoing matches
+    std::vector<std::vector<int>> partyMembers;
+    std::vector<std::vector<int>> regionQueueIds(NumRegions);
+    if (Ar.IsSaving())
+    {
+        for (const auto& it : parties)
+        {
+            partyMembers.push_back(it.second);
+        }
+        for (int region = 0; region < NumRegions; ++region)
+        {
+            regionQueueIds[region] = regionQueues[region].ToVector();
+        }
+    }
+    std::vector<int> ongoingIds(ongoingMatchIds.begin(), ongoingMatchIds.end());
+    Ar << partyMembers << regionQueueIds << queuedPartyInfo << numQueuedPlayers << numQueuedParties << matchmakeRegion << ongoingIds;
+    if (Ar.IsLoading())
+    {
+        for (const std::vector<int>& memberIds : partyMembers)
+        {
+            if (!memberIds.empty())
+            {
+                parties.emplace(memberIds[0], memberIds);
+            }
+        }
+        for (int region = 0; region < NumRegions && region < static_cast<int>(regionQueueIds.size()); ++region)
+        {
+            regionQueues[region].SetRatingIndex(UsesRatingIndex(MatchSetting.formation));
+            regionQueues[region].SetRoleIndex(UsesRoleIndex(MatchSetting.formation));
+            regionQueues[region].SetStyleIndex(UsesStyleIndex(MatchSetting.formation));
+            for (int leaderId : regionQueueIds[region])
+            {
+                if (leaderId >= 0 && leaderId < static_cast<int>(queuedPartyInfo.size()))
+                {
+                    const FQueuedParty& info = queuedPartyInfo[leaderId];
+                    regionQueues[region].Enqueue(leaderId, info.size, info.rating, info.searchWindow, info.roles, info.style);
+                }
+            }
+        }
+        for (const FQueuedParty& info : queuedPartyInfo)
+        {
+            for (int role = 0; role < NumRoles && info.homeRegion >= 0 && info.size == 1; ++role)
+            {
+                numQueuedByRole[role] += (info.roles & GetRoleBit(role)) ? 1 : 0;
+            }
+        }
+        ongoingMatchIds.insert(ongoingIds.begin(), ongoingIds.end());
+
+        // end times are derived from the matches themselves
+        std::vector<FMatchEnd> ends;
+        ends.reserve(ongoingIds.size());
+        for (int matchId : ongoingIds)
+        {
+            auto it = allMatchesLookupMap.find(matchId);
+            if (it != allMatchesLookupMap.end())
+            {
+                ends.push_back(MakeMatchEnd(it->second));
+            }
+        }
+        matchEnds = TTimedHeap<FMatchEnd>(std::greater<>(), std::move(ends));
+    }
+
+    // matches of the running batch not handed out yet
+    for (FBatchPlan& plan : batchPlans)
+    {
+        plan.Serialize(Ar);
+    }
+
+    // open backfill slots, field by field for the same reason as the lifecycle events below
+    std::vector<FOpenSlot> openSlots;
+    if (Ar.IsSaving())
+    {
+        openSlots = backfillIndex.ToVector();
+    }
+    uint64_t numOpenSlots = openSlots.size();
+    Ar << numOpenSlots;
+    for (uint64_t i = 0; i < numOpenSlots && !Ar.HasError(); ++i)
+    {
+        FOpenSlot loadedSlot;
+        FOpenSlot& slot = Ar.IsSaving() ? openSlots[static_cast<size_t>(i)] : loadedSlot;
+        Ar << slot.departedId << slot.matchId << slot.team << slot.role << slot.dataCenter << slot.rating << slot.openTime << slot.fillBy;
+        if (Ar.IsLoading())
+        {
+            backfillIndex.Open(slot);
+        }
+    }
+
+    // lifecycle events, stored field by field so the times go through the reference time
+    std::vector<std::chrono::steady_clock::time_point> eventTimes;
+    std::vector<int> eventPlayerIds;
+    std::vector<uint32_t> eventSerials;
+    std::vector<EPlayerEvent> eventTypes;
+    if (Ar.IsSaving())
+    {
+        for (const FPlayerEvent& event : playerEvents.GetEntries())
+        {
+            eventTimes.push_back(event.time);
+            eventPlayerIds.push_back(event.playerId);
+            eventSerials.push_back(event.serial);
+            eventTypes.push_back(event.type);
+        }
+    }
+    Ar << eventTimes << eventPlayerIds << eventSerials << eventTypes;
+    if (Ar.IsLoading() && eventTimes.size() == eventPlayerIds.size() && eventTimes.size() == eventSerials.size() && eventTimes.size() == eventTypes.size())
+    {
+        std::vector<FPlayerEvent> entries(eventTimes.size());
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            entries[i].time = eventTimes[i];
+            entries[i].playerId = eventPlayerIds[i];
+            entries[i].serial = eventSerials[i];
+            entries[i].type = eventTypes[i];
+        }
+        playerEvents = TTimedHeap<FPlayerEvent>(std::greater<>(), std::move(entries));
+    }
+
+    // sessions and cold storage
+    Ar << offlinePlayerIds << numOnlinePlayers << numArrivals << numDepartures;
+    Ar << numDisconnects << numReconnects << numReconnectTimeouts;
+    Ar << numAbandonments << numAbandonedPlayers << totalAbandonSeconds;
+    Ar << numSloParties << numSloBreaches;
+    uint64_t numColdPlayers = coldPlayers.size();
+    Ar << numColdPlayers;
+    auto coldIt = coldPlayers.begin();
+    for (uint64_t i = 0; i < numColdPlayers && !Ar.HasError(); ++i)
+    {
+        int playerId = Ar.IsSaving() ? coldIt->first : -1;
+        std::vector<char> loadedBlob;
+        std::vector<char>& blob = Ar.IsSaving() ? (coldIt++)->second : loadedBlob;
+        Ar << playerId << blob;
+        if (Ar.IsLoading())
+        {
+            coldStorageBytes += blob.size();
+            coldPlayers.emplace(playerId, std::move(blob));
+        }
+    }
+
+    winPredictor.Serialize(Ar);
+    ratingTable.Serialize(Ar);
+    Ar << lastRatingPeriod;
+    recentOpponents.Serialize(Ar);
+    rematchGuard.Serialize(Ar);
+
+    // Stats accumulators, all of them, so every stats panel resumes from a checkpoint where it left off. CPU times included,
+    // they are only reported and never decide anything
+    Ar << matchmakingStats << rateWindowStart << rateWindowMatches;
+    Ar << regionStats << regionWaitTotals << regionMatchedParties << regionLatencyTotals;
+    Ar << totalPackedSpread << totalTeamSpread << numBalancedMatches << totalMatchedWindow << numWindowParties;
+    Ar << totalRatingRange << totalStyleDistance << numStyleDistances;
+    Ar << cycleMissingRoles << roleStarvedSeconds << roleWaitTotals << roleMatchedPlayers;
+    Ar << numBackfills << numExpiredSlots << totalBackfillWait << totalBackfillGap;
+    Ar << numBatchSolves << numBatchBlocksCut << totalBatchSolveMs;
+    Ar << numOutcomeBatches << numOutcomeMatches << numModelResults << numFavoriteWins << totalWinnerChance;
+    Ar << numRoundBatches << numRoundMatches << totalRounds << totalRoundMs << numStartedMatches << totalMatchSeconds;
+    Ar << numPredictions << totalPredictedFavorite << numScoredPredictions << recentLogLoss << recentAccuracy;
+    Ar << numRatingBatches << numRatedMatches << totalRatingMs << numRatingPeriods << lastAvgDeviation;
+    Ar << numRematchMatches << numRematchFallbacks;
+
+    // leaderboard
+    int leadingPlayerId = currentLeadingPlayer.GetId();
+    Ar << leadingPlayerId;
+    if (Ar.IsLoading())
+    {
+        auto it = allPlayersLookupMap.find(leadingPlayerId);
+        currentLeadingPlayer = it != allPlayersLookupMap.end() ? it->second : VirtualPlayer(-1, EPlayerTrait::None);
+    }
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <vector>
 #include <string>
 #include <queue>
@@ -8,42 +9,353 @@
 #include <unordered_map>
 #include <unordered_set>
 
+#include "ArrivalProcess.h"
+#include "Backfill.h"
 #include "MM_Elements.h"
+#include "MatchOutcome.h"
+#include "MatchRounds.h"
+#include "MatchmakingPolicy.h"
+#include "PlayerQueue.h"
+#include "Ratings.h"
+#include "Rematch.h"
+#include "SimClock.h"
+#include "TeamBalancer.h"
+#include "WinPredictor.h"
 
 enum class EPlayerState;
 class VirtualPlayer;
+class FBinaryArchive;
+class FReplayRecorder;
 
-// a min-heap priority queue for downtime tracking
-struct FPlayerRejoin
+// Timed player lifecycle events
+enum class EPlayerEvent : uint8_t
 {
-    VirtualPlayer* player = nullptr;
-    
-    // estimated time when player would rejoin the queue
-    std::chrono::steady_clock::time_point rejoinTime;
+    JoinQueue,          // Online -> InQueue once the idle time is over
+    SessionEnd,         // Online / InQueue -> Offline, later states log off when they next become idle
+    Disconnect,         // InGame -> Disconnected
+    Reconnect,          // Disconnected -> Rejoining
+    ReconnectTimeout,   // Disconnected -> Offline
+    ReconnectComplete,  // Rejoining -> InGame if the match is still running, Online otherwise
+    Spillover,          // InQueue: a party that waited long enough also queues in the next closest data center
+    WidenWindow,        // InQueue: the party's search window grows by one step
+    ReleaseSlot,        // Disconnected: the player's place in the match is offered to queued players
+    Abandon,            // InQueue -> Online: the party ran out of patience before it was matched
+};
+
+// a min-heap entry for the player lifecycle, stale entries are skipped by comparing the serial with the player's
+struct FPlayerEvent
+{
+    std::chrono::steady_clock::time_point time;
+    int playerId = -1;
+    uint32_t serial = 0; // session serial for SessionEnd, state serial otherwise
+    EPlayerEvent type = EPlayerEvent::JoinQueue;
+
+    // fully ordered so simultaneous events pop in the same order whatever the heap layout
+    bool operator > (const FPlayerEvent& other) const
+    {
+        if (time != other.time) return time > other.time;
+        if (playerId != other.playerId) return playerId > other.playerId;
+        if (type != other.type) return type > other.type;
+        return serial > other.serial;
+    }
+
+    std::chrono::steady_clock::time_point GetDueTime() const { return time; }
+};
+
+// a min-heap entry for ongoing matches, ordered by the time they finish
+struct FMatchEnd
+{
+    std::chrono::steady_clock::time_point endTime;
+    int matchId = -1;
 
-    // Min-heap: earlier rejoin times come first
-    bool operator > (const FPlayerRejoin& other) const
+    // ties are broken by id so matches finishing together are always processed in the same order
+    bool operator > (const FMatchEnd& other) const
     {
-        return rejoinTime > other.rejoinTime;
+        return endTime > other.endTime || (endTime == other.endTime && matchId > other.matchId);
     }
 
-    FPlayerRejoin(VirtualPlayer* inPlayer)
+    std::chrono::steady_clock::time_point GetDueTime() const { return endTime; }
+};
+
+// Min-heap of timed entries that can also count its due entries without popping them
+template <typename T>
+class TTimedHeap : public std::priority_queue<T, std::vector<T>, std::greater<>>
+{
+public:
+    using std::priority_queue<T, std::vector<T>, std::greater<>>::priority_queue;
+
+    const std::vector<T>& GetEntries() const { return this->c; } // heap order
+
+    // Walks only the due part of the heap, so the cost is bounded by min(due entries, limit)
+    size_t CountDue(std::chrono::steady_clock::time_point now, size_t limit) const
     {
-        player = inPlayer;
-        rejoinTime = std::chrono::steady_clock::now() +
-            std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(inPlayer->GetCurrentIdleTime()));
+        size_t count = 0;
+        std::vector<size_t>& stack = countStack;
+        stack.clear();
+        if (!this->c.empty() && this->c[0].GetDueTime() <= now)
+        {
+            stack.push_back(0);
+        }
+        while (!stack.empty() && count < limit)
+        {
+            size_t index = stack.back();
+            stack.pop_back();
+            ++count;
+            for (size_t child = index * 2 + 1; child <= index * 2 + 2 && child < this->c.size(); ++child)
+            {
+                if (this->c[child].GetDueTime() <= now)
+                {
+                    stack.push_back(child);
+                }
+            }
+        }
+        return count;
     }
+
+private:
+    mutable std::vector<size_t> countStack; // CountDue's scratch, kept so counting every update doesn't allocate
 };
 
 struct FMatchSetting
 {
     int numTeams = 2;
     int teamSize = 1;
-    int matchDuration = 3;
+    int matchDuration = 3;     // seconds, see Rounds below
     int matchesPerCycle = 2;
+
+    // Adaptive scheduling: each cycle drains as many full matches as the queue holds within {cycleBudgetMs} of CPU time.
+    // Cycles run every {minCycleDelay} ms while matches are being formed and back off up to {maxCycleDelay} ms while the queue is shallow
+    bool bAdaptiveScheduling = false;
+    float cycleBudgetMs = 2.0f;
+    int minCycleDelay = 50;
+    int maxCycleDelay = 1000;
+
+    // Time slicing: CPU budget of a single Update() call shared by all phases, 0 for unlimited.
+    // Work that doesn't fit carries over into the next call
+    float updateBudgetMs = 0.0f;
+
+    // Team balancing: the parties picked for a match are redistributed between its teams to even out their rating totals
+    ETeamBalancing teamBalancing = ETeamBalancing::Differencing;
+    bool bBalancingLocalSearch = true;
+
+    // Regions: with sharding every data center forms matches from its own queue. A party starts in the data center where its
+    // worst member latency is lowest and also queues in the next closest one after every {spilloverWait} seconds of waiting,
+    // as long as that one is within {maxSpilloverLatency} ms for every member. Without sharding there is a single queue
+    bool bRegionSharding = false;
+    float spilloverWait = 10.0f;
+    int maxSpilloverLatency = 150;
+
+    // Formation policy (see MatchmakingPolicy.h), the region policy follows bRegionSharding.
+    // Skill buckets: parties only play within their {ratingBucketWidth} wide bucket of average rating.
+    // Skill windows: a party only plays with parties whose average rating is within its window, and whose window covers its own
+    // rating in turn. The window starts at {searchWindow} and grows by {searchWindowGrowth} after every {searchWindowInterval}
+    // seconds of waiting, up to {maxSearchWindow}.
+    // Roles: every team is {roleComposition} players of each role, picked from the roles the players declared. The team size
+    // follows the composition and parties queue as solo players.
+    // Batch: cycles run at most every {batchWindowMs} and solve each queue for the cheapest set of matches (see FBatchSolver).
+    // A match costs its rating range plus {batchLatencyWeight} per ms of worst latency, and waits for a later batch above
+    // {batchMaxCost} plus {batchCostGrowth} per second its parties waited. A solve takes at most {batchBudgetMs} of wall time
+    // on {batchThreads} threads (0 for one per core), the part of the queue it didn't reach waits for the next batch.
+    // Play style: a party only plays with parties whose play style (the members' average) is at most {playStyleDistance} from
+    // the anchor's, closest first
+    EMatchFormation formation = EMatchFormation::SkillWindows;
+    float ratingBucketWidth = 100.0f;
+    float searchWindow = 50.0f;
+    float searchWindowGrowth = 50.0f;
+    float searchWindowInterval = 5.0f;
+    float maxSearchWindow = 400.0f;
+    FRoleComposition roleComposition = { 1, 1, 3 };
+    int batchWindowMs = 1000;
+    float batchLatencyWeight = 2.0f;
+    float batchMaxCost = 200.0f;
+    float batchCostGrowth = 20.0f;
+    float batchBudgetMs = 5.0f;
+    int batchThreads = 0;
+    float playStyleDistance = 4.0f;
+
+    // Backfill: a player still disconnected after {backfillGrace} seconds, or timed out, leaves an open slot. Before new matches
+    // are formed, queued solo players take the open slot closest to their rating within {backfillRatingWindow} of the player who
+    // left, for a role they play, in their shard's data center (or any within {maxSpilloverLatency} ms without sharding).
+    // A slot closes when less than {backfillMinRemaining} of its match duration is left
+    bool bBackfill = false;
+    float backfillGrace = 0.5f;
+    float backfillRatingWindow = 200.0f;
+    float backfillMinRemaining = 0.25f;
+
+    // Outcomes: with the outcome model a match is won according to the strength of its teams, from their players' ratings, stats,
+    // traits and streaks (see FOutcomeBatch). Without it every team is equally likely to win
+    bool bOutcomeModel = true;
+
+    // Rounds: a match is played out in rounds as it starts, until a team has taken {roundsToWin} of them (see FRoundBatch).
+    // Rounds are won by the teams' strengths under the outcome model, worn down by fatigue and pushed by grit, and the rounds
+    // decide the winner and how long the match lasts, about {matchDuration} seconds when every round is played. The matches
+    // a cycle forms are played out together on {roundThreads} threads (0 for one per core).
+    // Without it a match lasts {matchDuration} seconds, give or take half of that
+    bool bRoundSimulation = false;
+    int roundsToWin = 7;
+    int roundThreads = 0;
+
+    // Win predictor: every match is given win chances as it forms, by a model learned from the results at
+    // {predictorLearningRate} per match (see FWinPredictor). With {bBalanceByPrediction} teams are balanced on what the model
+    // expects of each player rather than on their rating
+    bool bWinPredictor = false;
+    float predictorLearningRate = 0.02f;
+    bool bBalanceByPrediction = false;
+
+    // Ratings: results move the players' ratings by {ratingSystem}, over any number of teams (see FRatingBatch). The matches
+    // ending in one Update_Matches pass are rated together on {ratingThreads} threads (0 for one per core). A rating period
+    // ends every {ratingPeriodSeconds} of simulated time and grows every player's deviation, played or not (see FRatingTable)
+    ERatingSystem ratingSystem = ERatingSystem::Elo;
+    float ratingPeriodSeconds = 60.0f;
+    int ratingThreads = 0;
+
+    // Rematch avoidance: with {bAvoidRematches} a match isn't packed with players who faced each other in their last
+    // FRecentOpponents::MaxRecentOpponents results (see FRematchGuard). The packers that fill teams party by party honor it,
+    // role packing and batch formation don't. Once the longest waiting party has queued {rematchGraceSeconds} it may be
+    // matched regardless
+    bool bAvoidRematches = false;
+    float rematchGraceSeconds = 30.0f;
+
+    // Wait-time SLO: a party breaches it by waiting more than {waitSloSeconds} for its match, or by abandoning the queue
+    float waitSloSeconds = 60.0f;
+
+    void Serialize(FBinaryArchive& Ar);
+};
+
+// Update phases whose work can be cut short by a CPU budget
+enum class EUpdatePhase : uint8_t
+{
+    Matchmake,
+    PlayerEvents,
+    Matches,
+    Arrivals,
+    BatchSolve,
+    Num
+};
+
+// Matchmaking scheduler statistics for the UI
+struct FMatchmakingStats
+{
+    float achievedRate = 0.0f;          // matches formed per simulated second over the last rate window
+    float configuredCap = 0.0f;         // matchesPerCycle * 1000 / matchMakingSystemDelay, the ceiling of the fixed scheduler
+    int cycleDelay = 0;                 // current interval between cycles in ms
+    int lastCycleMatches = 0;
+    int64_t totalCycles = 0;
+    int64_t budgetLimitedCycles = 0;    // cycles that ran out of CPU budget with full matches still queued
+
+    // Parties: a mix of sizes can leave enough queued players for a match that still can't be packed into full teams
+    int64_t packingFailures = 0;        // cycles that stopped because the queued parties didn't pack into teams
+    int64_t splitParties = 0;           // parties larger than teamSize, split into solo players when they queued
+    int activeParties = 0;
+    float avgQueuedPartySize = 0.0f;
+
+    // rating difference between the strongest and weakest team of a match, averaged over all formed matches
+    float avgPackedSpread = 0.0f;       // as packed from the queue
+    float avgTeamSpread = 0.0f;         // after balancing
+
+    // Skill formation
+    int64_t ratingMisses = 0;           // cycles that stopped because no anchor had enough parties within its rating range
+    int64_t windowWidenings = 0;
+    float avgMatchedWindow = 0.0f;      // search window of the parties when they were matched
+    float avgRatingRange = 0.0f;        // highest minus lowest party rating of a match
+
+    // Play style formation
+    int64_t styleMisses = 0;            // cycles that stopped because no anchor had enough parties within its style distance
+    float avgStyleDistance = 0.0f;      // play style distance of a match's parties from its first one, whatever the formation
+
+    // Role queues
+    std::array<int64_t, NumRoles> roleMisses{};         // packs that stopped because the role couldn't be filled
+    std::array<float, NumRoles> roleStarvedSeconds{};   // simulated time matchmaking waited on the role: cycles that missed it count in full
+    std::array<float, NumRoles> avgRoleQueueSeconds{};  // queue time of the players matched into the role
+    std::array<int, NumRoles> queuedByRole{};           // queued solo players declaring the role, flex players count for each of theirs
+
+    // Batch formation
+    int64_t batchSolves = 0;
+    int64_t batchBlocksCut = 0;         // blocks of the queue left for the next batch because a solve ran out of budget
+    float avgBatchSolveMs = 0.0f;       // wall time of a solve
+    float batchSolveMs = 0.0f;          // in total
+
+    // Backfill
+    int openSlots = 0;
+    int64_t backfills = 0;
+    int64_t expiredSlots = 0;           // closed unfilled because too little of the match was left
+    float avgBackfillWait = 0.0f;       // seconds a slot was open before it was filled
+    float avgBackfillGap = 0.0f;        // rating difference between the player who left and the one who took the slot
+
+    // Outcomes, the matches ending in one Update_Matches pass are evaluated together
+    int64_t outcomeBatches = 0;
+    float avgOutcomeBatch = 0.0f;       // matches per batch
+    float favoriteWinRate = 0.0f;       // matches won by the team the model gave the best chance
+    float avgWinnerChance = 0.0f;       // chance the model gave the team that won
+
+    // Rounds, the matches starting in one cycle are played out together
+    int64_t roundMatches = 0;
+    float avgRounds = 0.0f;             // per match played out in rounds
+    float avgRoundBatchMs = 0.0f;       // CPU time to play out the matches of a cycle
+    float avgMatchSeconds = 0.0f;       // of all started matches
+
+    // Win predictor, scored on the chances it gave as the matches formed
+    int64_t predictorUpdates = 0;
+    float avgPredictedFavorite = 0.0f;  // chance of the likelier team, 1 / numTeams when every match is a toss-up
+    float predictorLogLoss = 0.0f;      // over recent results
+    float predictorAccuracy = 0.0f;     // recent results won by the likelier team
+    float predictorRatingWeight = 0.0f; // ln(10) is plain Elo
+
+    // Ratings, the matches ending in one Update_Matches pass are rated together
+    int64_t ratedMatches = 0;
+    int64_t ratingPeriods = 0;
+    float avgRatingBatchMs = 0.0f;      // CPU time to rate the matches of a pass
+    float avgDeviation = 0.0f;          // over every player as the last rating period ended, 0 under Elo
+
+    // Rematches, counted with avoidance off too
+    int64_t rematchMatches = 0;         // formed with two opponents who recently played each other
+    int64_t rematchRejections = 0;      // parties passed over while packing for bringing a rematch
+    int64_t rematchFallbacks = 0;       // matches packed without avoidance after the grace period
+
+    // Wait-time SLO over the parties that left the queue, matched or abandoning
+    int64_t sloBreaches = 0;
+    float sloBreachRate = 0.0f;
+};
+
+// Matchmaking per data center
+struct FRegionStats
+{
+    int queuedPlayers = 0;          // in the region's queue, including parties that spilled over from other regions
+    int64_t matches = 0;
+    int64_t spilledMatches = 0;     // matches with at least one party from another region
+    float avgQueueSeconds = 0.0f;   // queue time of the parties matched here
+    float avgLatencyMs = 0.0f;      // worst member latency of the matches hosted here
+    float cpuMs = 0.0f;             // matchmaking time spent on the region's queue
+};
+
+// Load generated by the arrival process
+struct FArrivalStats
+{
+    float currentRate = 0.0f;   // arrivals per second right now
+    float timeOfDay = 0.0f;     // 0 - 1 through the diurnal cycle
+    int onlinePlayers = 0;      // concurrency: every player that isn't Offline
+    int offlinePlayers = 0;
+    int64_t arrivals = 0;
+    int64_t departures = 0;
+    int64_t disconnects = 0;
+    int64_t reconnects = 0;
+    int64_t reconnectTimeouts = 0;  // disconnected players that never came back
+    int64_t abandonments = 0;       // parties that left the queue unmatched
+    int64_t abandonedPlayers = 0;
+    float avgAbandonSeconds = 0.0f; // how long they waited
+    size_t coldStorageBytes = 0;
 };
 
-extern std::priority_queue<FPlayerRejoin, std::vector<FPlayerRejoin>, std::greater<>> rejoiningPlayers;
+// Work left over by a time-sliced Update() call
+struct FUpdateBacklog
+{
+    int playerEvents = 0;       // due lifecycle events (joining the queue, disconnects...), counted up to BacklogCountLimit
+    int matchEnds = 0;          // finished matches waiting to be processed, counted up to BacklogCountLimit
+    int matchmakeMatches = 0;   // matches left in the interrupted matchmaking cycle
+    float arrivalLagMs = 0.0f;  // how far arrival generation is behind the simulation
+    float lastUpdateMs = 0.0f;  // CPU time of the last Update() call
+    int64_t slicedUpdates = 0;  // calls that left work for the next one
+};
 
 // This system simulates the match making process
 class MatchMakingSystem
@@ -52,7 +364,7 @@ public:
     MatchMakingSystem();
     void Update();
     
-    void CreatePlayer();
+    void CreatePlayer(); // a player with an endless session, independent of the arrival process
     std::vector<VirtualPlayer*> GetTopPlayersByWinRate() const;
     float GetAvgOnlineTime() const;
     float GetAvgQueueTime() const;
@@ -60,44 +372,210 @@ public:
     
     static void RecordToLog(std::vector<std::string>& targetLog, const std::string& message, bool bTimeStamp = true);
 
+    // Checkpoint: writes / restores the full simulation state (players, queue, rejoin heap, matches, RNG and settings) along
+    // with every stats accumulator, so the stats carry on from the save
+    bool SaveCheckpoint(const std::string& path);
+    bool LoadCheckpoint(const std::string& path);
+
+    // Replay: when a recorder is set, inputs and decisions are streamed into it (see ReplayRecorder.h)
+    void SetReplayRecorder(FReplayRecorder* inRecorder);
+    FReplayRecorder* GetReplayRecorder() const { return replayRecorder; } // nullptr once a checkpoint load stopped the recording
+    uint64_t ComputeStateHash() const; // order-independent summary of players, matches and RNG, used to verify replays
+
+    // Replay playback: CPU budgets are ignored and a phase stops only where the recording says the live run did
+    void SetReplayPlayback(bool bInPlayback) { bReplayPlayback = bInPlayback; }
+    void SetReplayWorkLimit(EUpdatePhase phase, int limit) { replayWorkLimits[static_cast<size_t>(phase)] = limit; }
+
     // Getters and Setters
     FMatchSetting GetMatchSetting() const { return MatchSetting; }
-    void SetMatchSetting(FMatchSetting Settings) { MatchSetting = Settings; }
+    void SetMatchSetting(FMatchSetting Settings);
+    const FArrivalSetting& GetArrivalSetting() const { return ArrivalSetting; }
+    void SetArrivalSetting(const FArrivalSetting& Settings);
+    FArrivalStats GetArrivalStats() const;
+    float GetArrivalElapsedSeconds() const { return arrivalProcess.GetElapsedSeconds(SimNow()); } // burst start times are relative to this
     const std::unordered_set<int>& GetOngoingMatchIds() const { return ongoingMatchIds; }
+    int GetNumQueuedPlayers() const { return numQueuedPlayers; }
+    const FPartyQueue& GetRegionQueue(int region) const { return regionQueues[region]; }
+    FRegionStats GetRegionStats(int region) const;
+    FMatchmakingStats GetMatchmakingStats() const;
+    const FUpdateBacklog& GetUpdateBacklog() const { return updateBacklog; }
     const std::vector<std::string>& GetMatchLog() const { return matchLog; }
     const std::vector<std::string>& GetPlayerLog() const { return playerLog; }
     VirtualPlayer GetCurrentLeadingPlayer() const { return currentLeadingPlayer; }
-    const std::unordered_map<int, VirtualPlayer>& GetAllPlayers() const { return allPlayersLookupMap; }
+    const std::unordered_map<int, VirtualPlayer>& GetAllPlayers() const { return allPlayersLookupMap; } // active players, offline ones are in cold storage
+    int GetNextPlayerId() const { return nextPlayerId; } // ids are dense in [0, GetNextPlayerId())
     const std::unordered_map<int, FMatch>& GetAllMatches() const { return allMatchesLookupMap; }
 
 private:
+    friend class FMatchMakingBenchmark; // benchmarks drive the update phases directly
+
     void Update_Matchmake(const int& Interval); // interval in millisecond
     void Update_Matches();
-    void Update_RejoiningPlayers();
+    void AddOutcomeMatch(const FMatch& match, FOutcomeBatch& batch); // as its players are right now
+    void StartMatch(FMatch& match, float duration);
+    void PlayRounds(); // starts the matches waiting in startingMatches
+    void GetPredictorFeatures(const FMatch& match); // to predictorTeams, as its players are right now
+    void LearnMatchResult(const FMatch& match);
+    void AddRatedMatch(const FMatch& match); // to ratingBatch, as its players are right now
+    void RecordOpponents(const FMatch& match);
+    bool IsRematch(const FMatch& match) const;
+    void RateMatches(); // moves the ratings of the matches in ratingBatch
+    void Update_RatingPeriod();
+    void Update_PlayerEvents();
+    void Update_Arrivals();
     
     void UpdateLeaderboard(const FMatch& match);
     void ReportMatchResult(const FMatch& match);
-    void AddPlayerToRejoiningQueue(VirtualPlayer* player);
+    VirtualPlayer& AddNewPlayer(int region = -1); // a random region by the arrival weights unless given
+    void LogInPlayer(VirtualPlayer& player, float sessionLength);
+    void LogOutPlayer(VirtualPlayer& player); // moves the player into cold storage, {player} is invalid afterwards
+    void SetPlayerIdle(VirtualPlayer& player); // Online, or Offline if the session is over
+    void SchedulePlayerEvent(const VirtualPlayer& player, EPlayerEvent type, float delaySeconds);
+    void HandlePlayerEvent(const FPlayerEvent& event);
+    void ScheduleDisconnect(const VirtualPlayer& player, float remainingMatchTime);
+    VirtualPlayer* RestoreFromColdStorage(int playerId);
+    void FormParty(const std::vector<int>& memberIds); // the first member leads
+    void DisbandParty(int leaderId); // members carry on as solo players, queued members keep queueing
+    void EnqueueParty(VirtualPlayer& leader);
+    void QueueParty(int leaderId, int partySize); // into the party's best data center
+    bool RemoveQueuedParty(int leaderId); // from every region queue it is listed in
+    void SpillOver(VirtualPlayer& leader);
+    void WidenSearchWindow(VirtualPlayer& leader);
+    void ScheduleAbandonment(const VirtualPlayer& leader); // when its patience runs out, counted from the time it already waited
+    void AbandonQueue(VirtualPlayer& leader);
+    void ScheduleWindowWidening(const VirtualPlayer& leader, float searchWindow); // at the next step, unless it is already at the maximum
+    float GetSearchWindow(float secondsInQueue) const;
+    float GetPartyRating(int leaderId) const; // average over the members
+    FPlayStyle GetPartyPlayStyle(int leaderId) const; // average over the members, rounded
+    void RebuildRegionQueues();
+    int GetPartyLatency(int leaderId, int dataCenter) const; // worst member latency
+    int GetBestDataCenter(int leaderId) const;
+    template <typename TFormation>
+    void MatchmakeRegions(const TFormation& formation, int maxMatches, std::chrono::steady_clock::time_point deadline, int& startedMatches, bool& bBudgetLimited);
+    template <typename TFormation, typename TRegions>
+    void MatchmakeQueues(const TFormation& formation, int maxMatches, std::chrono::steady_clock::time_point deadline, int& startedMatches, bool& bBudgetLimited);
+    int GetLowestLatencyDataCenter(const std::vector<std::vector<int>>& teamLeaders) const; // for the worst member of the match
+    void FormMatch(const std::vector<std::vector<int>>& teamLeaders, int dataCenter);
+    void Update_Backfill(); // fills open slots from the queues, before a cycle forms new matches
+    void SolveBatches(); // plans the matches of a batch cycle for every queue
+    void OpenBackfillSlot(const VirtualPlayer& player); // for a player who dropped out of their match
+    void FillSlot(const FOpenSlot& slot, VirtualPlayer& player);
+    void SerializeState(FBinaryArchive& Ar);
+    bool IsOverBudget(EUpdatePhase phase, int processed, std::chrono::steady_clock::time_point deadline);
     
     FMatchSetting MatchSetting;
+    FArrivalSetting ArrivalSetting;
     
-    // stores all players, regardless of state, using a map lookup for faster iteration because it is assumed to have a big player pool
+    // stores all active players, using a map lookup for faster iteration because it is assumed to have a big player pool
     std::unordered_map<int, VirtualPlayer> allPlayersLookupMap;
+    int nextPlayerId = 0;
+
+    // offline players, serialized so they cost a compact blob instead of a live VirtualPlayer
+    std::unordered_map<int, std::vector<char>> coldPlayers;
+    size_t coldStorageBytes = 0;
     
     // Stores all matches' history
     std::unordered_map<int, FMatch> allMatchesLookupMap;
 
-    // Track player IDs of players currently in the queue
-    std::unordered_set<int> queuedPlayerIDs;
+    // Parties (solo players included) currently queued, one queue per data center, bucketed by size and ordered by the time they joined.
+    // A party is listed in its home queue plus every queue it spilled over into
+    struct FQueuedParty
+    {
+        int8_t homeRegion = -1; // -1 when not queued
+        uint8_t size = 0;
+        float rating = 0.0f;
+        float searchWindow = FPartyQueue::AnyRating;
+        FRoleMask roles = 0; // the leader's
+        FPlayStyle style{};  // the members' average
+    };
+    std::array<FPartyQueue, NumRegions> regionQueues;
+    std::vector<FQueuedParty> queuedPartyInfo; // by leader id
+    int numQueuedPlayers = 0;
+    int numQueuedParties = 0;
+    int matchmakeRegion = 0; // region the next cycle starts with
+    std::array<FRegionStats, NumRegions> regionStats;
+    std::array<double, NumRegions> regionWaitTotals{};
+    std::array<int64_t, NumRegions> regionMatchedParties{};
+    std::array<double, NumRegions> regionLatencyTotals{};
+
+    // members of every active party by leader id, the leader first. Solo players have no entry
+    std::unordered_map<int, std::vector<int>> parties;
 
-    // Tracking players that are idle and waiting to go into queue
-    std::priority_queue<FPlayerRejoin, std::vector<FPlayerRejoin>, std::greater<>> rejoiningPlayers;
+    // Timed lifecycle events: idle players joining the queue, session ends, disconnects and reconnects
+    TTimedHeap<FPlayerEvent> playerEvents;
 
     // Ongoing matches that gets updated
     //std::vector<FMatch> ongoingMatches;
 
-    // Ongoing match ids
+    // Ongoing match ids, and their end times so Update_Matches only touches the matches that finished
     std::unordered_set<int> ongoingMatchIds;
+    TTimedHeap<FMatchEnd> matchEnds;
+
+    // outcomes of the finished matches, evaluated in batches of up to MaxOutcomeBatch
+    static constexpr size_t MaxOutcomeBatch = 256;
+    FOutcomeModel outcomeModel;
+    FOutcomeBatch outcomeBatch;
+    std::vector<FMatch*> endingMatches; // in the batch's match order
+    int64_t numOutcomeBatches = 0;
+    int64_t numOutcomeMatches = 0;     // evaluated, a match put back by a budget cut is evaluated again
+    int64_t numModelResults = 0;       // matches won as the model decided
+    int64_t numFavoriteWins = 0;
+    double totalWinnerChance = 0.0;
+
+    // matches formed this cycle that wait to be played out in rounds
+    FRoundModel roundModel;
+    FRoundBatch roundBatch;
+    std::vector<FMatch*> startingMatches;
+    int64_t numRoundBatches = 0;
+    int64_t numRoundMatches = 0;
+    int64_t totalRounds = 0;
+    double totalRoundMs = 0.0;
+    int64_t numStartedMatches = 0;
+    double totalMatchSeconds = 0.0;
+
+    // win predictor, scratch sized to the teams of a match
+    FWinPredictor winPredictor;
+    std::vector<FWinPredictor::FFeatures> predictorTeams;
+    std::vector<float> predictorChances;
+    int64_t numPredictions = 0;
+    double totalPredictedFavorite = 0.0;
+    int64_t numScoredPredictions = 0;
+    double recentLogLoss = 0.0;        // moving averages over about PredictorWindow results
+    double recentAccuracy = 0.0;
+
+    // ratings stay on the players, their deviations and volatilities are in the table by player id
+    FRatingModel ratingModel;
+    FRatingTable ratingTable;
+    FRatingBatch ratingBatch;
+    std::chrono::steady_clock::time_point lastRatingPeriod;
+    int64_t numRatingBatches = 0;
+    int64_t numRatedMatches = 0;
+    double totalRatingMs = 0.0;
+    int64_t numRatingPeriods = 0;
+    float lastAvgDeviation = 0.0f;
+
+    // recent opponents by player id, the guard checks the parties being packed against them
+    FRecentOpponents recentOpponents;
+    FRematchGuard rematchGuard;
+    int64_t numRematchMatches = 0;
+    int64_t numRematchFallbacks = 0;
+
+    // parties that left the queue, and the ones among them that breached the wait-time SLO
+    int64_t numSloParties = 0;
+    int64_t numSloBreaches = 0;
+
+    // Load generation, offline players are kept for arrivals that return to the game
+    FArrivalProcess arrivalProcess;
+    std::vector<int> offlinePlayerIds;
+    int numOnlinePlayers = 0;
+    int64_t numArrivals = 0;
+    int64_t numDepartures = 0;
+    int64_t numDisconnects = 0;
+    int64_t numReconnects = 0;
+    int64_t numReconnectTimeouts = 0;
+    int64_t numAbandonments = 0;
+    int64_t numAbandonedPlayers = 0;
+    double totalAbandonSeconds = 0.0;
 
     // UI logging
     std::vector<std::string> matchLog;
@@ -109,4 +587,54 @@ private:
 
     // helper trackers
     int matchMakingSystemDelay = 500;
+
+    // team balancing, the unit buffers are reused by every match
+    FTeamBalancer teamBalancer;
+    std::vector<std::vector<FBalanceUnit>> balanceTeams;
+    double totalPackedSpread = 0.0;
+    double totalTeamSpread = 0.0;
+    int64_t numBalancedMatches = 0;
+    double totalMatchedWindow = 0.0;
+    int64_t numWindowParties = 0;
+    double totalRatingRange = 0.0;
+    double totalStyleDistance = 0.0;
+    int64_t numStyleDistances = 0;
+
+    // role queues, the roles missed by a cycle are charged with the time until the next one
+    FRoleMask cycleMissingRoles = 0;
+    std::array<double, NumRoles> roleStarvedSeconds{};
+    std::array<double, NumRoles> roleWaitTotals{};
+    std::array<int64_t, NumRoles> roleMatchedPlayers{};
+    std::array<int, NumRoles> numQueuedByRole{};
+
+    // backfill, open slots are closed when filled, when their match ends or when the player who left comes back
+    FBackfillIndex backfillIndex;
+    int64_t numBackfills = 0;
+    int64_t numExpiredSlots = 0;
+    double totalBackfillWait = 0.0;
+    double totalBackfillGap = 0.0;
+
+    // batch formation, the plans are solved at the start of a cycle and handed out until the next one
+    FBatchSolver batchSolver;
+    std::array<FBatchPlan, NumRegions> batchPlans;
+    int64_t numBatchSolves = 0;
+    int64_t numBatchBlocksCut = 0;
+    double totalBatchSolveMs = 0.0;
+
+    // adaptive scheduler, {cycleDelay} is the interval used when MatchSetting.bAdaptiveScheduling is on
+    int cycleDelay = 500;
+    FMatchmakingStats matchmakingStats;
+    std::chrono::steady_clock::time_point rateWindowStart;
+    int rateWindowMatches = 0;
+
+    // time slicing, the deadline is only set inside Update() so phases called directly run unbudgeted
+    std::chrono::steady_clock::time_point updateDeadline = std::chrono::steady_clock::time_point::max();
+    int matchmakeCarryOver = 0; // matches left in a cycle that ran out of budget, formed by the next call
+    FUpdateBacklog updateBacklog;
+
+    // replay recording
+    FReplayRecorder* replayRecorder = nullptr;
+    std::chrono::steady_clock::time_point lastUpdateTime;
+    bool bReplayPlayback = false;
+    std::array<int, static_cast<size_t>(EUpdatePhase::Num)> replayWorkLimits;
 };
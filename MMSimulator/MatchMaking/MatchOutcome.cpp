@@ -0,0 +1,197 @@
+#include "MatchOutcome.h"
+
+#include <algorithm>
+#include <cmath>
+
+void FOutcomeBatch::Clear()
+{
+    ratings.clear();
+    for (std::vector<float>& stat : stats)
+    {
+        stat.clear();
+    }
+    for (std::vector<float>* factors : { &streaks, &experience, &inParty, &partyLeader, &leader, &teamOriented, &loneWolf, &streaky,
+        &confident, &tiltProne, &nervous, &metaAdaptive, &unpredictable })
+    {
+        factors->clear();
+    }
+    playerMatch.clear();
+    teamPlayers.assign(1, 0);
+    teamAbsent.clear();
+    matchTeams.assign(1, 0);
+}
+
+void FOutcomeBatch::BeginMatch()
+{
+    matchTeams.push_back(matchTeams.back());
+}
+
+void FOutcomeBatch::BeginTeam()
+{
+    ++matchTeams.back();
+    teamPlayers.push_back(teamPlayers.back());
+    teamAbsent.push_back(0);
+}
+
+void FOutcomeBatch::AddAbsentPlayer()
+{
+    ++teamAbsent.back();
+}
+
+void FOutcomeBatch::AddPlayer(const FOutcomePlayer& player)
+{
+    auto flag = [&player](EPlayerTrait trait)
+    {
+        return HasTrait(player.traits, trait) ? 1.0f : 0.0f;
+    };
+    ratings.push_back(player.rating);
+    for (int stat = 0; stat < NumPlayStyleStats; ++stat)
+    {
+        stats[stat].push_back(static_cast<float>(player.style[stat] - PlayStyleBase));
+    }
+    streaks.push_back(static_cast<float>(player.streak));
+    experience.push_back(static_cast<float>(player.matchesPlayed));
+    inParty.push_back(player.bInParty ? 1.0f : 0.0f);
+    partyLeader.push_back(player.bPartyLeader ? 1.0f : 0.0f);
+    leader.push_back(flag(EPlayerTrait::Leader));
+    teamOriented.push_back(flag(EPlayerTrait::TeamOriented));
+    loneWolf.push_back(flag(EPlayerTrait::LoneWolf));
+    streaky.push_back(flag(EPlayerTrait::Streaky));
+    confident.push_back(flag(EPlayerTrait::Confident));
+    tiltProne.push_back(flag(EPlayerTrait::TiltProne));
+    nervous.push_back(flag(EPlayerTrait::Nervous));
+    metaAdaptive.push_back(flag(EPlayerTrait::MetaAdaptive));
+    unpredictable.push_back(flag(EPlayerTrait::Unpredictable));
+    playerMatch.push_back(NumMatches() - 1);
+    ++teamPlayers.back();
+}
+
+void FOutcomeBatch::Evaluate(const FOutcomeModel& model)
+{
+    const int numPlayers = NumPlayers();
+    const int numTeams = static_cast<int>(teamPlayers.size()) - 1;
+    const int numMatches = NumMatches();
+
+    // ratings per team, then how close each match is and how unpredictable its players make it
+    teamRatings.resize(numTeams);
+    for (int t = 0; t < numTeams; ++t)
+    {
+        float total = 0.0f;
+        for (int i = teamPlayers[t]; i < teamPlayers[t + 1]; ++i)
+        {
+            total += ratings[i];
+        }
+        teamRatings[t] = total / static_cast<float>(std::max(teamPlayers[t + 1] - teamPlayers[t], 1));
+    }
+    matchPressures.resize(numMatches);
+    matchScales.resize(numMatches);
+    for (int m = 0; m < numMatches; ++m)
+    {
+        const int firstTeam = matchTeams[m];
+        const int lastTeam = matchTeams[m + 1];
+        float gap = 0.0f;
+        if (lastTeam - firstTeam > 1)
+        {
+            auto [weakest, strongest] = std::minmax_element(teamRatings.begin() + firstTeam, teamRatings.begin() + lastTeam);
+            gap = *strongest - *weakest;
+        }
+        matchPressures[m] = lastTeam - firstTeam > 1 ? std::clamp(1.0f - gap / std::max(model.pressureRange, 1.0f), 0.0f, 1.0f) : 0.0f;
+
+        float share = 0.0f;
+        for (int i = teamPlayers[firstTeam]; i < teamPlayers[lastTeam]; ++i)
+        {
+            share += unpredictable[i];
+        }
+        share /= static_cast<float>(std::max(teamPlayers[lastTeam] - teamPlayers[firstTeam], 1));
+        matchScales[m] = std::max(model.outcomeScale, 1.0f) * (1.0f + model.unpredictableSpread * share);
+    }
+
+    // performance of every player in the batch, one pass per term
+    pressure.resize(numPlayers);
+    performance.resize(numPlayers);
+    for (int i = 0; i < numPlayers; ++i)
+    {
+        pressure[i] = matchPressures[playerMatch[i]];
+    }
+    const float maxStreak = static_cast<float>(std::max(model.maxStreak, 0));
+    const float adaptRate = 1.0f / static_cast<float>(std::max(model.matchesToAdapt, 1));
+    for (int i = 0; i < numPlayers; ++i)
+    {
+        const float streak = std::clamp(streaks[i], -maxStreak, maxStreak);
+        const float wins = std::max(streak, 0.0f);
+        const float losses = std::max(-streak, 0.0f);
+        const float adapted = std::min(experience[i] * adaptRate, 1.0f);
+        performance[i] = ratings[i]
+            + model.leaderBonus * leader[i] * partyLeader[i]
+            + model.familiarBonus * teamOriented[i] * inParty[i]
+            - model.loneWolfPenalty * loneWolf[i] * inParty[i]
+            + model.streakWeight * streaky[i] * streak
+            + model.confidenceWeight * confident[i] * wins
+            - model.tiltWeight * tiltProne[i] * losses
+            - model.nervousPenalty * nervous[i] * pressure[i]
+            + model.adaptiveBonus * metaAdaptive[i] * adapted;
+    }
+    for (int stat = 0; stat < NumPlayStyleStats; ++stat)
+    {
+        const float weight = model.statWeights[stat];
+        const float* values = stats[stat].data();
+        for (int i = 0; i < numPlayers; ++i)
+        {
+            performance[i] += weight * values[i];
+        }
+    }
+
+    // strengths per team, and the softmax over each match on the outcome scale
+    teamStrengths.resize(numTeams);
+    teamChances.resize(numTeams);
+    for (int t = 0; t < numTeams; ++t)
+    {
+        float total = 0.0f;
+        for (int i = teamPlayers[t]; i < teamPlayers[t + 1]; ++i)
+        {
+            total += performance[i];
+        }
+        const int present = teamPlayers[t + 1] - teamPlayers[t];
+        const float absentShare = static_cast<float>(teamAbsent[t]) / static_cast<float>(std::max(present + teamAbsent[t], 1));
+        teamStrengths[t] = total / static_cast<float>(std::max(present, 1)) - model.absentPenalty * absentShare;
+    }
+    for (int m = 0; m < numMatches; ++m)
+    {
+        const int firstTeam = matchTeams[m];
+        const int lastTeam = matchTeams[m + 1];
+        if (firstTeam == lastTeam)
+        {
+            continue;
+        }
+        const float strongest = *std::max_element(teamStrengths.begin() + firstTeam, teamStrengths.begin() + lastTeam);
+        float total = 0.0f;
+        for (int t = firstTeam; t < lastTeam; ++t)
+        {
+            teamChances[t] = std::pow(10.0f, (teamStrengths[t] - strongest) / matchScales[m]);
+            total += teamChances[t];
+        }
+        for (int t = firstTeam; t < lastTeam; ++t)
+        {
+            teamChances[t] /= total;
+        }
+    }
+}
+
+int FOutcomeBatch::SampleWinner(int match, float random) const
+{
+    const int numTeams = GetNumTeams(match);
+    if (numTeams == 0)
+    {
+        return -1;
+    }
+    // the last team takes whatever rounding leaves above the sum of the others
+    for (int team = 0; team < numTeams - 1; ++team)
+    {
+        random -= GetWinChance(match, team);
+        if (random < 0.0f)
+        {
+            return team;
+        }
+    }
+    return numTeams - 1;
+}
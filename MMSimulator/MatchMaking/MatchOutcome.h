@@ -0,0 +1,95 @@
+#pragma once
+#include <array>
+#include <vector>
+
+#include "PlayStyle.h"
+#include "PlayerTrait.h"
+
+// Weights of the outcome model, in rating points of a player's performance
+struct FOutcomeModel
+{
+    // per point a stat is above PlayStyleBase: agr, fle, gri, end, ins, cre, pre
+    std::array<float, NumPlayStyleStats> statWeights = { 3.0f, 3.0f, 5.0f, 3.0f, 6.0f, 3.0f, 6.0f };
+    float leaderBonus = 30.0f;          // Leader, while leading their party
+    float familiarBonus = 25.0f;        // TeamOriented, while playing with their party
+    float loneWolfPenalty = 25.0f;      // LoneWolf, while playing with a party
+    float streakWeight = 10.0f;         // Streaky, per match of their streak, either way
+    float confidenceWeight = 8.0f;      // Confident, per win of their streak
+    float tiltWeight = 15.0f;           // TiltProne, per loss of their streak
+    float nervousPenalty = 40.0f;       // Nervous, in a match as close as it gets
+    float adaptiveBonus = 30.0f;        // MetaAdaptive, once they played {matchesToAdapt} matches
+    float absentPenalty = 200.0f;       // off a team's strength, times the share of its players who left the game for good
+    float unpredictableSpread = 1.0f;   // Unpredictable, widens the outcome scale by this share of the match's players with the trait
+    float outcomeScale = 400.0f;        // team strength difference that makes the favorite ten times likelier to win
+    float pressureRange = 200.0f;       // team rating gap under which a match counts as pressure, fully so at 0
+    int maxStreak = 5;                  // streak terms stop growing here
+    int matchesToAdapt = 50;
+};
+
+// What the model reads of a player
+struct FOutcomePlayer
+{
+    float rating = 0.0f;
+    FPlayStyle style{};
+    EPlayerTrait traits = EPlayerTrait::None;
+    int streak = 0;         // consecutive wins (> 0) or losses (< 0)
+    int matchesPlayed = 0;
+    bool bInParty = false;
+    bool bPartyLeader = false;
+};
+
+// Outcome model evaluated for a batch of matches at once.
+// A player's performance is their rating plus their weighted stats plus the terms of their traits in the situation they play in.
+// A team's strength is the average performance of the players still in the game, less a penalty for the ones who left, and a team wins with the softmax of the strengths on the Elo
+// scale, so for two teams the favorite wins as often as Elo expects of the strength gap.
+// Players are stored as a structure of arrays, traits and situations as 0 / 1 factors, so every pass of Evaluate is a
+// branch-free loop over contiguous floats that the compiler can vectorize across all players of the batch
+class FOutcomeBatch
+{
+public:
+    void Clear();
+    void BeginMatch();  // the players added next belong to a new match, teams are opened with BeginTeam
+    void BeginTeam();
+    void AddPlayer(const FOutcomePlayer& player);
+    void AddAbsentPlayer(); // a player who left the game, only their missing place counts
+
+    void Evaluate(const FOutcomeModel& model); // fills the win chances of every team of the batch
+    // the team of match {match} (in BeginMatch order) that {random} in [0, 1] picks according to the win chances, -1 without teams
+    int SampleWinner(int match, float random) const;
+    float GetWinChance(int match, int team) const { return teamChances[matchTeams[match] + team]; }
+    float GetTeamStrength(int match, int team) const { return teamStrengths[matchTeams[match] + team]; }
+    int GetNumTeams(int match) const { return matchTeams[match + 1] - matchTeams[match]; }
+    int NumMatches() const { return static_cast<int>(matchTeams.size()) - 1; }
+    int NumPlayers() const { return static_cast<int>(ratings.size()); }
+
+private:
+    // players
+    std::vector<float> ratings;
+    std::array<std::vector<float>, NumPlayStyleStats> stats;   // minus PlayStyleBase
+    std::vector<float> streaks;         // clamped to the model's maxStreak when evaluated
+    std::vector<float> experience;      // matches played
+    std::vector<float> inParty;         // 0 / 1
+    std::vector<float> partyLeader;
+    std::vector<float> leader;          // trait flags, 0 / 1
+    std::vector<float> teamOriented;
+    std::vector<float> loneWolf;
+    std::vector<float> streaky;
+    std::vector<float> confident;
+    std::vector<float> tiltProne;
+    std::vector<float> nervous;
+    std::vector<float> metaAdaptive;
+    std::vector<float> unpredictable;
+    std::vector<int> playerMatch;
+    std::vector<float> pressure;        // of the player's match, 0 - 1
+    std::vector<float> performance;
+
+    // teams and matches, each lists where its players / teams begin with one entry past the last
+    std::vector<int> teamPlayers = { 0 };
+    std::vector<int> teamAbsent;
+    std::vector<float> teamRatings;     // average rating of the players present
+    std::vector<float> teamStrengths;   // average performance
+    std::vector<float> teamChances;
+    std::vector<int> matchTeams = { 0 };
+    std::vector<float> matchPressures;
+    std::vector<float> matchScales;     // outcome scale
+};
@@ -0,0 +1,151 @@
+#include "MatchRounds.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+#include "PlayStyle.h"
+#include "TraceRecorder.h"
+
+namespace
+{
+    float NextUnit(Xoshiro256SS& rng)
+    {
+        return rng.Next() / static_cast<float>(UINT64_MAX);
+    }
+}
+
+void FRoundBatch::Clear()
+{
+    matchTeams.assign(1, 0);
+    matchRngs.clear();
+    roundLengths.clear();
+    matchAggressiveness.clear();
+    matchRounds.clear();
+    matchDurations.clear();
+    matchWinners.clear();
+    teamStrengths.clear();
+    teamFatigue.clear();
+    teamGrit.clear();
+    teamScores.clear();
+}
+
+void FRoundBatch::AddMatch(uint64_t seed, float roundSeconds, float aggressiveness)
+{
+    matchTeams.push_back(matchTeams.back());
+    matchRngs.emplace_back().Seed(seed);
+    roundLengths.push_back(std::max(roundSeconds, 0.0f));
+    matchAggressiveness.push_back(aggressiveness);
+    matchRounds.push_back(0);
+    matchDurations.push_back(0.0f);
+    matchWinners.push_back(-1);
+}
+
+void FRoundBatch::AddTeam(float strength, float endurance, float grit)
+{
+    ++matchTeams.back();
+    teamStrengths.push_back(strength);
+    // base endurance wears at the model's rate, the highest not at all and the lowest twice as fast
+    const float range = static_cast<float>(MaxPlayStyleStat - PlayStyleBase);
+    teamFatigue.push_back(std::clamp(1.0f - endurance / range, 0.0f, 2.0f));
+    teamGrit.push_back(grit);
+    teamScores.push_back(0);
+}
+
+void FRoundBatch::Simulate(const FRoundModel& model, int roundsToWin, int numThreads)
+{
+    const int numMatches = NumMatches();
+    roundChances.resize(teamStrengths.size());
+    roundsToWin = std::max(roundsToWin, 1);
+
+    // slices are cut by match count alone, so the threads only change who plays which match, never its rounds
+    if (numThreads <= 0)
+    {
+        numThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    numThreads = std::clamp(numThreads, 1, std::max(1, numMatches / MinMatchesPerThread));
+    auto sliceBegin = [numMatches, numThreads](int slice)
+    {
+        return static_cast<int>(static_cast<int64_t>(numMatches) * slice / numThreads);
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(static_cast<size_t>(numThreads - 1));
+    for (int slice = 1; slice < numThreads; ++slice)
+    {
+        threads.emplace_back([this, &model, roundsToWin, begin = sliceBegin(slice), end = sliceBegin(slice + 1)]()
+            {
+                SimulateSlice(model, roundsToWin, begin, end);
+            });
+    }
+    SimulateSlice(model, roundsToWin, 0, sliceBegin(1));
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void FRoundBatch::SimulateSlice(const FRoundModel& model, int roundsToWin, int begin, int end)
+{
+    MM_TRACE_SCOPE("SimulateRounds");
+    const float scale = std::max(model.roundScale, 1.0f);
+
+    // every pass plays the next round of all matches of the slice that are still going
+    for (int playing = end - begin; playing > 0;)
+    {
+        playing = 0;
+        for (int m = begin; m < end; ++m)
+        {
+            const int firstTeam = matchTeams[m];
+            const int lastTeam = matchTeams[m + 1];
+            if (matchWinners[m] >= 0 || firstTeam == lastTeam)
+            {
+                continue;
+            }
+
+            const int leaderScore = *std::max_element(teamScores.begin() + firstTeam, teamScores.begin() + lastTeam);
+            const float rounds = static_cast<float>(matchRounds[m]);
+            float strongest = std::numeric_limits<float>::lowest();
+            for (int t = firstTeam; t < lastTeam; ++t)
+            {
+                roundChances[t] = teamStrengths[t]
+                    - model.fatigue * teamFatigue[t] * rounds
+                    + model.gritWeight * teamGrit[t] * static_cast<float>(leaderScore - teamScores[t]);
+                strongest = std::max(strongest, roundChances[t]);
+            }
+            float total = 0.0f;
+            for (int t = firstTeam; t < lastTeam; ++t)
+            {
+                roundChances[t] = std::pow(10.0f, (roundChances[t] - strongest) / scale);
+                total += roundChances[t];
+            }
+
+            // the last team takes whatever rounding leaves above the sum of the others
+            Xoshiro256SS& rng = matchRngs[m];
+            float random = NextUnit(rng) * total;
+            int winner = lastTeam - 1;
+            for (int t = firstTeam; t < lastTeam - 1; ++t)
+            {
+                random -= roundChances[t];
+                if (random < 0.0f)
+                {
+                    winner = t;
+                    break;
+                }
+            }
+
+            const float pace = std::max(1.0f - model.paceWeight * matchAggressiveness[m], 0.25f);
+            const float jitter = 1.0f + model.roundJitter * (2.0f * NextUnit(rng) - 1.0f);
+            matchDurations[m] += roundLengths[m] * pace * std::max(jitter, 0.0f);
+            ++matchRounds[m];
+            if (++teamScores[winner] >= roundsToWin)
+            {
+                matchWinners[m] = winner - firstTeam;
+            }
+            else
+            {
+                ++playing;
+            }
+        }
+    }
+}
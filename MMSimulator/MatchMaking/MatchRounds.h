@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Xoshiro256SS.h"
+
+// How rounds are played out, strengths in rating points as the outcome model gives them (see FOutcomeBatch)
+struct FRoundModel
+{
+    float roundScale = 800.0f;      // round strength difference that makes a team ten times likelier to take the round
+    float fatigue = 6.0f;           // strength a team loses per round played at base endurance, none at the highest
+    float gritWeight = 4.0f;        // per point of grit above base, per round the team trails the leader
+    float paceWeight = 0.06f;       // share of a round's length saved per point of aggressiveness above base, over the match's players
+    float roundJitter = 0.3f;       // rounds run this share shorter or longer at random
+};
+
+// Matches played out round by round, for a batch of matches at once.
+// A match goes on until one of its teams has taken {roundsToWin} rounds. Every round each team's strength is its base strength,
+// less the fatigue of the rounds played so far, plus the grit of a team that trails, and one team takes the round with the
+// softmax of these on {roundScale}. Round lengths follow the match's aggressiveness, so the rounds decide both who wins and how
+// long the match lasts.
+// Matches and teams are stored as a structure of arrays. Every match draws from its own generator, seeded when it was added,
+// so the results don't depend on how the batch is split: the matches are cut into contiguous slices that are stepped a round
+// at a time, all matches of a slice together, on as many threads as asked for
+class FRoundBatch
+{
+public:
+    static constexpr int MinMatchesPerThread = 64;
+
+    void Clear();
+    void AddMatch(uint64_t seed, float roundSeconds, float aggressiveness); // aggressiveness above base, average of the players
+    void AddTeam(float strength, float endurance, float grit); // to the last match, stats above base, averages of the players
+
+    void Simulate(const FRoundModel& model, int roundsToWin, int numThreads); // numThreads 0 for one per core
+
+    int NumMatches() const { return static_cast<int>(matchTeams.size()) - 1; }
+    int GetNumTeams(int match) const { return matchTeams[match + 1] - matchTeams[match]; }
+    int GetRounds(int match) const { return matchRounds[match]; }
+    float GetDuration(int match) const { return matchDurations[match]; } // seconds
+    int GetScore(int match, int team) const { return teamScores[matchTeams[match] + team]; }
+    int GetWinner(int match) const { return matchWinners[match]; } // -1 without teams
+
+private:
+    void SimulateSlice(const FRoundModel& model, int roundsToWin, int begin, int end);
+
+    // matches, teams list where they begin with one entry past the last
+    std::vector<int> matchTeams = { 0 };
+    std::vector<Xoshiro256SS> matchRngs;
+    std::vector<float> roundLengths;    // before pace and jitter
+    std::vector<float> matchAggressiveness;
+    std::vector<int> matchRounds;
+    std::vector<float> matchDurations;
+    std::vector<int> matchWinners;
+
+    // teams
+    std::vector<float> teamStrengths;
+    std::vector<float> teamFatigue;     // share of the model's fatigue, 0 - 2
+    std::vector<float> teamGrit;
+    std::vector<int> teamScores;
+    std::vector<float> roundChances;    // scratch, every slice only writes its own teams
+};
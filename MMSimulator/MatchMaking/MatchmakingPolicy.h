@@ -0,0 +1,165 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "BatchFormer.h"
+#include "PlayerQueue.h"
+#include "Region.h"
+
+// How the parties of one match are picked from a queue
+enum class EMatchFormation : uint8_t
+{
+    Fifo,           // longest waiting first, ratings are ignored
+    SkillBuckets,   // only parties in the same fixed-width rating bucket as the anchor
+    SkillWindows,   // parties mutually within their search windows, which widen while they wait
+    Roles,          // solo players filling a fixed role composition per team, parties queue as solo players
+    Batch,          // the whole queue solved at once for the matches with the lowest total rating and latency cost
+    PlayStyle,      // parties whose play style is within a fixed distance of the anchor's, closest first
+};
+
+inline const char* GetFormationName(EMatchFormation formation)
+{
+    switch (formation)
+    {
+    case EMatchFormation::Fifo: return "FIFO";
+    case EMatchFormation::SkillBuckets: return "Skill Buckets";
+    case EMatchFormation::SkillWindows: return "Skill Windows";
+    case EMatchFormation::Roles: return "Roles";
+    case EMatchFormation::Batch: return "Batch";
+    case EMatchFormation::PlayStyle: return "Play Style";
+    }
+    return "Unknown";
+}
+
+// Matchmaking policies. Update_Matchmake resolves the formation and region policy once per cycle and runs a loop compiled for
+// that pair, so forming a match goes through no virtual call and no per-match branch on the settings
+
+// Formation policies: FormTeams packs one match from {queue}, bRatingIndex, bRoleIndex and bStyleIndex tell which indices the
+// queues need
+
+struct FFifoFormation
+{
+    static constexpr bool bRatingIndex = false;
+    static constexpr bool bRoleIndex = false;
+    static constexpr bool bStyleIndex = false;
+
+    bool FormTeams(FPartyQueue& queue, int numTeams, int teamSize, std::vector<std::vector<int>>& outTeams) const
+    {
+        return queue.PackTeams(numTeams, teamSize, outTeams);
+    }
+};
+
+struct FSkillBucketFormation
+{
+    static constexpr bool bRatingIndex = true;
+    static constexpr bool bRoleIndex = false;
+    static constexpr bool bStyleIndex = false;
+    float bucketWidth = 100.0f;
+
+    bool FormTeams(FPartyQueue& queue, int numTeams, int teamSize, std::vector<std::vector<int>>& outTeams) const
+    {
+        return queue.PackWithinBuckets(numTeams, teamSize, bucketWidth, outTeams);
+    }
+};
+
+struct FSkillWindowFormation
+{
+    static constexpr bool bRatingIndex = true;
+    static constexpr bool bRoleIndex = false;
+    static constexpr bool bStyleIndex = false;
+
+    bool FormTeams(FPartyQueue& queue, int numTeams, int teamSize, std::vector<std::vector<int>>& outTeams) const
+    {
+        return queue.PackWithinWindows(numTeams, teamSize, outTeams);
+    }
+};
+
+// the team size follows the composition, {teamSize} is ignored
+struct FRoleFormation
+{
+    static constexpr bool bRatingIndex = false;
+    static constexpr bool bRoleIndex = true;
+    static constexpr bool bStyleIndex = false;
+    FRoleComposition composition = { 1, 1, 3 };
+
+    bool FormTeams(FPartyQueue& queue, int numTeams, int /*teamSize*/, std::vector<std::vector<int>>& outTeams) const
+    {
+        return queue.PackByRoles(numTeams, composition, outTeams);
+    }
+};
+
+// hands out the matches solved for the queue at the start of the cycle (see FBatchSolver), the plan sets the team shapes
+struct FBatchFormation
+{
+    static constexpr bool bRatingIndex = false;
+    static constexpr bool bRoleIndex = false;
+    static constexpr bool bStyleIndex = false;
+    const FPartyQueue* queues = nullptr; // the region queues, {plans} holds one plan for each
+    FBatchPlan* plans = nullptr;
+
+    bool FormTeams(FPartyQueue& queue, int /*numTeams*/, int /*teamSize*/, std::vector<std::vector<int>>& outTeams) const
+    {
+        return plans[&queue - queues].PopMatch(queue, outTeams);
+    }
+};
+
+struct FPlayStyleFormation
+{
+    static constexpr bool bRatingIndex = false;
+    static constexpr bool bRoleIndex = false;
+    static constexpr bool bStyleIndex = true;
+    float maxDistance = 4.0f;
+
+    bool FormTeams(FPartyQueue& queue, int numTeams, int teamSize, std::vector<std::vector<int>>& outTeams) const
+    {
+        return queue.PackByPlayStyle(numTeams, teamSize, maxDistance, outTeams);
+    }
+};
+
+// Calls {fn} with a default constructed policy of {formation} and returns its result, so a switch over the formations is only
+// written here
+template <typename F>
+auto WithFormation(EMatchFormation formation, F&& fn)
+{
+    switch (formation)
+    {
+    case EMatchFormation::Fifo: return fn(FFifoFormation());
+    case EMatchFormation::SkillBuckets: return fn(FSkillBucketFormation());
+    case EMatchFormation::SkillWindows: return fn(FSkillWindowFormation());
+    case EMatchFormation::Roles: return fn(FRoleFormation());
+    case EMatchFormation::Batch: return fn(FBatchFormation());
+    case EMatchFormation::PlayStyle: return fn(FPlayStyleFormation());
+    }
+    return fn(FFifoFormation());
+}
+
+inline bool UsesRatingIndex(EMatchFormation formation)
+{
+    return WithFormation(formation, [](auto policy) { return decltype(policy)::bRatingIndex; });
+}
+
+inline bool UsesRoleIndex(EMatchFormation formation)
+{
+    return WithFormation(formation, [](auto policy) { return decltype(policy)::bRoleIndex; });
+}
+
+inline bool UsesStyleIndex(EMatchFormation formation)
+{
+    return WithFormation(formation, [](auto policy) { return decltype(policy)::bStyleIndex; });
+}
+
+// Region policies: which queues a cycle visits and where their matches are hosted
+
+// every party is in queue 0, a match is hosted where its worst latency is lowest
+struct FGlobalQueuePolicy
+{
+    static constexpr bool bSharded = false;
+    static constexpr int NumQueues = 1;
+};
+
+// one queue per data center, a match is hosted by the data center whose queue it was packed from
+struct FRegionShardPolicy
+{
+    static constexpr bool bSharded = true;
+    static constexpr int NumQueues = NumRegions;
+};
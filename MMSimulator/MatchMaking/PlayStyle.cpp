@@ -0,0 +1,262 @@
+#include "PlayStyle.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // heap order of the nearest ids found so far, the farthest on top
+    bool CloserFirst(const std::pair<int, int>& a, const std::pair<int, int>& b)
+    {
+        return a < b;
+    }
+}
+
+const char* GetPlayStyleStatName(int stat)
+{
+    static const char* const Names[NumPlayStyleStats] = { "Agr", "Fle", "Gri", "End", "Ins", "Cre", "Pre" };
+    return stat >= 0 && stat < NumPlayStyleStats ? Names[stat] : "?";
+}
+
+int GetPlayStyleDistanceSq(const FPlayStyle& a, const FPlayStyle& b)
+{
+    int distanceSq = 0;
+    for (int stat = 0; stat < NumPlayStyleStats; ++stat)
+    {
+        int delta = a[stat] - b[stat];
+        distanceSq += delta * delta;
+    }
+    return distanceSq;
+}
+
+float GetPlayStyleDistance(const FPlayStyle& a, const FPlayStyle& b)
+{
+    return std::sqrt(static_cast<float>(GetPlayStyleDistanceSq(a, b)));
+}
+
+// ===== FPlayStyleIndex BEGIN =====
+
+void FPlayStyleIndex::Insert(int id, const FPlayStyle& style)
+{
+    if (id < 0)
+    {
+        return;
+    }
+    if (Contains(id))
+    {
+        if (nodes[nodeOf[id]].style == style)
+        {
+            return;
+        }
+        Remove(id);
+    }
+    if (id >= static_cast<int>(nodeOf.size()))
+    {
+        nodeOf.resize(std::max(static_cast<size_t>(id) + 1, nodeOf.size() * 2), None);
+    }
+
+    // down to the node of the same style, or the leaf it hangs from
+    int parent = None;
+    bool bLeft = false;
+    int node = root;
+    for (int axis = 0; node != None; axis = (axis + 1) % NumPlayStyleStats)
+    {
+        if (nodes[node].style == style)
+        {
+            break;
+        }
+        parent = node;
+        bLeft = style[axis] < nodes[node].style[axis];
+        node = bLeft ? nodes[node].left : nodes[node].right;
+    }
+    if (node == None)
+    {
+        node = static_cast<int>(nodes.size());
+        nodes.emplace_back();
+        nodes[node].style = style;
+        if (parent == None)
+        {
+            root = node;
+        }
+        else
+        {
+            (bLeft ? nodes[parent].left : nodes[parent].right) = node;
+        }
+    }
+
+    numOccupied += nodes[node].ids.empty() ? 1 : 0;
+    nodes[node].ids.insert(id);
+    nodeOf[id] = node;
+    ++numIds;
+
+    if (nodes.size() > 16 && nodes.size() - builtNodes > builtNodes)
+    {
+        Rebuild();
+    }
+}
+
+bool FPlayStyleIndex::Remove(int id)
+{
+    if (!Contains(id))
+    {
+        return false;
+    }
+    FNode& node = nodes[nodeOf[id]];
+    node.ids.erase(id);
+    numOccupied -= node.ids.empty() ? 1 : 0;
+    nodeOf[id] = None;
+    --numIds;
+
+    if (nodes.size() > 16 && nodes.size() - numOccupied > numOccupied)
+    {
+        Rebuild();
+    }
+    return true;
+}
+
+void FPlayStyleIndex::Clear()
+{
+    nodes.clear();
+    nodeOf.clear();
+    root = None;
+    numIds = 0;
+    numOccupied = 0;
+    builtNodes = 0;
+}
+
+void FPlayStyleIndex::Rebuild()
+{
+    // occupied nodes only, rebuilt around medians
+    std::vector<FNode> oldNodes;
+    oldNodes.swap(nodes);
+    nodes.reserve(numOccupied);
+    for (FNode& node : oldNodes)
+    {
+        if (!node.ids.empty())
+        {
+            nodes.emplace_back();
+            nodes.back().style = node.style;
+            nodes.back().ids.swap(node.ids);
+        }
+    }
+    buildOrder.resize(nodes.size());
+    for (size_t i = 0; i < buildOrder.size(); ++i)
+    {
+        buildOrder[i] = static_cast<int>(i);
+    }
+    root = Build(buildOrder, 0, static_cast<int>(buildOrder.size()), 0);
+
+    // Build only linked the nodes, the ids still point at the old ones
+    for (size_t node = 0; node < nodes.size(); ++node)
+    {
+        for (int id : nodes[node].ids)
+        {
+            nodeOf[id] = static_cast<int>(node);
+        }
+    }
+    builtNodes = nodes.size();
+}
+
+int FPlayStyleIndex::Build(std::vector<int>& order, int begin, int end, int axis)
+{
+    if (begin >= end)
+    {
+        return None;
+    }
+    std::sort(order.begin() + begin, order.begin() + end, [this, axis](int a, int b)
+        {
+            return nodes[a].style[axis] < nodes[b].style[axis];
+        });
+    // the median moves down to the first node with its value, the left subtree only holds lower ones
+    int mid = begin + (end - begin) / 2;
+    while (mid > begin && nodes[order[mid - 1]].style[axis] == nodes[order[mid]].style[axis])
+    {
+        --mid;
+    }
+    const int node = order[mid];
+    const int nextAxis = (axis + 1) % NumPlayStyleStats;
+    nodes[node].left = Build(order, begin, mid, nextAxis);
+    nodes[node].right = Build(order, mid + 1, end, nextAxis);
+    return node;
+}
+
+void FPlayStyleIndex::FindNearest(const FPlayStyle& style, int maxDistanceSq, size_t maxResults, int excludeId, std::vector<std::pair<int, int>>& outNearest) const
+{
+    outNearest.clear();
+    if (maxResults == 0 || maxDistanceSq < 0)
+    {
+        return;
+    }
+    Search(root, 0, style, maxDistanceSq, maxResults, excludeId, outNearest);
+    std::sort_heap(outNearest.begin(), outNearest.end(), CloserFirst);
+}
+
+void FPlayStyleIndex::Search(int node, int axis, const FPlayStyle& style, int maxDistanceSq, size_t maxResults, int excludeId, std::vector<std::pair<int, int>>& heap) const
+{
+    if (node == None)
+    {
+        return;
+    }
+    const FNode& current = nodes[node];
+    const int distanceSq = GetPlayStyleDistanceSq(style, current.style);
+    if (distanceSq <= maxDistanceSq)
+    {
+        for (int id : current.ids)
+        {
+            if (id == excludeId)
+            {
+                continue;
+            }
+            std::pair<int, int> entry(distanceSq, id);
+            if (heap.size() == maxResults)
+            {
+                // the ids are ascending, none after this one can beat the farthest either
+                if (!CloserFirst(entry, heap.front()))
+                {
+                    break;
+                }
+                std::pop_heap(heap.begin(), heap.end(), CloserFirst);
+                heap.pop_back();
+            }
+            heap.push_back(entry);
+            std::push_heap(heap.begin(), heap.end(), CloserFirst);
+        }
+    }
+
+    // the near side first, the far side only when the splitting plane is close enough to hold a closer style. Ties with the
+    // farthest found are still searched, they may come with a lower id
+    const int delta = style[axis] - current.style[axis];
+    const int nextAxis = (axis + 1) % NumPlayStyleStats;
+    Search(delta < 0 ? current.left : current.right, nextAxis, style, maxDistanceSq, maxResults, excludeId, heap);
+    const int planeDistanceSq = delta * delta;
+    if (planeDistanceSq <= maxDistanceSq && (heap.size() < maxResults || planeDistanceSq <= heap.front().first))
+    {
+        Search(delta < 0 ? current.right : current.left, nextAxis, style, maxDistanceSq, maxResults, excludeId, heap);
+    }
+}
+
+int FPlayStyleIndex::GetDepth() const
+{
+    int depth = 0;
+    std::vector<std::pair<int, int>> stack;
+    if (root != None)
+    {
+        stack.emplace_back(root, 1);
+    }
+    while (!stack.empty())
+    {
+        auto [node, nodeDepth] = stack.back();
+        stack.pop_back();
+        depth = std::max(depth, nodeDepth);
+        for (int child : { nodes[node].left, nodes[node].right })
+        {
+            if (child != None)
+            {
+                stack.emplace_back(child, nodeDepth + 1);
+            }
+        }
+    }
+    return depth;
+}
+
+// ===== FPlayStyleIndex END =====
@@ -0,0 +1,64 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+
+// Quantified play style: aggressiveness, flexibility, grit, endurance, instinct, creativity and precision, each in
+// [0, MaxPlayStyleStat]. A player without trait modifiers sits at PlayStyleBase on every stat
+constexpr int NumPlayStyleStats = 7;
+constexpr int PlayStyleBase = 5;
+constexpr int MaxPlayStyleStat = 10;
+using FPlayStyle = std::array<int8_t, NumPlayStyleStats>;
+
+const char* GetPlayStyleStatName(int stat); // three letter abbreviation
+int GetPlayStyleDistanceSq(const FPlayStyle& a, const FPlayStyle& b);
+float GetPlayStyleDistance(const FPlayStyle& a, const FPlayStyle& b);
+
+// Ids indexed by play style in a k-d tree, so the ones closest to a style are found without a pass over all of them.
+// Every distinct style is one node holding the ids at that point, so players sharing a style (common with few traits) don't
+// stack up into a degenerate chain. Nodes split on the stats in turn: the left subtree holds lower values, the right subtree
+// equal or higher ones.
+// Inserts go down the tree and add a leaf, removals leave an empty node behind. The tree is rebuilt around medians once the
+// leaves added since the last rebuild outnumber the nodes it was built with, or the empty nodes outnumber the occupied ones, so
+// both stay amortized O(log n)
+class FPlayStyleIndex
+{
+public:
+    void Insert(int id, const FPlayStyle& style); // moves the id if it is already indexed
+    bool Remove(int id);
+    void Clear();
+
+    // Up to {maxResults} ids within {maxDistanceSq} of {style}, closest first and ties by id, skipping {excludeId}.
+    // {outNearest} holds (squared distance, id) pairs. The result doesn't depend on the order the ids were inserted in
+    void FindNearest(const FPlayStyle& style, int maxDistanceSq, size_t maxResults, int excludeId, std::vector<std::pair<int, int>>& outNearest) const;
+
+    bool Contains(int id) const { return id >= 0 && id < static_cast<int>(nodeOf.size()) && nodeOf[id] != None; }
+    size_t Size() const { return numIds; }
+    int GetDepth() const; // of the deepest node, for tests and stats
+
+private:
+    static constexpr int None = -1;
+
+    struct FNode
+    {
+        FPlayStyle style{};
+        int left = None;
+        int right = None;
+        std::set<int> ids; // ascending, so ties by id stop early
+    };
+
+    void Rebuild();
+    int Build(std::vector<int>& order, int begin, int end, int axis); // returns the subtree root
+    void Search(int node, int axis, const FPlayStyle& style, int maxDistanceSq, size_t maxResults, int excludeId, std::vector<std::pair<int, int>>& heap) const;
+
+    std::vector<FNode> nodes;
+    std::vector<int> nodeOf;    // by id, None when not indexed
+    int root = None;
+    size_t numIds = 0;
+    size_t numOccupied = 0;     // nodes holding at least one id
+    size_t builtNodes = 0;      // nodes the tree was last rebuilt with
+    std::vector<int> buildOrder; // scratch for Rebuild
+};
@@ -0,0 +1,825 @@
+#include "PlayerQueue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Rematch.h"
+
+namespace
+{
+    // Fills {numTeams} teams of {teamSize} slots from parties grouped by size. {remaining} counts the parties left of each size and
+    // {take}(size) hands out the next one, the first team starts with a party of {anchorSize}. Parties {admit} turns down are
+    // passed over
+    template <typename FTake, typename FAdmit>
+    bool FillTeams(int anchorSize, int numTeams, int teamSize, std::array<size_t, FPartyQueue::MaxPartySize + 1>& remaining, FTake&& take,
+        FAdmit&& admit, std::vector<std::vector<int>>& outTeams)
+    {
+        constexpr int MaxPartySize = FPartyQueue::MaxPartySize;
+
+        // whether the parties left can exactly fill {slots}, as a bitmask of reachable sums (bit n: n slots can be filled).
+        // Larger teams skip the check and rely on the greedy fill
+        auto canFill = [&remaining](int slots)
+        {
+            if (slots <= 0 || slots >= 64)
+            {
+                return true;
+            }
+            uint64_t reachable = 1;
+            for (int size = 1; size <= MaxPartySize; ++size)
+            {
+                for (size_t count = std::min(remaining[size], static_cast<size_t>(slots / size)); count > 0; --count)
+                {
+                    reachable |= reachable << size;
+                }
+            }
+            return ((reachable >> slots) & 1) != 0;
+        };
+
+        outTeams.resize(numTeams);
+        for (int t = 0; t < numTeams; ++t)
+        {
+            std::vector<int>& team = outTeams[t];
+            team.clear();
+            int openSlots = teamSize;
+            if (t == 0)
+            {
+                const int anchorId = take(anchorSize);
+                --remaining[anchorSize];
+                admit(anchorId);
+                team.push_back(anchorId);
+                openSlots -= anchorSize;
+            }
+            while (openSlots > 0)
+            {
+                // the largest party that fits and leaves a remainder the queue can still fill
+                int size = std::min(openSlots, MaxPartySize);
+                for (; size > 0; --size)
+                {
+                    if (remaining[size] > 0)
+                    {
+                        --remaining[size];
+                        bool bFillable = canFill(openSlots - size);
+                        ++remaining[size];
+                        if (bFillable)
+                        {
+                            break;
+                        }
+                    }
+                }
+                if (size == 0)
+                {
+                    return false;
+                }
+                const int leaderId = take(size);
+                --remaining[size];
+                if (!admit(leaderId))
+                {
+                    continue;
+                }
+                team.push_back(leaderId);
+                openSlots -= size;
+            }
+        }
+        return true;
+    }
+
+    // Rating rules of the rating packers: Begin gives the range around the anchor, Accept checks a candidate and narrows the
+    // range when it is picked
+    struct FRatingRange
+    {
+        float low = 0.0f;
+        float high = 0.0f;
+        float lowestRating = 0.0f;  // of the parties picked so far
+        float highestRating = 0.0f;
+    };
+
+    // the range is the intersection of the picked windows, and a candidate's own window has to reach every picked rating
+    struct FWindowRule
+    {
+        static float Reach(float window) { return window < 0.0f ? std::numeric_limits<float>::max() : window; }
+
+        FRatingRange Begin(float rating, float window) const
+        {
+            return { rating - Reach(window), rating + Reach(window), rating, rating };
+        }
+
+        bool Accept(FRatingRange& range, float rating, float window) const
+        {
+            if (rating < range.low || rating > range.high || std::max(range.highestRating - rating, rating - range.lowestRating) > Reach(window))
+            {
+                return false;
+            }
+            range.low = std::max(range.low, rating - Reach(window));
+            range.high = std::min(range.high, rating + Reach(window));
+            range.lowestRating = std::min(range.lowestRating, rating);
+            range.highestRating = std::max(range.highestRating, rating);
+            return true;
+        }
+    };
+
+    // the anchor's bucket, fixed for the whole match
+    struct FBucketRule
+    {
+        float bucketWidth = 100.0f;
+
+        FRatingRange Begin(float rating, float) const
+        {
+            float low = std::floor(rating / bucketWidth) * bucketWidth;
+            return { low, low + bucketWidth, rating, rating };
+        }
+
+        bool Accept(FRatingRange& range, float rating, float) const
+        {
+            return rating >= range.low && rating < range.high;
+        }
+    };
+}
+
+void FPlayerQueue::Enqueue(int id)
+{
+    if (id < 0 || Contains(id))
+    {
+        return;
+    }
+    if (id >= static_cast<int>(prevLink.size()))
+    {
+        size_t newSize = std::max(static_cast<size_t>(id) + 1, prevLink.size() * 2);
+        prevLink.resize(newSize, NotQueued);
+        nextLink.resize(newSize, None);
+    }
+
+    prevLink[id] = tail;
+    nextLink[id] = None;
+    if (tail != None)
+    {
+        nextLink[tail] = id;
+    }
+    else
+    {
+        head = id;
+    }
+    tail = id;
+    ++size;
+}
+
+bool FPlayerQueue::Remove(int id)
+{
+    if (!Contains(id))
+    {
+        return false;
+    }
+
+    int prev = prevLink[id];
+    int next = nextLink[id];
+    if (prev != None) nextLink[prev] = next; else head = next;
+    if (next != None) prevLink[next] = prev; else tail = prev;
+
+    prevLink[id] = NotQueued;
+    nextLink[id] = None;
+    --size;
+    return true;
+}
+
+int FPlayerQueue::PopFront()
+{
+    int id = head;
+    if (id != None)
+    {
+        Remove(id);
+    }
+    return id;
+}
+
+void FPlayerQueue::Clear()
+{
+    prevLink.clear();
+    nextLink.clear();
+    head = None;
+    tail = None;
+    size = 0;
+}
+
+std::vector<int> FPlayerQueue::ToVector() const
+{
+    std::vector<int> ids;
+    ids.reserve(size);
+    for (int id = head; id != None; id = nextLink[id])
+    {
+        ids.push_back(id);
+    }
+    return ids;
+}
+
+void FPartyQueue::Enqueue(int leaderId, int partySize, float rating, float searchWindow, FRoleMask roles, const FPlayStyle& style)
+{
+    if (leaderId < 0 || Contains(leaderId))
+    {
+        return;
+    }
+    partySize = std::clamp(partySize, 1, MaxPartySize);
+    if (leaderId >= static_cast<int>(partySizes.size()))
+    {
+        size_t newSize = std::max(static_cast<size_t>(leaderId) + 1, partySizes.size() * 2);
+        partySizes.resize(newSize, 0);
+        joinSequences.resize(newSize, 0);
+        ratings.resize(newSize, 0.0f);
+        searchWindows.resize(newSize, AnyRating);
+        roleMasks.resize(newSize, 0);
+        styles.resize(newSize);
+    }
+
+    partySizes[leaderId] = static_cast<uint8_t>(partySize);
+    joinSequences[leaderId] = nextJoinSequence++;
+    ratings[leaderId] = rating;
+    searchWindows[leaderId] = searchWindow;
+    roleMasks[leaderId] = roles;
+    styles[leaderId] = style;
+    if (bRatingIndex)
+    {
+        ratingIndex.emplace(rating, leaderId);
+    }
+    if (bStyleIndex)
+    {
+        styleIndex.Insert(leaderId, style);
+    }
+    if (bRoleIndex && partySize == 1)
+    {
+        for (int role = 0; role < NumRoles; ++role)
+        {
+            if (roles & GetRoleBit(role))
+            {
+                roleQueues[role].Enqueue(leaderId);
+            }
+        }
+    }
+    buckets[partySize].Enqueue(leaderId);
+    numPlayers += partySize;
+}
+
+bool FPartyQueue::Remove(int leaderId)
+{
+    int partySize = GetPartySize(leaderId);
+    if (partySize == 0)
+    {
+        return false;
+    }
+    buckets[partySize].Remove(leaderId);
+    if (bRatingIndex)
+    {
+        ratingIndex.erase({ ratings[leaderId], leaderId });
+    }
+    if (bStyleIndex)
+    {
+        styleIndex.Remove(leaderId);
+    }
+    if (bRoleIndex)
+    {
+        for (FPlayerQueue& roleQueue : roleQueues)
+        {
+            roleQueue.Remove(leaderId);
+        }
+    }
+    partySizes[leaderId] = 0;
+    numPlayers -= partySize;
+    return true;
+}
+
+void FPartyQueue::Clear()
+{
+    for (FPlayerQueue& bucket : buckets)
+    {
+        bucket.Clear();
+    }
+    partySizes.clear();
+    joinSequences.clear();
+    nextJoinSequence = 0;
+    numPlayers = 0;
+    ratings.clear();
+    searchWindows.clear();
+    ratingIndex.clear();
+    roleMasks.clear();
+    for (FPlayerQueue& roleQueue : roleQueues)
+    {
+        roleQueue.Clear();
+    }
+    styles.clear();
+    styleIndex.Clear();
+}
+
+void FPartyQueue::SetSearchWindow(int leaderId, float searchWindow)
+{
+    // the index is keyed by rating, which doesn't change while queued, so the party stays where it is
+    if (Contains(leaderId))
+    {
+        searchWindows[leaderId] = searchWindow;
+    }
+}
+
+void FPartyQueue::SetRatingIndex(bool bEnabled)
+{
+    if (bEnabled == bRatingIndex)
+    {
+        return;
+    }
+    bRatingIndex = bEnabled;
+    ratingIndex.clear();
+    if (bRatingIndex)
+    {
+        for (const FPlayerQueue& bucket : buckets)
+        {
+            for (int leaderId = bucket.Front(); leaderId != FPlayerQueue::None; leaderId = bucket.Next(leaderId))
+            {
+                ratingIndex.emplace(ratings[leaderId], leaderId);
+            }
+        }
+    }
+}
+
+void FPartyQueue::SetRoleIndex(bool bEnabled)
+{
+    if (bEnabled == bRoleIndex)
+    {
+        return;
+    }
+    bRoleIndex = bEnabled;
+    for (FPlayerQueue& roleQueue : roleQueues)
+    {
+        roleQueue.Clear();
+    }
+    if (bRoleIndex)
+    {
+        // the solo bucket is in join order, so the role queues are too
+        for (int leaderId = buckets[1].Front(); leaderId != FPlayerQueue::None; leaderId = buckets[1].Next(leaderId))
+        {
+            for (int role = 0; role < NumRoles; ++role)
+            {
+                if (roleMasks[leaderId] & GetRoleBit(role))
+                {
+                    roleQueues[role].Enqueue(leaderId);
+                }
+            }
+        }
+    }
+}
+
+void FPartyQueue::SetStyleIndex(bool bEnabled)
+{
+    if (bEnabled == bStyleIndex)
+    {
+        return;
+    }
+    bStyleIndex = bEnabled;
+    styleIndex.Clear();
+    if (bStyleIndex)
+    {
+        for (const FPlayerQueue& bucket : buckets)
+        {
+            for (int leaderId = bucket.Front(); leaderId != FPlayerQueue::None; leaderId = bucket.Next(leaderId))
+            {
+                styleIndex.Insert(leaderId, styles[leaderId]);
+            }
+        }
+    }
+}
+
+bool FPartyQueue::PackTeams(int numTeams, int teamSize, std::vector<std::vector<int>>& outTeams)
+{
+    if (numTeams <= 0 || teamSize <= 0 || numPlayers < static_cast<size_t>(numTeams) * static_cast<size_t>(teamSize))
+    {
+        return false;
+    }
+
+    // anchors in join order, one per bucket: only a bucket's front can be the oldest party of its size
+    std::array<int, MaxPartySize> anchorSizes{};
+    int numAnchors = 0;
+    for (int size = 1; size <= std::min(teamSize, MaxPartySize); ++size)
+    {
+        if (!buckets[size].Empty())
+        {
+            anchorSizes[numAnchors++] = size;
+        }
+    }
+    std::sort(anchorSizes.begin(), anchorSizes.begin() + numAnchors, [this](int a, int b)
+        {
+            return joinSequences[buckets[a].Front()] < joinSequences[buckets[b].Front()];
+        });
+
+    for (int i = 0; i < numAnchors; ++i)
+    {
+        if (TryPack(anchorSizes[i], numTeams, teamSize, outTeams))
+        {
+            for (const std::vector<int>& team : outTeams)
+            {
+                for (int leaderId : team)
+                {
+                    Remove(leaderId);
+                }
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FPartyQueue::TryPack(int anchorSize, int numTeams, int teamSize, std::vector<std::vector<int>>& outTeams) const
+{
+    // walks each bucket front to back without popping, so a failed attempt leaves nothing to undo
+    std::array<int, MaxPartySize + 1> cursors;
+    std::array<size_t, MaxPartySize + 1> remaining;
+    for (int size = 0; size <= MaxPartySize; ++size)
+    {
+        cursors[size] = buckets[size].Front();
+        remaining[size] = buckets[size].Size();
+    }
+    if (rematchGuard)
+    {
+        rematchGuard->Begin();
+    }
+    return FillTeams(anchorSize, numTeams, teamSize, remaining, [this, &cursors](int size)
+        {
+            int leaderId = cursors[size];
+            cursors[size] = buckets[size].Next(leaderId);
+            return leaderId;
+        }, [this](int leaderId)
+        {
+            return !rematchGuard || rematchGuard->Admit(leaderId);
+        }, outTeams);
+}
+
+bool FPartyQueue::PackWithinWindows(int numTeams, int teamSize, std::vector<std::vector<int>>& outTeams)
+{
+    return PackByRating(FWindowRule(), numTeams, teamSize, outTeams);
+}
+
+bool FPartyQueue::PackWithinBuckets(int numTeams, int teamSize, float bucketWidth, std::vector<std::vector<int>>& outTeams)
+{
+    return PackByRating(FBucketRule{ std::max(bucketWidth, 1.0f) }, numTeams, teamSize, outTeams);
+}
+
+bool FPartyQueue::PackByPlayStyle(int numTeams, int teamSize, float maxDistance, std::vector<std::vector<int>>& outTeams)
+{
+    if (!bStyleIndex || maxDistance < 0.0f)
+    {
+        return false;
+    }
+    // the stats are integers, so is every squared distance
+    const int maxDistanceSq = static_cast<int>(std::floor(maxDistance * maxDistance));
+    return PackAroundAnchors(numTeams, teamSize, [this, maxDistanceSq, numTeams, teamSize](int anchorId)
+        {
+            return GatherStyleCandidates(anchorId, maxDistanceSq, teamSize, numTeams * teamSize);
+        }, outTeams);
+}
+
+template <typename TRule>
+bool FPartyQueue::PackByRating(const TRule& rule, int numTeams, int teamSize, std::vector<std::vector<int>>& outTeams)
+{
+    if (!bRatingIndex)
+    {
+        return false;
+    }
+    return PackAroundAnchors(numTeams, teamSize, [this, &rule, numTeams, teamSize](int anchorId)
+        {
+            return GatherCandidates(rule, anchorId, teamSize, numTeams * teamSize);
+        }, outTeams);
+}
+
+template <typename TGather>
+bool FPartyQueue::PackAroundAnchors(int numTeams, int teamSize, TGather&& gather, std::vector<std::vector<int>>& outTeams)
+{
+    if (numTeams <= 0 || teamSize <= 0 || numPlayers < static_cast<size_t>(numTeams) * static_cast<size_t>(teamSize))
+    {
+        return false;
+    }
+
+    // anchors in join order, merged from the bucket fronts
+    std::array<int, MaxPartySize + 1> anchors;
+    for (int size = 0; size <= MaxPartySize; ++size)
+    {
+        anchors[size] = size <= teamSize ? buckets[size].Front() : FPlayerQueue::None;
+    }
+    for (int attempt = 0; attempt < MaxRatingAnchors; ++attempt)
+    {
+        int anchorSize = 0;
+        for (int size = 1; size <= MaxPartySize; ++size)
+        {
+            if (anchors[size] != FPlayerQueue::None && (anchorSize == 0 || joinSequences[anchors[size]] < joinSequences[anchors[anchorSize]]))
+            {
+                anchorSize = size;
+            }
+        }
+        if (anchorSize == 0)
+        {
+            return false;
+        }
+        int anchorId = anchors[anchorSize];
+        anchors[anchorSize] = buckets[anchorSize].Next(anchorId);
+
+        if (!gather(anchorId))
+        {
+            continue;
+        }
+        std::array<size_t, MaxPartySize + 1> cursors{};
+        std::array<size_t, MaxPartySize + 1> remaining;
+        for (int size = 0; size <= MaxPartySize; ++size)
+        {
+            remaining[size] = anchorCandidates[size].size();
+        }
+        if (rematchGuard)
+        {
+            rematchGuard->Begin();
+        }
+        bool bPacked = FillTeams(anchorSize, numTeams, teamSize, remaining, [this, &cursors](int size)
+            {
+                return anchorCandidates[size][cursors[size]++];
+            }, [this](int leaderId)
+            {
+                return !rematchGuard || rematchGuard->Admit(leaderId);
+            }, outTeams);
+        if (bPacked)
+        {
+            for (const std::vector<int>& team : outTeams)
+            {
+                for (int leaderId : team)
+                {
+                    Remove(leaderId);
+                }
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename TRule>
+bool FPartyQueue::GatherCandidates(const TRule& rule, int anchorId, int teamSize, int minPlayers)
+{
+    for (std::vector<int>& candidates : anchorCandidates)
+    {
+        candidates.clear();
+    }
+    const float anchorRating = ratings[anchorId];
+    anchorCandidates[partySizes[anchorId]].push_back(anchorId);
+    int players = partySizes[anchorId];
+
+    // every candidate has to lie in the rule's range, which may narrow with each one picked. Up to four times the match size is
+    // collected so the packing has sizes to choose from
+    FRatingRange range = rule.Begin(anchorRating, searchWindows[anchorId]);
+    auto below = ratingIndex.find({ anchorRating, anchorId });
+    if (below == ratingIndex.end())
+    {
+        return false;
+    }
+    auto above = std::next(below);
+    for (int scanned = 0; scanned < MaxRatingScan && players < minPlayers * 4; ++scanned)
+    {
+        // closest rating first, the two walks stop at the edges of the range
+        bool bBelow = below != ratingIndex.begin() && std::prev(below)->first >= range.low;
+        bool bAbove = above != ratingIndex.end() && above->first <= range.high;
+        if (!bBelow && !bAbove)
+        {
+            break;
+        }
+        auto it = above;
+        if (bBelow && (!bAbove || anchorRating - std::prev(below)->first <= above->first - anchorRating))
+        {
+            it = --below;
+        }
+        else
+        {
+            ++above;
+        }
+
+        const int leaderId = it->second;
+        if (partySizes[leaderId] > teamSize || !rule.Accept(range, it->first, searchWindows[leaderId]))
+        {
+            continue;
+        }
+        anchorCandidates[partySizes[leaderId]].push_back(leaderId);
+        players += partySizes[leaderId];
+    }
+    return players >= minPlayers;
+}
+
+bool FPartyQueue::GatherStyleCandidates(int anchorId, int maxDistanceSq, int teamSize, int minPlayers)
+{
+    for (std::vector<int>& candidates : anchorCandidates)
+    {
+        candidates.clear();
+    }
+    anchorCandidates[partySizes[anchorId]].push_back(anchorId);
+    int players = partySizes[anchorId];
+
+    // every party has a player at least, so four times the match size in parties covers the four times the match size in
+    // players the rating packers collect
+    const size_t maxResults = static_cast<size_t>(std::min(MaxRatingScan, minPlayers * 4));
+    styleIndex.FindNearest(styles[anchorId], maxDistanceSq, maxResults, anchorId, styleNearest);
+    for (const std::pair<int, int>& nearest : styleNearest)
+    {
+        const int leaderId = nearest.second;
+        if (partySizes[leaderId] > teamSize)
+        {
+            continue;
+        }
+        anchorCandidates[partySizes[leaderId]].push_back(leaderId);
+        players += partySizes[leaderId];
+    }
+    return players >= minPlayers;
+}
+
+bool FPartyQueue::PackByRoles(int numTeams, const FRoleComposition& composition, std::vector<std::vector<int>>& outTeams)
+{
+    lastMissingRoles = 0;
+    const int teamSize = GetCompositionSize(composition);
+    if (!bRoleIndex || numTeams <= 0 || teamSize <= 0)
+    {
+        return false;
+    }
+
+    // a role listing fewer players than it has slots can't be filled whatever the flex players do
+    std::array<int, NumRoles> slots;
+    FRoleMask neededRoles = 0;
+    for (int role = 0; role < NumRoles; ++role)
+    {
+        slots[role] = numTeams * composition[role];
+        neededRoles |= slots[role] > 0 ? GetRoleBit(role) : 0;
+        lastMissingRoles |= static_cast<int>(roleQueues[role].Size()) < slots[role] ? GetRoleBit(role) : 0;
+        roleSlots[role].clear();
+    }
+    const int matchPlayers = numTeams * teamSize;
+    if (lastMissingRoles != 0 || static_cast<int>(buckets[1].Size()) < matchPlayers)
+    {
+        return false;
+    }
+
+    // players in join order, merged from the fronts of the role queues. Once no chain of moves leads from a role to an open slot
+    // the role is dead and stays dead as more players are placed, so its queue is dropped from the merge and a player who only
+    // plays dead roles is skipped without a search
+    std::array<int, NumRoles> cursors;
+    for (int role = 0; role < NumRoles; ++role)
+    {
+        cursors[role] = roleQueues[role].Front();
+    }
+    FRoleMask deadRoles = static_cast<FRoleMask>(AllRoles & ~neededRoles);
+    int placed = 0;
+    for (int scanned = 0; scanned < MaxRoleScan && placed < matchPlayers; ++scanned)
+    {
+        int playerId = FPlayerQueue::None;
+        for (int role = 0; role < NumRoles; ++role)
+        {
+            if (!(deadRoles & GetRoleBit(role)) && cursors[role] != FPlayerQueue::None
+                && (playerId == FPlayerQueue::None || joinSequences[cursors[role]] < joinSequences[playerId]))
+            {
+                playerId = cursors[role];
+            }
+        }
+        if (playerId == FPlayerQueue::None)
+        {
+            break;
+        }
+        for (int role = 0; role < NumRoles; ++role)
+        {
+            cursors[role] = cursors[role] == playerId ? roleQueues[role].Next(playerId) : cursors[role];
+        }
+
+        FRoleMask visited = 0;
+        if (PlaceByRole(playerId, deadRoles, slots, visited))
+        {
+            ++placed;
+        }
+        else
+        {
+            deadRoles |= visited;
+        }
+    }
+
+    if (placed < matchPlayers)
+    {
+        for (int role = 0; role < NumRoles; ++role)
+        {
+            lastMissingRoles |= static_cast<int>(roleSlots[role].size()) < slots[role] ? GetRoleBit(role) : 0;
+        }
+        return false;
+    }
+
+    outTeams.resize(numTeams);
+    for (std::vector<int>& team : outTeams)
+    {
+        team.clear();
+    }
+    for (int role = 0; role < NumRoles; ++role)
+    {
+        size_t next = 0;
+        for (std::vector<int>& team : outTeams)
+        {
+            for (int i = 0; i < composition[role]; ++i)
+            {
+                team.push_back(roleSlots[role][next++]);
+            }
+        }
+    }
+    for (const std::vector<int>& team : outTeams)
+    {
+        for (int leaderId : team)
+        {
+            Remove(leaderId);
+        }
+    }
+    return true;
+}
+
+bool FPartyQueue::PlaceByRole(int playerId, FRoleMask deadRoles, const std::array<int, NumRoles>& slots, FRoleMask& outVisited)
+{
+    // breadth first over roles, a step from one role to another moves a player placed in the first who also plays the second.
+    // The player gets in when a chain of such moves ends at an open slot, every role is visited once at most
+    std::array<int, NumRoles> fromRole;
+    std::array<int, NumRoles> movedPlayer;
+    std::array<int, NumRoles> open;
+    int head = 0;
+    int tail = 0;
+    FRoleMask visited = deadRoles;
+    for (int role = 0; role < NumRoles; ++role)
+    {
+        if ((roleMasks[playerId] & GetRoleBit(role)) && !(visited & GetRoleBit(role)))
+        {
+            visited |= GetRoleBit(role);
+            fromRole[role] = -1;
+            open[tail++] = role;
+        }
+    }
+
+    while (head < tail)
+    {
+        int role = open[head++];
+        if (static_cast<int>(roleSlots[role].size()) < slots[role])
+        {
+            // back along the chain, every moved player leaves the slot the next one takes
+            while (fromRole[role] >= 0)
+            {
+                std::vector<int>& fromSlots = roleSlots[fromRole[role]];
+                fromSlots.erase(std::find(fromSlots.begin(), fromSlots.end(), movedPlayer[role]));
+                roleSlots[role].push_back(movedPlayer[role]);
+                role = fromRole[role];
+            }
+            roleSlots[role].push_back(playerId);
+            return true;
+        }
+        for (int placedId : roleSlots[role])
+        {
+            for (int next = 0; next < NumRoles; ++next)
+            {
+                if ((roleMasks[placedId] & GetRoleBit(next)) && !(visited & GetRoleBit(next)))
+                {
+                    visited |= GetRoleBit(next);
+                    fromRole[next] = role;
+                    movedPlayer[next] = placedId;
+                    open[tail++] = next;
+                }
+            }
+        }
+    }
+    outVisited = static_cast<FRoleMask>(visited & ~deadRoles);
+    return false;
+}
+
+int FPartyQueue::GetPartySize(int leaderId) const
+{
+    return leaderId >= 0 && leaderId < static_cast<int>(partySizes.size()) ? partySizes[leaderId] : 0;
+}
+
+int FPartyQueue::GetOldestLeader() const
+{
+    int oldestId = FPlayerQueue::None;
+    for (int size = 1; size <= MaxPartySize; ++size)
+    {
+        const int leaderId = buckets[size].Front();
+        if (leaderId != FPlayerQueue::None && (oldestId == FPlayerQueue::None || joinSequences[leaderId] < joinSequences[oldestId]))
+        {
+            oldestId = leaderId;
+        }
+    }
+    return oldestId;
+}
+
+size_t FPartyQueue::NumParties() const
+{
+    size_t count = 0;
+    for (const FPlayerQueue& bucket : buckets)
+    {
+        count += bucket.Size();
+    }
+    return count;
+}
+
+std::vector<int> FPartyQueue::ToVector() const
+{
+    std::vector<int> leaderIds;
+    for (const FPlayerQueue& bucket : buckets)
+    {
+        std::vector<int> ids = bucket.ToVector();
+        leaderIds.insert(leaderIds.end(), ids.begin(), ids.end());
+    }
+    std::sort(leaderIds.begin(), leaderIds.end(), [this](int a, int b) { return joinSequences[a] < joinSequences[b]; });
+    return leaderIds;
+}
+
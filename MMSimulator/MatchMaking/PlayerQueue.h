@@ -0,0 +1,144 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "PlayStyle.h"
+#include "Role.h"
+
+class FRematchGuard;
+
+// FIFO queue of player ids ordered by enqueue time, with O(1) enqueue, pop and removal from anywhere in the queue.
+// It is an intrusive doubly-linked list whose links live in arrays indexed by id (ids are dense), so no node is allocated per entry.
+class FPlayerQueue
+{
+public:
+    static constexpr int None = -1;
+
+    void Enqueue(int id); // appends at the back, does nothing if the id is already queued
+    bool Remove(int id);  // cancel, returns false if the id wasn't queued
+    int PopFront();       // returns None when empty
+    void Clear();
+
+    int Front() const { return head; }
+    int Next(int id) const { return nextLink[id]; } // iterate front to back: for (int id = Front(); id != None; id = Next(id))
+    bool Contains(int id) const { return id >= 0 && id < static_cast<int>(prevLink.size()) && prevLink[id] != NotQueued; }
+    size_t Size() const { return size; }
+    bool Empty() const { return size == 0; }
+    std::vector<int> ToVector() const; // front to back
+
+private:
+    static constexpr int NotQueued = -2;
+
+    std::vector<int> prevLink;
+    std::vector<int> nextLink;
+    int head = None;
+    int tail = None;
+    size_t size = 0;
+};
+
+// Queued parties (a solo player is a party of one), keyed by their leader and bucketed by size so a team slot of a given size
+// is filled from the front of one bucket instead of searching the queue. A join sequence orders parties across buckets.
+//
+// With the rating index enabled, parties are also indexed by rating, so the ones within reach of a rating are found with a
+// range lookup instead of a pass over the queue. With the role index enabled, solo players are also listed in one FIFO per role
+// they play. With the style index enabled, parties are also kept in a k-d tree over their play style (see FPlayStyleIndex)
+class FPartyQueue
+{
+public:
+    static constexpr int MaxPartySize = 5;
+    static constexpr float AnyRating = -1.0f;   // search window of a party that plays with anyone
+    static constexpr int MaxRatingAnchors = 16; // parties tried as the anchor of a match per call of a rating packer
+    static constexpr int MaxRatingScan = 256;   // indexed parties looked at per anchor
+    static constexpr int MaxRoleScan = 512;     // players looked at per call of the role packer
+
+    // the size is clamped to [1, MaxPartySize]
+    void Enqueue(int leaderId, int partySize, float rating = 0.0f, float searchWindow = AnyRating, FRoleMask roles = AllRoles, const FPlayStyle& style = {});
+    bool Remove(int leaderId);
+    void Clear();
+    void SetSearchWindow(int leaderId, float searchWindow); // a wider window keeps the party's place in line and in the index
+    void SetRatingIndex(bool bEnabled); // indexes or drops the queued parties
+    void SetRoleIndex(bool bEnabled);
+    void SetStyleIndex(bool bEnabled);
+    // the packers that fill teams party by party offer every party to {guard} and pass over the ones it rejects, nullptr for none
+    void SetRematchGuard(FRematchGuard* guard) { rematchGuard = guard; }
+
+    // Packs {numTeams} teams of exactly {teamSize} players. The longest-waiting party anchors the first team, then every open
+    // slot takes the oldest party of the largest size that fits and leaves a remainder the queued sizes can still add up to.
+    // When the anchor can't be packed the next bucket front is tried, so the cost is bounded by MaxPartySize packing passes.
+    // On success the parties are popped and {outTeams} holds the leader ids of each team. Greedy packing can miss a packing
+    // that exists, the queue is left untouched then
+    bool PackTeams(int numTeams, int teamSize, std::vector<std::vector<int>>& outTeams);
+
+    // Rating packers, they need the rating index. Up to MaxRatingAnchors parties are tried in join order, the candidates of an
+    // anchor are the indexed parties closest to its rating that pass the rule together with every candidate picked before them,
+    // and the teams are packed from those, closest first.
+    // Windows: a party only plays with parties whose rating is within its search window, and whose own window covers its rating
+    bool PackWithinWindows(int numTeams, int teamSize, std::vector<std::vector<int>>& outTeams);
+    // Buckets: a party only plays with parties in the same {bucketWidth} wide rating bucket
+    bool PackWithinBuckets(int numTeams, int teamSize, float bucketWidth, std::vector<std::vector<int>>& outTeams);
+
+    // Play style packer, it needs the style index. Anchors are tried as with the rating packers, the candidates of an anchor are
+    // the parties whose style is closest to its own and at most {maxDistance} away, found in the style index
+    bool PackByPlayStyle(int numTeams, int teamSize, float maxDistance, std::vector<std::vector<int>>& outTeams);
+
+    // Role packer, it needs the role index and only takes solo players. Fills {numTeams} teams of {composition} with the oldest
+    // players that fit, each team lists its players role by role in composition order. A player who can't be placed directly
+    // may still get in by moving a flex player to another of their roles. Roles found unreachable are never searched again
+    // within the call, so a call costs at most MaxRoleScan placements. On failure GetMissingRoles() tells which roles fell short
+    bool PackByRoles(int numTeams, const FRoleComposition& composition, std::vector<std::vector<int>>& outTeams);
+
+    bool Contains(int leaderId) const { return GetPartySize(leaderId) > 0; }
+    int GetPartySize(int leaderId) const; // 0 when not queued
+    int GetOldestLeader() const; // the longest waiting party, FPlayerQueue::None when empty
+    float GetRating(int leaderId) const { return Contains(leaderId) ? ratings[leaderId] : 0.0f; }
+    float GetSearchWindow(int leaderId) const { return Contains(leaderId) ? searchWindows[leaderId] : AnyRating; }
+    FRoleMask GetRoles(int leaderId) const { return Contains(leaderId) ? roleMasks[leaderId] : 0; }
+    FPlayStyle GetPlayStyle(int leaderId) const { return Contains(leaderId) ? styles[leaderId] : FPlayStyle{}; }
+    FRoleMask GetMissingRoles() const { return lastMissingRoles; } // roles the last PackByRoles call couldn't fill
+    const FPlayerQueue& GetRoleQueue(int role) const { return roleQueues[role]; }
+    const FPlayerQueue& GetBucket(int partySize) const { return buckets[partySize]; }
+    size_t NumPlayers() const { return numPlayers; }
+    size_t NumParties() const;
+    std::vector<int> ToVector() const; // leaders in join order
+
+private:
+    bool TryPack(int anchorSize, int numTeams, int teamSize, std::vector<std::vector<int>>& outTeams) const;
+    template <typename TGather>
+    bool PackAroundAnchors(int numTeams, int teamSize, TGather&& gather, std::vector<std::vector<int>>& outTeams);
+    template <typename TRule>
+    bool PackByRating(const TRule& rule, int numTeams, int teamSize, std::vector<std::vector<int>>& outTeams);
+    // both fill anchorCandidates, true when they hold enough players
+    template <typename TRule>
+    bool GatherCandidates(const TRule& rule, int anchorId, int teamSize, int minPlayers);
+    bool GatherStyleCandidates(int anchorId, int maxDistanceSq, int teamSize, int minPlayers);
+    bool PlaceByRole(int playerId, FRoleMask deadRoles, const std::array<int, NumRoles>& slots, FRoleMask& outVisited); // into roleSlots
+
+    std::array<FPlayerQueue, MaxPartySize + 1> buckets; // indexed by party size, 0 is unused
+    std::vector<uint8_t> partySizes;        // by leader id, 0 when not queued
+    std::vector<uint64_t> joinSequences;    // by leader id
+    uint64_t nextJoinSequence = 0;
+    size_t numPlayers = 0;
+
+    std::vector<float> ratings;             // by leader id
+    std::vector<float> searchWindows;       // by leader id
+    bool bRatingIndex = false;
+    std::set<std::pair<float, int>> ratingIndex; // (rating, leader id)
+    std::array<std::vector<int>, MaxPartySize + 1> anchorCandidates; // by party size, closest to the anchor first
+
+    std::vector<FPlayStyle> styles;         // by leader id
+    bool bStyleIndex = false;
+    FPlayStyleIndex styleIndex;
+    std::vector<std::pair<int, int>> styleNearest; // (squared distance, leader id), scratch for GatherStyleCandidates
+
+    std::vector<FRoleMask> roleMasks;       // by leader id
+    bool bRoleIndex = false;
+    std::array<FPlayerQueue, NumRoles> roleQueues; // solo players by role, in join order
+    std::array<std::vector<int>, NumRoles> roleSlots; // players placed in each role by the running PackByRoles
+    FRoleMask lastMissingRoles = 0;
+
+    FRematchGuard* rematchGuard = nullptr;
+};
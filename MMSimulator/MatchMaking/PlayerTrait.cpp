@@ -1,24 +1,25 @@
 #include "PlayerTrait.h"
 
 // Define trait descriptions in a fast lookup table.
+// Modifiers add to the play style stats in order: agr, fle, gri, end, ins, cre, pre (see VirtualPlayer::DerivePlayStyle)
 // ***Keep it alphabetical in this list
 const std::unordered_map<EPlayerTrait, FTraitInfo> TraitDatabase = {
-    {EPlayerTrait::Aggressive,    {Common,      0, 0, 0, 0, 0, 0, 0, "Aggressive", "Prefers risky, high-damage plays"}},
-    {EPlayerTrait::Casual,        {Majority,    0, 0, 0, 0, 0, 0, 0, "Casual", "Plays for fun, not highly competitive"}},
-    {EPlayerTrait::Competitive,   {Common,      0, 0, 0, 0, 0, 0, 0, "Competitive", "Prefers ranked play, always tries to win"}},
-    {EPlayerTrait::Confident,     {Common,      0, 0, 0, 0, 0, 0, 0, "Confident", "More aggressive after wins"}},
-    {EPlayerTrait::Defensive,     {Common,      0, 0, 0, 0, 0, 0, 0, "Defensive", "Avoids risk, plays conservatively"}},
-    {EPlayerTrait::Leader,        {Rare,        0, 0, 0, 0, 0, 0, 0, "Leader", "Plays better when leading a team"}},
-    {EPlayerTrait::LoneWolf,      {Uncommon,    0, 0, 0, 0, 0, 0, 0, "LoneWolf", "Prefers solo play, avoids teamwork"}},
-    {EPlayerTrait::MetaAdaptive,  {Rare,        0, 0, 0, 0, 0, 0, 0, "MetaAdaptive", "Learns from opponents, adjusts strategy"}},
-    {EPlayerTrait::Nervous,       {Uncommon,    0, 0, 0, 0, 0, 0, 0, "Nervous", "Worse performance under high-pressure"}},
-    {EPlayerTrait::RiskAverse,    {Rare,        0, 0, 0, 0, 0, 0, 0, "RiskAverse", "Avoids unnecessary risks, values survival"}},
-    {EPlayerTrait::Specialist,    {Rare,        0, 0, 0, 0, 0, 0, 0, "Specialist", "Sticks to one play-style or weapon"}},
-    {EPlayerTrait::Streaky,       {Uncommon,    0, 0, 0, 0, 0, 0, 0, "Streaky", "Recent results affects performance"}},
-    {EPlayerTrait::TeamOriented,  {Uncommon,    0, 0, 0, 0, 0, 0, 0, "TeamOriented", "Performs better in familiar teams"}},
-    {EPlayerTrait::TiltProne,     {Rare,        0, 0, 0, 0, 0, 0, 0, "TiltProne", "Becomes reckless after consecutive losses"}},
-    {EPlayerTrait::Unpredictable, {Rare,        0, 0, 0, 0, 0, 0, 0, "Unpredictable", "Inconsistent performance, high variance"}},
-    {EPlayerTrait::Versatile,     {Rare,        0, 0, 0, 0, 0, 0, 0, "Versatile", "Adapts frequently, changes play-style"}},
+    {EPlayerTrait::Aggressive,    {Common,       3, 0, 0,-1, 1, 0,-1, "Aggressive", "Prefers risky, high-damage plays"}},
+    {EPlayerTrait::Casual,        {Majority,    -1, 0,-1,-1, 0, 1,-1, "Casual", "Plays for fun, not highly competitive"}},
+    {EPlayerTrait::Competitive,   {Common,       1, 0, 2, 1, 1, 0, 1, "Competitive", "Prefers ranked play, always tries to win"}},
+    {EPlayerTrait::Confident,     {Common,       2, 0, 1, 0, 1, 0, 0, "Confident", "More aggressive after wins"}},
+    {EPlayerTrait::Defensive,     {Common,      -3, 0, 1, 1, 0,-1, 1, "Defensive", "Avoids risk, plays conservatively"}},
+    {EPlayerTrait::Leader,        {Rare,         0, 1, 2, 0, 2, 0, 0, "Leader", "Plays better when leading a team"}},
+    {EPlayerTrait::LoneWolf,      {Uncommon,     1,-2, 0, 0, 1, 1, 0, "LoneWolf", "Prefers solo play, avoids teamwork"}},
+    {EPlayerTrait::MetaAdaptive,  {Rare,         0, 3, 0, 0, 1, 1, 0, "MetaAdaptive", "Learns from opponents, adjusts strategy"}},
+    {EPlayerTrait::Nervous,       {Uncommon,    -1, 0,-2, 0,-2, 0,-1, "Nervous", "Worse performance under high-pressure"}},
+    {EPlayerTrait::RiskAverse,    {Rare,        -2,-1, 0, 1, 0,-2, 1, "RiskAverse", "Avoids unnecessary risks, values survival"}},
+    {EPlayerTrait::Specialist,    {Rare,         0,-3, 0, 0, 0,-1, 3, "Specialist", "Sticks to one play-style or weapon"}},
+    {EPlayerTrait::Streaky,       {Uncommon,     0, 0,-1,-2, 0, 1, 0, "Streaky", "Recent results affects performance"}},
+    {EPlayerTrait::TeamOriented,  {Uncommon,    -1, 1, 1, 0, 0, 0, 0, "TeamOriented", "Performs better in familiar teams"}},
+    {EPlayerTrait::TiltProne,     {Rare,         1, 0,-3,-1,-1, 0, 0, "TiltProne", "Becomes reckless after consecutive losses"}},
+    {EPlayerTrait::Unpredictable, {Rare,         0, 1, 0,-2, 0, 3,-2, "Unpredictable", "Inconsistent performance, high variance"}},
+    {EPlayerTrait::Versatile,     {Rare,         0, 3, 0, 0, 0, 2,-1, "Versatile", "Adapts frequently, changes play-style"}},
 };
 
 const std::unordered_map<ETraitRarity, FRarityInfo> TraitRarityLookup = {
@@ -0,0 +1,112 @@
+#include "Profiler.h"
+
+#include <algorithm>
+
+namespace
+{
+    // Per-frame totals of one scope, kept in a ring buffer
+    struct FProfileScopeData
+    {
+        const char* name = nullptr;
+        int64_t frameTotalNs = 0;
+        int frameCalls = 0;
+
+        float historyMs[NumProfileFrames] = {};
+        int historyCalls[NumProfileFrames] = {};
+    };
+
+    std::vector<FProfileScopeData> profileScopes;
+
+    float frameTimesMs[NumProfileFrames] = {};
+    int numRecordedFrames = 0; // saturates at NumProfileFrames
+    int nextFrameSlot = 0;
+    std::chrono::steady_clock::time_point lastFrameEnd = std::chrono::steady_clock::now();
+
+    FProfileSummary Summarize(const char* name, const float* historyMs, const int* historyCalls)
+    {
+        FProfileSummary summary;
+        summary.name = name;
+        if (numRecordedFrames == 0)
+        {
+            return summary;
+        }
+
+        std::vector<float> sorted(historyMs, historyMs + numRecordedFrames);
+        std::sort(sorted.begin(), sorted.end());
+
+        float total = 0.0f;
+        int totalCalls = 0;
+        for (int i = 0; i < numRecordedFrames; ++i)
+        {
+            total += historyMs[i];
+            totalCalls += historyCalls ? historyCalls[i] : 1;
+        }
+
+        int lastSlot = (nextFrameSlot + NumProfileFrames - 1) % NumProfileFrames;
+        summary.lastMs = historyMs[lastSlot];
+        summary.minMs = sorted.front();
+        summary.maxMs = sorted.back();
+        summary.avgMs = total / static_cast<float>(numRecordedFrames);
+        summary.p99Ms = sorted[std::min(numRecordedFrames - 1, numRecordedFrames * 99 / 100)];
+        summary.avgCalls = static_cast<float>(totalCalls) / static_cast<float>(numRecordedFrames);
+        return summary;
+    }
+}
+
+int RegisterProfileScope(const char* name)
+{
+    FProfileScopeData& scope = profileScopes.emplace_back();
+    scope.name = name;
+    return static_cast<int>(profileScopes.size()) - 1;
+}
+
+void AddProfileSample(int scopeId, std::chrono::steady_clock::duration duration)
+{
+    FProfileScopeData& scope = profileScopes[scopeId];
+    scope.frameTotalNs += std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    ++scope.frameCalls;
+}
+
+void EndProfilerFrame()
+{
+    auto now = std::chrono::steady_clock::now();
+    frameTimesMs[nextFrameSlot] = std::chrono::duration<float, std::milli>(now - lastFrameEnd).count();
+    lastFrameEnd = now;
+
+    for (FProfileScopeData& scope : profileScopes)
+    {
+        scope.historyMs[nextFrameSlot] = static_cast<float>(scope.frameTotalNs) * 1e-6f;
+        scope.historyCalls[nextFrameSlot] = scope.frameCalls;
+        scope.frameTotalNs = 0;
+        scope.frameCalls = 0;
+    }
+
+    nextFrameSlot = (nextFrameSlot + 1) % NumProfileFrames;
+    numRecordedFrames = std::min(numRecordedFrames + 1, NumProfileFrames);
+}
+
+std::vector<FProfileSummary> GetProfileSummaries()
+{
+    std::vector<FProfileSummary> summaries;
+    summaries.reserve(profileScopes.size());
+    for (const FProfileScopeData& scope : profileScopes)
+    {
+        summaries.push_back(Summarize(scope.name, scope.historyMs, scope.historyCalls));
+    }
+    return summaries;
+}
+
+FProfileSummary GetFrameTimeSummary()
+{
+    return Summarize("Frame", frameTimesMs, nullptr);
+}
+
+void GetFrameTimeHistory(std::vector<float>& outFrameTimesMs)
+{
+    outFrameTimesMs.clear();
+    int first = numRecordedFrames < NumProfileFrames ? 0 : nextFrameSlot;
+    for (int i = 0; i < numRecordedFrames; ++i)
+    {
+        outFrameTimesMs.push_back(frameTimesMs[(first + i) % NumProfileFrames]);
+    }
+}
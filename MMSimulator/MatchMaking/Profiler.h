@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+#include "TraceRecorder.h"
+
+// Always-on scoped timers with rolling per-frame statistics.
+// Samples are summed per frame and the last NumProfileFrames frames are kept, so the stats show which phase grew.
+// Profile scopes are meant for the main thread; use MM_TRACE_SCOPE for work that runs on other threads.
+
+constexpr int NumProfileFrames = 240;
+
+// Rolling statistics for one scope, in milliseconds per frame
+struct FProfileSummary
+{
+    const char* name = nullptr;
+    float lastMs = 0.0f;
+    float minMs = 0.0f;
+    float avgMs = 0.0f;
+    float maxMs = 0.0f;
+    float p99Ms = 0.0f;
+    float avgCalls = 0.0f; // calls per frame
+};
+
+int RegisterProfileScope(const char* name);
+void AddProfileSample(int scopeId, std::chrono::steady_clock::duration duration);
+
+// Closes the current frame: per-scope totals and the frame time are pushed into the rolling history
+void EndProfilerFrame();
+
+std::vector<FProfileSummary> GetProfileSummaries();
+FProfileSummary GetFrameTimeSummary();
+void GetFrameTimeHistory(std::vector<float>& outFrameTimesMs); // oldest first
+
+// Times the enclosing scope for the profiler, and for the trace when tracing is enabled
+class FProfileScope
+{
+public:
+    FProfileScope(int inScopeId, const char* inName)
+        : scopeId(inScopeId), name(inName), start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~FProfileScope()
+    {
+        auto end = std::chrono::steady_clock::now();
+        AddProfileSample(scopeId, end - start);
+#if MM_ENABLE_TRACE
+        if (IsTraceEnabled())
+        {
+            RecordTraceEvent(name, start, end);
+        }
+#endif
+    }
+
+    FProfileScope(const FProfileScope&) = delete;
+    FProfileScope& operator=(const FProfileScope&) = delete;
+
+private:
+    int scopeId;
+    const char* name;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define MM_PROFILE_SCOPE(Name) \
+    static const int MM_TRACE_CONCAT(profileScopeId_, __LINE__) = RegisterProfileScope(Name); \
+    FProfileScope MM_TRACE_CONCAT(profileScope_, __LINE__)(MM_TRACE_CONCAT(profileScopeId_, __LINE__), Name)
@@ -1,12 +1,22 @@
 #include "RandomGenerator.h"
 
+#include <algorithm>
+#include <cmath>
+
 Xoshiro256SS rng; // ✅ Define a global instance
+uint64_t rngSeed = 0;
 
 void SeedRandomGenerator(uint64_t seed)
 {
+    rngSeed = seed;
     rng.Seed(seed);
 }
 
+uint64_t GetRandomSeed()
+{
+    return rngSeed;
+}
+
 int RandomInt(int min, int max)
 {
     return min + rng.Next() % (max - min + 1);
@@ -27,6 +37,21 @@ float RandomFloatWithAnchor(float anchor, float deviation)
     return RandomFloat(anchor - deviation, anchor + deviation);
 }
 
+float RandomExponential(float rate)
+{
+    // RandomFloat() can round to exactly 0 or 1, keep the log finite
+    float u = std::clamp(RandomFloat(), 1e-7f, 1.0f - 1e-7f);
+    return -std::log(u) / rate;
+}
+
+float RandomNormal(float mean, float stdDev)
+{
+    // Box-Muller
+    float u1 = std::clamp(RandomFloat(), 1e-7f, 1.0f);
+    float u2 = RandomFloat();
+    return mean + stdDev * std::sqrt(-2.0f * std::log(u1)) * std::cos(6.2831853f * u2);
+}
+
 bool GetRandomResult(float probability)
 {
     return RandomFloat() < probability;
@@ -6,6 +6,9 @@ extern Xoshiro256SS rng;
 // Init RNG with a seed
 void SeedRandomGenerator(uint64_t seed);
 
+// The seed last passed to SeedRandomGenerator, needed to reproduce a run
+uint64_t GetRandomSeed();
+
 // Generate a random integer
 int RandomInt(int min, int max);
 
@@ -18,6 +21,12 @@ float RandomFloat(float min, float max);
 // Generate a random float using anchor and deviation
 float RandomFloatWithAnchor(float anchor, float deviation);
 
+// Generate an exponentially distributed float, the gap between events of a Poisson process with {rate} events per unit
+float RandomExponential(float rate);
+
+// Generate a normally distributed float
+float RandomNormal(float mean, float stdDev);
+
 // Returns a random result based on probability between 0 and 1
 bool GetRandomResult(float probability);
 
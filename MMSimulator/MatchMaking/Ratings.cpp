@@ -0,0 +1,382 @@
+#include "Ratings.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "TraceRecorder.h"
+
+namespace
+{
+    // rating points per unit of the Glicko-2 scale
+    constexpr double GlickoScale = 173.7178;
+    constexpr double Pi = 3.14159265358979323846;
+    constexpr double VolatilityTolerance = 1e-6;
+    constexpr int MaxVolatilityIterations = 100;
+
+    double GlickoG(double deviation)
+    {
+        return 1.0 / std::sqrt(1.0 + 3.0 * deviation * deviation / (Pi * Pi));
+    }
+
+    // step 5 of Glicko-2, the volatility that best explains {delta} (the Illinois variant of regula falsi)
+    double GlickoVolatility(double deviation, double variance, double delta, double volatility, double tau)
+    {
+        const double phi2 = deviation * deviation;
+        const double delta2 = delta * delta;
+        const double a = std::log(volatility * volatility);
+        const double tau2 = std::max(tau * tau, 1e-6);
+        auto f = [=](double x)
+        {
+            const double ex = std::exp(x);
+            const double denominator = phi2 + variance + ex;
+            return ex * (delta2 - phi2 - variance - ex) / (2.0 * denominator * denominator) - (x - a) / tau2;
+        };
+
+        double lower = a;
+        double upper = 0.0;
+        if (delta2 > phi2 + variance)
+        {
+            upper = std::log(delta2 - phi2 - variance);
+        }
+        else
+        {
+            int k = 1;
+            while (f(a - k * tau) < 0.0 && k < MaxVolatilityIterations)
+            {
+                ++k;
+            }
+            upper = a - k * tau;
+        }
+        double fLower = f(lower);
+        double fUpper = f(upper);
+        for (int iteration = 0; iteration < MaxVolatilityIterations && std::abs(upper - lower) > VolatilityTolerance; ++iteration)
+        {
+            const double c = lower + (lower - upper) * fLower / (fUpper - fLower);
+            const double fC = f(c);
+            if (fC * fUpper <= 0.0)
+            {
+                lower = upper;
+                fLower = fUpper;
+            }
+            else
+            {
+                fLower *= 0.5;
+            }
+            upper = c;
+            fUpper = fC;
+        }
+        return std::exp(lower * 0.5);
+    }
+
+    // TrueSkill's additive correction to the winner's mean for a win by {t} standard deviations
+    double TrueSkillV(double t)
+    {
+        const double cdf = 0.5 * std::erfc(-t / std::sqrt(2.0));
+        if (cdf < 1e-300)
+        {
+            return -t;
+        }
+        const double pdf = std::exp(-0.5 * t * t) / std::sqrt(2.0 * Pi);
+        return pdf / cdf;
+    }
+}
+
+// ===== FRatingTable BEGIN =====
+
+void FRatingTable::AddPlayer(const FRatingModel& model)
+{
+    deviations.push_back(model.initialDeviation);
+    volatilities.push_back(model.initialVolatility);
+}
+
+void FRatingTable::SetPlayer(int playerId, float deviation, float volatility)
+{
+    deviations[playerId] = deviation;
+    volatilities[playerId] = volatility;
+}
+
+float FRatingTable::Sweep(ERatingSystem system, const FRatingModel& model)
+{
+    const int numPlayers = NumPlayers();
+    const float maxDeviation = model.initialDeviation;
+    if (system == ERatingSystem::Glicko2)
+    {
+        const float scale = static_cast<float>(GlickoScale);
+        for (int i = 0; i < numPlayers; ++i)
+        {
+            const float growth = volatilities[i] * scale;
+            deviations[i] = std::min(std::sqrt(deviations[i] * deviations[i] + growth * growth), maxDeviation);
+        }
+    }
+    else if (system == ERatingSystem::TrueSkill)
+    {
+        const float growth2 = model.trueSkillDynamics * model.trueSkillDynamics;
+        for (int i = 0; i < numPlayers; ++i)
+        {
+            deviations[i] = std::min(std::sqrt(deviations[i] * deviations[i] + growth2), maxDeviation);
+        }
+    }
+
+    double total = 0.0;
+    for (int i = 0; i < numPlayers; ++i)
+    {
+        total += deviations[i];
+    }
+    return numPlayers > 0 ? static_cast<float>(total / numPlayers) : 0.0f;
+}
+
+void FRatingTable::Serialize(FBinaryArchive& Ar)
+{
+    Ar << deviations << volatilities;
+}
+
+// ===== FRatingTable END =====
+
+// ===== FRatingBatch BEGIN =====
+
+void FRatingBatch::Clear()
+{
+    matchTeams.assign(1, 0);
+    matchWinners.clear();
+    teamPlayers.assign(1, 0);
+    playerIds.clear();
+    ratedPlayers.clear();
+    ratings.clear();
+    deviations.clear();
+    volatilities.clear();
+}
+
+void FRatingBatch::BeginMatch(int winner)
+{
+    matchTeams.push_back(matchTeams.back());
+    matchWinners.push_back(winner);
+}
+
+void FRatingBatch::BeginTeam()
+{
+    ++matchTeams.back();
+    teamPlayers.push_back(teamPlayers.back());
+}
+
+void FRatingBatch::AddPlayer(int playerId, float rating, float deviation, float volatility, bool bRated)
+{
+    playerIds.push_back(playerId);
+    ratedPlayers.push_back(bRated ? 1 : 0);
+    ratings.push_back(rating);
+    deviations.push_back(deviation);
+    volatilities.push_back(volatility);
+    ++teamPlayers.back();
+}
+
+void FRatingBatch::Update(ERatingSystem system, const FRatingModel& model, int numThreads)
+{
+    const int numMatches = NumMatches();
+    const size_t numTeams = teamPlayers.size() - 1;
+    teamRatings.resize(numTeams);
+    teamDeviations.resize(numTeams);
+
+    // results start out unchanged, the update of a match only writes its own players
+    ratingChanges.assign(playerIds.size(), 0.0f);
+    newDeviations = deviations;
+    newVolatilities = volatilities;
+
+    // slices are cut by match count alone, so the threads only change who rates which match, never the result
+    if (numThreads <= 0)
+    {
+        numThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    numThreads = std::clamp(numThreads, 1, std::max(1, numMatches / MinMatchesPerThread));
+    auto sliceBegin = [numMatches, numThreads](int slice)
+    {
+        return static_cast<int>(static_cast<int64_t>(numMatches) * slice / numThreads);
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(static_cast<size_t>(numThreads - 1));
+    for (int slice = 1; slice < numThreads; ++slice)
+    {
+        threads.emplace_back([this, system, &model, begin = sliceBegin(slice), end = sliceBegin(slice + 1)]()
+            {
+                UpdateSlice(system, model, begin, end);
+            });
+    }
+    UpdateSlice(system, model, 0, sliceBegin(1));
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void FRatingBatch::UpdateSlice(ERatingSystem system, const FRatingModel& model, int begin, int end)
+{
+    MM_TRACE_SCOPE("RateMatches");
+    for (int m = begin; m < end; ++m)
+    {
+        if (matchWinners[m] < 0 || matchTeams[m + 1] - matchTeams[m] < 2)
+        {
+            continue;
+        }
+        switch (system)
+        {
+        case ERatingSystem::Elo:        UpdateElo(model, m); break;
+        case ERatingSystem::Glicko2:    UpdateGlicko2(model, m); break;
+        case ERatingSystem::TrueSkill:  UpdateTrueSkill(model, m); break;
+        }
+    }
+}
+
+void FRatingBatch::UpdateElo(const FRatingModel& model, int match)
+{
+    const int firstTeam = matchTeams[match];
+    const int lastTeam = matchTeams[match + 1];
+    const int numTeams = lastTeam - firstTeam;
+    const int winner = firstTeam + matchWinners[match];
+    for (int t = firstTeam; t < lastTeam; ++t)
+    {
+        float total = 0.0f;
+        for (int i = teamPlayers[t]; i < teamPlayers[t + 1]; ++i)
+        {
+            total += ratings[i];
+        }
+        teamRatings[t] = total / static_cast<float>(std::max(teamPlayers[t + 1] - teamPlayers[t], 1));
+    }
+
+    for (int t = firstTeam; t < lastTeam; ++t)
+    {
+        float scoreDelta = 0.0f;
+        for (int o = firstTeam; o < lastTeam; ++o)
+        {
+            if (o == t)
+            {
+                continue;
+            }
+            float score = t == winner ? 1.0f : o == winner ? 0.0f : 0.5f;
+            float expected = 1.0f / (1.0f + std::pow(10.0f, (static_cast<float>(teamRatings[o]) - static_cast<float>(teamRatings[t])) / 400.0f));
+            scoreDelta += score - expected;
+        }
+        const float ratingDelta = model.eloK * scoreDelta / static_cast<float>(numTeams - 1);
+        for (int i = teamPlayers[t]; i < teamPlayers[t + 1]; ++i)
+        {
+            ratingChanges[i] = ratedPlayers[i] ? ratingDelta : 0.0f;
+        }
+    }
+}
+
+void FRatingBatch::UpdateGlicko2(const FRatingModel& model, int match)
+{
+    const int firstTeam = matchTeams[match];
+    const int lastTeam = matchTeams[match + 1];
+    const int winner = firstTeam + matchWinners[match];
+    for (int t = firstTeam; t < lastTeam; ++t)
+    {
+        double total = 0.0;
+        double variance = 0.0;
+        for (int i = teamPlayers[t]; i < teamPlayers[t + 1]; ++i)
+        {
+            total += ratings[i];
+            variance += static_cast<double>(deviations[i]) * deviations[i];
+        }
+        const double size = static_cast<double>(std::max(teamPlayers[t + 1] - teamPlayers[t], 1));
+        teamRatings[t] = total / size / GlickoScale;
+        teamDeviations[t] = std::sqrt(variance / size) / GlickoScale;
+    }
+
+    const double minDeviation = model.minDeviation / GlickoScale;
+    for (int t = firstTeam; t < lastTeam; ++t)
+    {
+        // the team's side of the games is the same for all of its players, only their deviation and volatility differ
+        double information = 0.0;
+        double improvement = 0.0;
+        for (int o = firstTeam; o < lastTeam; ++o)
+        {
+            if (o == t)
+            {
+                continue;
+            }
+            const double score = t == winner ? 1.0 : o == winner ? 0.0 : 0.5;
+            const double g = GlickoG(teamDeviations[o]);
+            const double expected = 1.0 / (1.0 + std::exp(-g * (teamRatings[t] - teamRatings[o])));
+            information += g * g * expected * (1.0 - expected);
+            improvement += g * (score - expected);
+        }
+        const double variance = 1.0 / std::max(information, 1e-12);
+
+        for (int i = teamPlayers[t]; i < teamPlayers[t + 1]; ++i)
+        {
+            if (!ratedPlayers[i])
+            {
+                continue;
+            }
+            // the deviation grows with the volatility once per rating period, in the sweep, rather than per match
+            const double deviation = deviations[i] / GlickoScale;
+            const double volatility = GlickoVolatility(deviation, variance, variance * improvement, volatilities[i], model.glickoTau);
+            const double newDeviation = std::max(1.0 / std::sqrt(1.0 / (deviation * deviation) + 1.0 / variance), minDeviation);
+            ratingChanges[i] = static_cast<float>(newDeviation * newDeviation * improvement * GlickoScale);
+            newDeviations[i] = static_cast<float>(newDeviation * GlickoScale);
+            newVolatilities[i] = static_cast<float>(volatility);
+        }
+    }
+}
+
+void FRatingBatch::UpdateTrueSkill(const FRatingModel& model, int match)
+{
+    const int firstTeam = matchTeams[match];
+    const int lastTeam = matchTeams[match + 1];
+    const int winner = firstTeam + matchWinners[match];
+    const double beta2 = static_cast<double>(model.trueSkillBeta) * model.trueSkillBeta;
+    for (int t = firstTeam; t < lastTeam; ++t)
+    {
+        double total = 0.0;
+        double variance = 0.0;
+        for (int i = teamPlayers[t]; i < teamPlayers[t + 1]; ++i)
+        {
+            total += ratings[i];
+            variance += static_cast<double>(deviations[i]) * deviations[i] + beta2;
+        }
+        teamRatings[t] = total;
+        teamDeviations[t] = variance; // the team's performance variance
+    }
+
+    // the winner beat every other team, each comparison moves the winner's players and the loser's. Variances shrink by
+    // a factor per comparison, kept squared in newDeviations until the end
+    for (int i = teamPlayers[firstTeam]; i < teamPlayers[lastTeam]; ++i)
+    {
+        newDeviations[i] = deviations[i] * deviations[i];
+    }
+    for (int o = firstTeam; o < lastTeam; ++o)
+    {
+        if (o == winner)
+        {
+            continue;
+        }
+        const double c2 = teamDeviations[winner] + teamDeviations[o];
+        const double c = std::sqrt(c2);
+        const double t = (teamRatings[winner] - teamRatings[o]) / c;
+        const double v = TrueSkillV(t);
+        const double w = std::clamp(v * (v + t), 0.0, 1.0);
+        for (int team : { winner, o })
+        {
+            const double sign = team == winner ? 1.0 : -1.0;
+            for (int i = teamPlayers[team]; i < teamPlayers[team + 1]; ++i)
+            {
+                const double variance = static_cast<double>(deviations[i]) * deviations[i];
+                ratingChanges[i] += static_cast<float>(sign * variance / c * v);
+                newDeviations[i] *= static_cast<float>(1.0 - variance / c2 * w);
+            }
+        }
+    }
+
+    const float minDeviation = model.minDeviation;
+    for (int i = teamPlayers[firstTeam]; i < teamPlayers[lastTeam]; ++i)
+    {
+        if (!ratedPlayers[i])
+        {
+            ratingChanges[i] = 0.0f;
+            newDeviations[i] = deviations[i];
+            continue;
+        }
+        newDeviations[i] = std::max(std::sqrt(newDeviations[i]), minDeviation);
+    }
+}
+
+// ===== FRatingBatch END =====
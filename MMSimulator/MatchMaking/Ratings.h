@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "BinaryArchive.h"
+
+// How results move the players' ratings
+enum class ERatingSystem : uint8_t
+{
+    Elo,        // every pair of teams on their average ratings, the rating is all there is
+    Glicko2,    // the rating comes with a deviation, how unsure it is, and a volatility, how erratic the player's results are
+    TrueSkill,  // Gaussian skill per player, a team performs the sum of its players
+};
+
+inline const char* GetRatingSystemName(ERatingSystem system)
+{
+    switch (system)
+    {
+    case ERatingSystem::Elo: return "Elo";
+    case ERatingSystem::Glicko2: return "Glicko-2";
+    case ERatingSystem::TrueSkill: return "TrueSkill";
+    }
+    return "Unknown";
+}
+
+// Rating points throughout, Glicko-2 converts to its own scale and back inside the update
+struct FRatingModel
+{
+    float eloK = 32.0f;                 // Elo rating change for a one-sided result
+    float initialDeviation = 350.0f;    // of a new player, inactivity grows a deviation back up to it and no further
+    float minDeviation = 30.0f;         // results stop shrinking the deviation here
+    float initialVolatility = 0.06f;    // Glicko-2 sigma of a new player
+    float glickoTau = 0.5f;             // how far a single result can move the Glicko-2 volatility
+    float trueSkillBeta = 200.0f;       // spread of a player's performance around their skill in a single match
+    float trueSkillDynamics = 20.0f;    // deviation added per rating period, the TrueSkill tau
+};
+
+// Deviation and volatility of every player, dense by player id so offline players keep theirs without a lookup.
+// The ratings themselves stay on the players, every other system reads them there
+class FRatingTable
+{
+public:
+    void AddPlayer(const FRatingModel& model); // the next id
+    int NumPlayers() const { return static_cast<int>(deviations.size()); }
+    float GetDeviation(int playerId) const { return deviations[playerId]; }
+    float GetVolatility(int playerId) const { return volatilities[playerId]; }
+    void SetPlayer(int playerId, float deviation, float volatility);
+
+    // end of a rating period: every deviation grows by one period of uncertainty (the Glicko-2 volatility, or the TrueSkill
+    // dynamics), up to the initial deviation. Returns the average deviation afterwards
+    float Sweep(ERatingSystem system, const FRatingModel& model);
+
+    void Serialize(FBinaryArchive& Ar);
+
+private:
+    std::vector<float> deviations;
+    std::vector<float> volatilities;
+};
+
+// Rating updates for a batch of finished matches at once, on any number of teams.
+// Elo and Glicko-2 treat a match as every team playing each other team: the winner beat them all, the others drew among
+// themselves. Glicko-2 rates each player on their team's average against every other team as a single opponent, whose
+// deviation is the root mean square of its players'. TrueSkill ranks the winner above every other team, the others are
+// not ranked among themselves, and moves each player by their share of their team's variance.
+// Players who left the match count towards their team but aren't rated. Every match is rated from the values it was
+// added with, so the matches of a batch are independent: they are cut into contiguous slices rated on as many threads as
+// asked for, with the same results whatever the split
+class FRatingBatch
+{
+public:
+    static constexpr int MinMatchesPerThread = 64;
+
+    void Clear();
+    void BeginMatch(int winner); // -1 without a winner, which leaves the ratings alone
+    void BeginTeam();
+    void AddPlayer(int playerId, float rating, float deviation, float volatility, bool bRated); // to the last team
+
+    void Update(ERatingSystem system, const FRatingModel& model, int numThreads); // numThreads 0 for one per core
+
+    int NumMatches() const { return static_cast<int>(matchTeams.size()) - 1; }
+    int NumPlayers() const { return static_cast<int>(playerIds.size()); }
+    int GetPlayerId(int player) const { return playerIds[player]; }
+    bool IsRated(int player) const { return ratedPlayers[player] != 0; }
+    float GetRatingChange(int player) const { return ratingChanges[player]; }
+    float GetDeviation(int player) const { return newDeviations[player]; }
+    float GetVolatility(int player) const { return newVolatilities[player]; }
+
+private:
+    void UpdateSlice(ERatingSystem system, const FRatingModel& model, int begin, int end);
+    void UpdateElo(const FRatingModel& model, int match);
+    void UpdateGlicko2(const FRatingModel& model, int match);
+    void UpdateTrueSkill(const FRatingModel& model, int match);
+
+    // matches, teams and players list where they begin with one entry past the last
+    std::vector<int> matchTeams = { 0 };
+    std::vector<int> matchWinners;
+
+    // teams, the aggregates are scratch that every slice only writes for its own teams
+    std::vector<int> teamPlayers = { 0 };
+    std::vector<double> teamRatings;
+    std::vector<double> teamDeviations;
+
+    // players
+    std::vector<int> playerIds;
+    std::vector<uint8_t> ratedPlayers;
+    std::vector<float> ratings;
+    std::vector<float> deviations;
+    std::vector<float> volatilities;
+    std::vector<float> ratingChanges;
+    std::vector<float> newDeviations;
+    std::vector<float> newVolatilities;
+};
@@ -0,0 +1,73 @@
+#include "Region.h"
+
+#include <algorithm>
+
+#include "RandomGenerator.h"
+
+namespace
+{
+    const char* RegionNames[NumRegions] = { "NA East", "NA West", "South America", "Europe", "Asia", "Oceania" };
+
+    // rough round trip times between regions in ms, symmetric
+    constexpr int BaseLatencies[NumRegions][NumRegions] = {
+        //  NAE  NAW   SA   EU   AS  OCE
+        {   20,  70, 130,  90, 200, 210 }, // NA East
+        {   70,  20, 170, 150, 130, 160 }, // NA West
+        {  130, 170,  25, 200, 300, 310 }, // South America
+        {   90, 150, 200,  20, 220, 280 }, // Europe
+        {  200, 130, 300, 220,  30, 120 }, // Asia
+        {  210, 160, 310, 280, 120,  25 }, // Oceania
+    };
+
+    constexpr float MaxJitterMs = 25.0f;
+}
+
+const char* GetRegionName(int region)
+{
+    return region >= 0 && region < NumRegions ? RegionNames[region] : "Unknown";
+}
+
+int GetBaseLatency(int fromRegion, int toRegion)
+{
+    return BaseLatencies[fromRegion][toRegion];
+}
+
+FLatencyVector GenerateLatencies(int homeRegion)
+{
+    FLatencyVector latencies;
+    for (int region = 0; region < NumRegions; ++region)
+    {
+        latencies[region] = static_cast<uint16_t>(GetBaseLatency(homeRegion, region) + static_cast<int>(RandomFloat(0.0f, MaxJitterMs)));
+    }
+    return latencies;
+}
+
+int SampleRegion(const std::vector<float>& weights)
+{
+    float total = 0.0f;
+    for (size_t i = 0; i < weights.size() && i < static_cast<size_t>(NumRegions); ++i)
+    {
+        total += std::max(weights[i], 0.0f);
+    }
+    if (total <= 0.0f)
+    {
+        return 0;
+    }
+
+    float pick = RandomFloat() * total;
+    int lastPositive = 0;
+    for (size_t i = 0; i < weights.size() && i < static_cast<size_t>(NumRegions); ++i)
+    {
+        if (weights[i] <= 0.0f)
+        {
+            continue;
+        }
+        lastPositive = static_cast<int>(i);
+        pick -= weights[i];
+        if (pick < 0.0f)
+        {
+            return lastPositive;
+        }
+    }
+    return lastPositive;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Data center regions, every region hosts matches and has its own queue
+enum class ERegion : uint8_t
+{
+    NorthAmericaEast,
+    NorthAmericaWest,
+    SouthAmerica,
+    Europe,
+    Asia,
+    Oceania,
+    Num
+};
+
+constexpr int NumRegions = static_cast<int>(ERegion::Num);
+
+// round trip time in ms from a player to each data center
+using FLatencyVector = std::array<uint16_t, NumRegions>;
+
+const char* GetRegionName(int region);
+int GetBaseLatency(int fromRegion, int toRegion);
+
+// latencies of a player living in {homeRegion}: the base latency of each data center plus some last-mile jitter
+FLatencyVector GenerateLatencies(int homeRegion);
+
+// picks a region by relative weight, the first region when no weight is positive
+int SampleRegion(const std::vector<float>& weights);
@@ -0,0 +1,120 @@
+#include "Rematch.h"
+
+#include <algorithm>
+
+// ===== FRecentOpponents BEGIN =====
+
+void FRecentOpponents::AddPlayer()
+{
+    opponents.insert(opponents.end(), MaxRecentOpponents, None);
+    heads.push_back(0);
+}
+
+void FRecentOpponents::Record(int playerId, int opponentId)
+{
+    uint8_t& head = heads[playerId];
+    opponents[static_cast<size_t>(playerId) * MaxRecentOpponents + head] = opponentId;
+    head = static_cast<uint8_t>((head + 1) % MaxRecentOpponents);
+}
+
+bool FRecentOpponents::HasPlayed(int playerId, int opponentId) const
+{
+    const int* recent = GetOpponents(playerId);
+    return std::find(recent, recent + MaxRecentOpponents, opponentId) != recent + MaxRecentOpponents;
+}
+
+void FRecentOpponents::Serialize(FBinaryArchive& Ar)
+{
+    Ar << opponents << heads;
+}
+
+// ===== FRecentOpponents END =====
+
+// ===== FRematchGuard BEGIN =====
+
+void FRematchGuard::Bind(const FRecentOpponents* inOpponents, const std::unordered_map<int, std::vector<int>>* inParties)
+{
+    opponents = inOpponents;
+    parties = inParties;
+}
+
+void FRematchGuard::Begin()
+{
+    pickedMask = 0;
+    opponentMask.fill(0);
+    picked.clear();
+}
+
+bool FRematchGuard::Admit(int leaderId)
+{
+    auto it = parties->find(leaderId);
+    const int* members = it != parties->end() ? it->second.data() : &leaderId;
+    const size_t numMembers = it != parties->end() ? it->second.size() : 1;
+    for (size_t member = 0; member < numMembers; ++member)
+    {
+        if (Conflicts(members[member]))
+        {
+            ++rejections;
+            return false;
+        }
+    }
+    for (size_t member = 0; member < numMembers; ++member)
+    {
+        const int playerId = members[member];
+        picked.push_back(playerId);
+        pickedMask |= GetBit(playerId);
+        if (playerId >= 0 && playerId < opponents->NumPlayers())
+        {
+            const int* recent = opponents->GetOpponents(playerId);
+            for (int i = 0; i < FRecentOpponents::MaxRecentOpponents; ++i)
+            {
+                if (recent[i] != FRecentOpponents::None)
+                {
+                    const uint32_t bit = Hash(recent[i]) >> 22;
+                    opponentMask[bit / 64] |= uint64_t(1) << (bit % 64);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool FRematchGuard::Conflicts(int playerId) const
+{
+    if (picked.empty() || playerId < 0 || playerId >= opponents->NumPlayers())
+    {
+        return false;
+    }
+    // the player's own ring against the picked players
+    const int* recent = opponents->GetOpponents(playerId);
+    for (int i = 0; i < FRecentOpponents::MaxRecentOpponents; ++i)
+    {
+        const int opponentId = recent[i];
+        if (opponentId != FRecentOpponents::None && (pickedMask & GetBit(opponentId)) != 0
+            && std::find(picked.begin(), picked.end(), opponentId) != picked.end())
+        {
+            return true;
+        }
+    }
+    // the picked players' rings against the player, where a pair the player's ring already dropped may still be listed
+    const uint32_t bit = Hash(playerId) >> 22;
+    if ((opponentMask[bit / 64] & (uint64_t(1) << (bit % 64))) == 0)
+    {
+        return false;
+    }
+    for (int pickedId : picked)
+    {
+        if (pickedId >= 0 && pickedId < opponents->NumPlayers() && opponents->HasPlayed(pickedId, playerId))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FRematchGuard::Serialize(FBinaryArchive& Ar)
+{
+    Ar << rejections;
+}
+
+// ===== FRematchGuard END =====
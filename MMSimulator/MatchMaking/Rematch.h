@@ -0,0 +1,61 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "BinaryArchive.h"
+
+// The last opponents of every player, a fixed ring of ids each, dense by player id so the memory per player is bounded and
+// offline players keep theirs. Results are recorded both ways, but every ring ages at its player's own pace, so a pair may still
+// be listed by only one of them
+class FRecentOpponents
+{
+public:
+    static constexpr int MaxRecentOpponents = 16;
+    static constexpr int None = -1;
+
+    void AddPlayer(); // the next id
+    int NumPlayers() const { return static_cast<int>(heads.size()); }
+    void Record(int playerId, int opponentId); // overwrites the oldest
+    bool HasPlayed(int playerId, int opponentId) const;
+    const int* GetOpponents(int playerId) const { return &opponents[static_cast<size_t>(playerId) * MaxRecentOpponents]; } // MaxRecentOpponents ids, None for empty entries
+
+    void Serialize(FBinaryArchive& Ar);
+
+private:
+    std::vector<int> opponents; // MaxRecentOpponents per player
+    std::vector<uint8_t> heads; // by player id, the entry written next
+};
+
+// Rematch avoidance for a match being packed: the parties are offered one by one and a party is admitted unless one of its
+// players recently faced a player already picked, as listed by either of them. The picked players and their recent opponents
+// are hashed into bit masks, so the check is a few bit tests per recent opponent of the candidate's players and an exact search
+// only when a bit is set, O(party size) per candidate
+class FRematchGuard
+{
+public:
+    // what the guard checks against, bound before every matchmaking pass so it survives the owner being moved
+    void Bind(const FRecentOpponents* inOpponents, const std::unordered_map<int, std::vector<int>>* inParties);
+
+    void Begin(); // a new match
+    bool Admit(int leaderId); // the party's players join the match unless they bring a rematch
+
+    int64_t GetRejections() const { return rejections; }
+
+    void Serialize(FBinaryArchive& Ar); // the rejection count, the rest is bound or rebuilt for every match
+
+private:
+    static constexpr int OpponentMaskBits = 1024; // the picked players' recent opponents, a 5v5 match sets about 15% of them
+
+    static uint32_t Hash(int playerId) { return static_cast<uint32_t>(playerId) * 0x9E3779B1u; }
+    static uint64_t GetBit(int playerId) { return uint64_t(1) << (Hash(playerId) >> 26); }
+    bool Conflicts(int playerId) const;
+
+    const FRecentOpponents* opponents = nullptr;
+    const std::unordered_map<int, std::vector<int>>* parties = nullptr; // members by leader id, solo players have no entry
+    uint64_t pickedMask = 0;
+    std::array<uint64_t, OpponentMaskBits / 64> opponentMask{};
+    std::vector<int> picked;
+    int64_t rejections = 0;
+};
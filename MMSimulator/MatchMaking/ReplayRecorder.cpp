@@ -0,0 +1,394 @@
+#include "ReplayRecorder.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "RandomGenerator.h"
+#include "SimClock.h"
+
+namespace
+{
+    // replay file header, bump the version whenever the stream layout changes
+    constexpr uint32_t ReplayMagic = 0x50524D4D; // "MMRP"
+    constexpr uint32_t ReplayVersion = 19;
+
+    bool IsDecision(const FReplayEvent& event)
+    {
+        return event.type == EReplayEvent::MatchFormed || event.type == EReplayEvent::MatchResult || event.type == EReplayEvent::Backfill;
+    }
+
+    bool DecodeReplay(std::vector<char>&& data, uint64_t& outSeed, FMatchSetting& outSetting, FArrivalSetting& outArrivalSetting, std::vector<FReplayEvent>& outEvents)
+    {
+        FBinaryArchive Ar = FBinaryArchive::ForLoading(std::move(data));
+
+        uint32_t magic = 0;
+        uint32_t version = 0;
+        Ar << magic << version;
+        if (magic != ReplayMagic || version != ReplayVersion)
+        {
+            return false;
+        }
+
+        Ar << outSeed;
+        outSetting.Serialize(Ar);
+        outArrivalSetting.Serialize(Ar);
+
+        outEvents.clear();
+        while (!Ar.AtEnd() && !Ar.HasError())
+        {
+            FReplayEvent& event = outEvents.emplace_back();
+            if (!SerializeReplayEvent(Ar, event))
+            {
+                outEvents.pop_back();
+                return false;
+            }
+        }
+        return !Ar.HasError();
+    }
+}
+
+// ===== FReplayEvent BEGIN =====
+
+bool FReplayEvent::operator==(const FReplayEvent& other) const
+{
+    return type == other.type && value == other.value && winningTeamIndex == other.winningTeamIndex && teams == other.teams;
+}
+
+std::string FReplayEvent::ToString() const
+{
+    std::ostringstream ss;
+    switch (type)
+    {
+    case EReplayEvent::Tick:            ss << "Tick +" << value << "ns"; break;
+    case EReplayEvent::CreatePlayer:    ss << "CreatePlayer"; break;
+    case EReplayEvent::SetMatchSetting: ss << "SetMatchSetting"; break;
+    case EReplayEvent::SetArrivalSetting: ss << "SetArrivalSetting"; break;
+    case EReplayEvent::WorkLimit:       ss << "WorkLimit phase " << static_cast<int>(phase) << " after " << value; break;
+    case EReplayEvent::MatchFormed:
+        ss << "MatchFormed [" << value << "] ";
+        for (size_t t = 0; t < teams.size(); ++t)
+        {
+            for (size_t p = 0; p < teams[t].size(); ++p)
+            {
+                ss << "[" << teams[t][p] << "]";
+            }
+            if (t < teams.size() - 1)
+            {
+                ss << "vs";
+            }
+        }
+        break;
+    case EReplayEvent::MatchResult:     ss << "MatchResult [" << value << "] winner: team " << winningTeamIndex; break;
+    case EReplayEvent::Backfill:
+        ss << "Backfill [" << value << "] ";
+        if (!teams.empty() && teams[0].size() == 2)
+        {
+            ss << "[" << teams[0][1] << "] for [" << teams[0][0] << "]";
+        }
+        break;
+    case EReplayEvent::End:             ss << "End hash: " << value; break;
+    }
+    return ss.str();
+}
+
+bool SerializeReplayEvent(FBinaryArchive& Ar, FReplayEvent& event)
+{
+    Ar << event.type;
+    switch (event.type)
+    {
+    case EReplayEvent::Tick:
+        Ar.SerializeVarInt(event.value);
+        break;
+    case EReplayEvent::CreatePlayer:
+        break;
+    case EReplayEvent::SetMatchSetting:
+        event.setting.Serialize(Ar);
+        break;
+    case EReplayEvent::SetArrivalSetting:
+        event.arrivalSetting.Serialize(Ar);
+        break;
+    case EReplayEvent::WorkLimit:
+        Ar << event.phase;
+        Ar.SerializeVarInt(event.value);
+        if (event.phase >= EUpdatePhase::Num)
+        {
+            return false;
+        }
+        break;
+    case EReplayEvent::MatchFormed:
+    case EReplayEvent::Backfill:
+    {
+        Ar.SerializeVarInt(event.value);
+        uint64_t numTeams = event.teams.size();
+        Ar.SerializeVarUInt(numTeams);
+        if (Ar.IsLoading())
+        {
+            if (Ar.HasError() || numTeams > Ar.GetData().size())
+            {
+                return false;
+            }
+            event.teams.resize(static_cast<size_t>(numTeams));
+        }
+        for (std::vector<int>& team : event.teams)
+        {
+            uint64_t teamSize = team.size();
+            Ar.SerializeVarUInt(teamSize);
+            if (Ar.IsLoading())
+            {
+                if (Ar.HasError() || teamSize > Ar.GetData().size())
+                {
+                    return false;
+                }
+                team.resize(static_cast<size_t>(teamSize));
+            }
+            for (int& playerId : team)
+            {
+                int64_t id = playerId;
+                Ar.SerializeVarInt(id);
+                playerId = static_cast<int>(id);
+            }
+        }
+        break;
+    }
+    case EReplayEvent::MatchResult:
+    {
+        Ar.SerializeVarInt(event.value);
+        int64_t winner = event.winningTeamIndex;
+        Ar.SerializeVarInt(winner);
+        event.winningTeamIndex = static_cast<int>(winner);
+        break;
+    }
+    case EReplayEvent::End:
+        Ar << event.value;
+        break;
+    default:
+        return false;
+    }
+    return !Ar.HasError();
+}
+
+// ===== FReplayEvent END =====
+
+// ===== FReplayRecorder BEGIN =====
+
+FReplayRecorder::FReplayRecorder()
+    : Ar(FBinaryArchive::ForSaving())
+{
+}
+
+void FReplayRecorder::Begin(uint64_t seed, FMatchSetting setting, FArrivalSetting arrivalSetting)
+{
+    uint32_t magic = ReplayMagic;
+    uint32_t version = ReplayVersion;
+    Ar << magic << version << seed;
+    setting.Serialize(Ar);
+    arrivalSetting.Serialize(Ar);
+}
+
+void FReplayRecorder::RecordTick(std::chrono::steady_clock::duration delta)
+{
+    FReplayEvent event;
+    event.type = EReplayEvent::Tick;
+    event.value = std::chrono::duration_cast<std::chrono::nanoseconds>(delta).count();
+    SerializeReplayEvent(Ar, event);
+    ++numEvents;
+}
+
+void FReplayRecorder::RecordCreatePlayer()
+{
+    FReplayEvent event;
+    event.type = EReplayEvent::CreatePlayer;
+    SerializeReplayEvent(Ar, event);
+    ++numEvents;
+}
+
+void FReplayRecorder::RecordMatchSetting(FMatchSetting setting)
+{
+    FReplayEvent event;
+    event.type = EReplayEvent::SetMatchSetting;
+    event.setting = setting;
+    SerializeReplayEvent(Ar, event);
+    ++numEvents;
+}
+
+void FReplayRecorder::RecordArrivalSetting(FArrivalSetting setting)
+{
+    FReplayEvent event;
+    event.type = EReplayEvent::SetArrivalSetting;
+    event.arrivalSetting = setting;
+    SerializeReplayEvent(Ar, event);
+    ++numEvents;
+}
+
+void FReplayRecorder::RecordWorkLimit(EUpdatePhase phase, int processed)
+{
+    FReplayEvent event;
+    event.type = EReplayEvent::WorkLimit;
+    event.phase = phase;
+    event.value = processed;
+    SerializeReplayEvent(Ar, event);
+    ++numEvents;
+}
+
+void FReplayRecorder::RecordMatchFormed(const FMatch& match)
+{
+    FReplayEvent event;
+    event.type = EReplayEvent::MatchFormed;
+    event.value = match.matchId;
+    for (const std::vector<VirtualPlayer>& team : match.teams)
+    {
+        std::vector<int>& ids = event.teams.emplace_back();
+        for (const VirtualPlayer& player : team)
+        {
+            ids.push_back(player.GetId());
+        }
+    }
+    SerializeReplayEvent(Ar, event);
+    ++numEvents;
+}
+
+void FReplayRecorder::RecordMatchResult(const FMatch& match)
+{
+    FReplayEvent event;
+    event.type = EReplayEvent::MatchResult;
+    event.value = match.matchId;
+    event.winningTeamIndex = match.winningTeamIndex;
+    SerializeReplayEvent(Ar, event);
+    ++numEvents;
+}
+
+void FReplayRecorder::RecordBackfill(int matchId, int departedId, int playerId)
+{
+    FReplayEvent event;
+    event.type = EReplayEvent::Backfill;
+    event.value = matchId;
+    event.teams.push_back({ departedId, playerId });
+    SerializeReplayEvent(Ar, event);
+    ++numEvents;
+}
+
+void FReplayRecorder::End(uint64_t stateHash)
+{
+    FReplayEvent event;
+    event.type = EReplayEvent::End;
+    event.value = static_cast<int64_t>(stateHash);
+    SerializeReplayEvent(Ar, event);
+    ++numEvents;
+}
+
+// ===== FReplayRecorder END =====
+
+bool LoadReplay(const std::string& path, uint64_t& outSeed, FMatchSetting& outSetting, FArrivalSetting& outArrivalSetting, std::vector<FReplayEvent>& outEvents)
+{
+    std::vector<char> data;
+    return FBinaryArchive::ReadFile(path, data) && DecodeReplay(std::move(data), outSeed, outSetting, outArrivalSetting, outEvents);
+}
+
+FReplayReport RunReplay(const std::string& path)
+{
+    FReplayReport report;
+
+    uint64_t seed = 0;
+    FMatchSetting setting;
+    FArrivalSetting arrivalSetting;
+    std::vector<FReplayEvent> events;
+    if (!LoadReplay(path, seed, setting, arrivalSetting, events))
+    {
+        return report;
+    }
+    report.bLoaded = true;
+    report.numEvents = events.size();
+
+    auto wallStart = std::chrono::steady_clock::now();
+    bool bWasManual = simClock.IsManual();
+    simClock.SetManual(true);
+    SeedRandomGenerator(seed);
+
+    // the replayed system records its own stream, which is then compared with the original one
+    MatchMakingSystem system;
+    system.SetMatchSetting(setting);
+    system.SetArrivalSetting(arrivalSetting);
+    FReplayRecorder verifier;
+    system.SetReplayRecorder(&verifier);
+    system.SetReplayPlayback(true);
+
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        const FReplayEvent& event = events[i];
+        switch (event.type)
+        {
+        case EReplayEvent::Tick:
+            // budget cuts are recorded while the tick runs, so they follow its Tick event in the stream
+            for (size_t next = i + 1; next < events.size() && events[next].type != EReplayEvent::Tick; ++next)
+            {
+                if (events[next].type == EReplayEvent::WorkLimit)
+                {
+                    system.SetReplayWorkLimit(events[next].phase, static_cast<int>(events[next].value));
+                }
+            }
+            simClock.Advance(std::chrono::nanoseconds(event.value));
+            system.Update();
+            ++report.numTicks;
+            report.simulatedSeconds += static_cast<double>(event.value) * 1e-9;
+            break;
+        case EReplayEvent::CreatePlayer:
+            system.CreatePlayer();
+            break;
+        case EReplayEvent::SetMatchSetting:
+            system.SetMatchSetting(event.setting);
+            break;
+        case EReplayEvent::SetArrivalSetting:
+            system.SetArrivalSetting(event.arrivalSetting);
+            break;
+        case EReplayEvent::End:
+            report.recordedHash = static_cast<uint64_t>(event.value);
+            break;
+        default:
+            break; // decisions are regenerated by the system, work limits were applied with their tick
+        }
+    }
+
+    report.replayedHash = system.ComputeStateHash();
+    verifier.End(report.replayedHash);
+    system.SetReplayRecorder(nullptr);
+    simClock.SetManual(bWasManual);
+    report.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    // compare decision by decision to locate the first divergence
+    uint64_t replayedSeed = 0;
+    FMatchSetting replayedSetting;
+    FArrivalSetting replayedArrivalSetting;
+    std::vector<FReplayEvent> replayedEvents;
+    std::vector<char> replayedData = verifier.GetData();
+    DecodeReplay(std::move(replayedData), replayedSeed, replayedSetting, replayedArrivalSetting, replayedEvents);
+
+    std::vector<const FReplayEvent*> recordedDecisions;
+    std::vector<const FReplayEvent*> replayedDecisions;
+    for (const FReplayEvent& event : events)
+    {
+        if (IsDecision(event)) recordedDecisions.push_back(&event);
+    }
+    for (const FReplayEvent& event : replayedEvents)
+    {
+        if (IsDecision(event)) replayedDecisions.push_back(&event);
+    }
+
+    size_t numCompared = std::min(recordedDecisions.size(), replayedDecisions.size());
+    report.firstMismatch = numCompared;
+    for (size_t i = 0; i < numCompared; ++i)
+    {
+        if (!(*recordedDecisions[i] == *replayedDecisions[i]))
+        {
+            report.firstMismatch = i;
+            report.mismatchDetail = "recorded: " + recordedDecisions[i]->ToString() + ", replayed: " + replayedDecisions[i]->ToString();
+            break;
+        }
+    }
+    if (report.mismatchDetail.empty() && recordedDecisions.size() != replayedDecisions.size())
+    {
+        report.mismatchDetail = "recorded " + std::to_string(recordedDecisions.size()) + " decisions, replayed " + std::to_string(replayedDecisions.size());
+    }
+
+    report.bIdentical = report.mismatchDetail.empty() && report.recordedHash == report.replayedHash;
+    return report;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "BinaryArchive.h"
+#include "MatchMakingSystem.h"
+
+// Event types stored in a replay stream.
+// Inputs are fed back to the system during replay, decisions are re-generated and compared against the recording.
+enum class EReplayEvent : uint8_t
+{
+    Tick,               // input: clock advanced by {value} ns and Update() was called
+    CreatePlayer,       // input: a player was created from outside the system
+    SetMatchSetting,    // input: match settings changed
+    SetArrivalSetting,  // input: arrival process settings changed
+    WorkLimit,          // input: {phase} ran out of CPU budget after {value} units of work in the current tick
+    MatchFormed,        // decision: match {value} was formed with {teams}
+    MatchResult,        // decision: match {value} finished, won by {winningTeamIndex}
+    Backfill,           // decision: in match {value} the player teams[0][1] took the place teams[0][0] left
+    End,                // end of recording, {value} is the final state hash
+};
+
+// A decoded replay event
+struct FReplayEvent
+{
+    EReplayEvent type = EReplayEvent::Tick;
+    int64_t value = 0;
+    int winningTeamIndex = -1;
+    EUpdatePhase phase = EUpdatePhase::Matchmake;
+    std::vector<std::vector<int>> teams;
+    FMatchSetting setting;
+    FArrivalSetting arrivalSetting;
+
+    bool operator==(const FReplayEvent& other) const;
+    std::string ToString() const;
+};
+
+// Records the inputs and decisions of a run into a compact binary stream
+class FReplayRecorder
+{
+public:
+    FReplayRecorder();
+
+    void Begin(uint64_t seed, FMatchSetting setting, FArrivalSetting arrivalSetting);
+    void RecordTick(std::chrono::steady_clock::duration delta);
+    void RecordCreatePlayer();
+    void RecordMatchSetting(FMatchSetting setting);
+    void RecordArrivalSetting(FArrivalSetting setting);
+    void RecordWorkLimit(EUpdatePhase phase, int processed);
+    void RecordMatchFormed(const FMatch& match);
+    void RecordMatchResult(const FMatch& match);
+    void RecordBackfill(int matchId, int departedId, int playerId);
+    void End(uint64_t stateHash);
+
+    bool SaveToFile(const std::string& path) const { return Ar.SaveToFile(path); }
+    const std::vector<char>& GetData() const { return Ar.GetData(); }
+    size_t GetNumEvents() const { return numEvents; }
+
+private:
+    FBinaryArchive Ar;
+    size_t numEvents = 0;
+};
+
+// Result of re-running a replay
+struct FReplayReport
+{
+    bool bLoaded = false;
+    bool bIdentical = false;
+    size_t numEvents = 0;
+    size_t numTicks = 0;
+    size_t firstMismatch = 0; // index of the first decision that differs from the recording
+    std::string mismatchDetail;
+    uint64_t recordedHash = 0;
+    uint64_t replayedHash = 0;
+    double wallSeconds = 0.0;
+    double simulatedSeconds = 0.0;
+};
+
+// Stream helpers
+bool SerializeReplayEvent(FBinaryArchive& Ar, FReplayEvent& event);
+bool LoadReplay(const std::string& path, uint64_t& outSeed, FMatchSetting& outSetting, FArrivalSetting& outArrivalSetting, std::vector<FReplayEvent>& outEvents);
+
+// Re-runs a recorded stream at maximum speed on a manual clock and verifies it produces the same decisions and final state
+FReplayReport RunReplay(const std::string& path);
@@ -0,0 +1,67 @@
+#include "Role.h"
+
+#include "RandomGenerator.h"
+
+namespace
+{
+    const char* RoleNames[NumRoles] = { "Tank", "Support", "Damage" };
+
+    // share of players picking each role as their main one, damage is the crowded one
+    constexpr float MainRoleWeights[NumRoles] = { 0.2f, 0.25f, 0.55f };
+
+    constexpr float FlexChance = 0.2f;
+}
+
+const char* GetRoleName(int role)
+{
+    return role >= 0 && role < NumRoles ? RoleNames[role] : "Unknown";
+}
+
+std::string RolesToString(FRoleMask roles)
+{
+    std::string result;
+    for (int role = 0; role < NumRoles; ++role)
+    {
+        if (roles & GetRoleBit(role))
+        {
+            result += result.empty() ? "" : "/";
+            result += RoleNames[role];
+        }
+    }
+    return result.empty() ? "None" : result;
+}
+
+int GetCompositionSize(const FRoleComposition& composition)
+{
+    int size = 0;
+    for (uint8_t count : composition)
+    {
+        size += count;
+    }
+    return size;
+}
+
+FRoleMask GenerateRoles()
+{
+    float pick = RandomFloat();
+    int mainRole = NumRoles - 1;
+    for (int role = 0; role < NumRoles; ++role)
+    {
+        pick -= MainRoleWeights[role];
+        if (pick < 0.0f)
+        {
+            mainRole = role;
+            break;
+        }
+    }
+
+    FRoleMask roles = GetRoleBit(mainRole);
+    for (int role = 0; role < NumRoles; ++role)
+    {
+        if (role != mainRole && GetRandomResult(FlexChance))
+        {
+            roles |= GetRoleBit(role);
+        }
+    }
+    return roles;
+}
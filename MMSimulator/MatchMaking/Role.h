@@ -0,0 +1,30 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+
+// Roles a player can fill in a team
+enum class ERole : uint8_t
+{
+    Tank,
+    Support,
+    Damage,
+    Num
+};
+
+constexpr int NumRoles = static_cast<int>(ERole::Num);
+
+// set of roles, bit i stands for ERole i
+using FRoleMask = uint8_t;
+constexpr FRoleMask AllRoles = static_cast<FRoleMask>((1 << NumRoles) - 1);
+constexpr FRoleMask GetRoleBit(int role) { return static_cast<FRoleMask>(1 << role); }
+
+// players of each role in one team
+using FRoleComposition = std::array<uint8_t, NumRoles>;
+
+const char* GetRoleName(int role);
+std::string RolesToString(FRoleMask roles); // e.g. "Tank/Damage"
+int GetCompositionSize(const FRoleComposition& composition);
+
+// roles a new player declares: a main role by popularity, plus every other role with a small flex chance
+FRoleMask GenerateRoles();
@@ -0,0 +1,21 @@
+#include "SimClock.h"
+
+FSimClock simClock;
+
+FSimClock::FSimClock()
+{
+    currentTime = std::chrono::steady_clock::now();
+}
+
+void FSimClock::Tick()
+{
+    if (!bManual)
+    {
+        currentTime = std::chrono::steady_clock::now();
+    }
+}
+
+void FSimClock::Advance(std::chrono::steady_clock::duration delta)
+{
+    currentTime += delta;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <chrono>
+
+// Clock shared by the whole simulation.
+// The time is latched once per Update so every decision made during a tick sees the same "now".
+// In manual mode the clock only moves when advanced, which lets replays and benchmarks run at full speed with exact timing.
+struct FSimClock
+{
+    FSimClock();
+
+    // latch the real time, does nothing in manual mode
+    void Tick();
+
+    // move the clock forward, only used in manual mode
+    void Advance(std::chrono::steady_clock::duration delta);
+
+    void SetManual(bool bInManual) { bManual = bInManual; }
+    bool IsManual() const { return bManual; }
+    std::chrono::steady_clock::time_point Now() const { return currentTime; }
+
+private:
+    bool bManual = false;
+    std::chrono::steady_clock::time_point currentTime;
+};
+
+extern FSimClock simClock;
+
+// Current simulation time
+inline std::chrono::steady_clock::time_point SimNow() { return simClock.Now(); }
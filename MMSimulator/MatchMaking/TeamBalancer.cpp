@@ -0,0 +1,260 @@
+#include "TeamBalancer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void FTeamBalancer::Balance(ETeamBalancing mode, bool bLocalSearch, std::vector<std::vector<FBalanceUnit>>& teams)
+{
+    if (teams.size() < 2 || (mode == ETeamBalancing::None && !bLocalSearch))
+    {
+        return;
+    }
+
+    // strongest first, ties by leader so equal ratings always land the same way
+    units.clear();
+    bool bAllSolo = true; // every unit interchangeable with every other
+    for (const std::vector<FBalanceUnit>& team : teams)
+    {
+        units.insert(units.end(), team.begin(), team.end());
+        bAllSolo &= team.size() == teams[0].size();
+    }
+    for (const FBalanceUnit& unit : units)
+    {
+        bAllSolo &= unit.size == 1 && unit.role == units[0].role;
+    }
+    std::sort(units.begin(), units.end(), [](const FBalanceUnit& a, const FBalanceUnit& b)
+        {
+            return a.rating != b.rating ? a.rating > b.rating : a.leaderId < b.leaderId;
+        });
+
+    switch (mode)
+    {
+    case ETeamBalancing::None:
+        break;
+    case ETeamBalancing::Greedy:
+        BalanceGreedy(teams);
+        break;
+    case ETeamBalancing::Differencing:
+        // differencing needs interchangeable units, parties of different sizes or roles have to respect the packed slots
+        if (bAllSolo)
+        {
+            BalanceDifferencing(teams);
+        }
+        else
+        {
+            BalanceGreedy(teams);
+        }
+        break;
+    }
+
+    if (bLocalSearch)
+    {
+        LocalSearch(teams);
+    }
+}
+
+float FTeamBalancer::GetSpread(const std::vector<std::vector<FBalanceUnit>>& teams)
+{
+    if (teams.size() < 2)
+    {
+        return 0.0f;
+    }
+    float strongest = std::numeric_limits<float>::lowest();
+    float weakest = std::numeric_limits<float>::max();
+    for (const std::vector<FBalanceUnit>& team : teams)
+    {
+        float total = 0.0f;
+        for (const FBalanceUnit& unit : team)
+        {
+            total += unit.rating;
+        }
+        strongest = std::max(strongest, total);
+        weakest = std::min(weakest, total);
+    }
+    return strongest - weakest;
+}
+
+void FTeamBalancer::BalanceGreedy(std::vector<std::vector<FBalanceUnit>>& teams)
+{
+    // each team keeps the slot sizes and roles it was packed with, the units are dealt onto them again
+    const size_t numTeams = teams.size();
+    int maxSize = 1;
+    int maxRole = -1;
+    for (const FBalanceUnit& unit : units)
+    {
+        maxSize = std::max(maxSize, unit.size);
+        maxRole = std::max(maxRole, unit.role);
+    }
+    const size_t sizeStride = static_cast<size_t>(maxSize) + 1;
+    const size_t stride = sizeStride * static_cast<size_t>(maxRole + 2);
+    auto slotOf = [sizeStride](const FBalanceUnit& unit)
+    {
+        return static_cast<size_t>(unit.role + 1) * sizeStride + static_cast<size_t>(unit.size);
+    };
+    openSlots.assign(numTeams * stride, 0);
+    for (size_t t = 0; t < numTeams; ++t)
+    {
+        for (const FBalanceUnit& unit : teams[t])
+        {
+            ++openSlots[t * stride + slotOf(unit)];
+        }
+        teams[t].clear();
+    }
+
+    teamTotals.assign(numTeams, 0.0);
+    for (const FBalanceUnit& unit : units)
+    {
+        size_t best = numTeams;
+        for (size_t t = 0; t < numTeams; ++t)
+        {
+            if (openSlots[t * stride + slotOf(unit)] > 0 && (best == numTeams || teamTotals[t] < teamTotals[best]))
+            {
+                best = t;
+            }
+        }
+        --openSlots[best * stride + slotOf(unit)];
+        teamTotals[best] += unit.rating;
+        teams[best].push_back(unit);
+    }
+}
+
+void FTeamBalancer::BalanceDifferencing(std::vector<std::vector<FBalanceUnit>>& teams)
+{
+    /*
+     * Balanced largest differencing: every run of {numTeams} consecutive units (in rating order) starts as a partial partition
+     * with one unit per subset. The two partial partitions with the largest spread are merged by joining the largest subset of
+     * one with the smallest of the other, until one partition is left. Every subset gets one unit from each run, so all teams
+     * end up with the same number of players
+     */
+    const int numTeams = static_cast<int>(teams.size());
+    const int numPartitions = static_cast<int>(units.size()) / numTeams;
+    nextUnit.assign(units.size(), -1);
+    subsets.resize(units.size());
+    partitionHeap.clear();
+    for (int p = 0; p < numPartitions; ++p)
+    {
+        for (int j = 0; j < numTeams; ++j)
+        {
+            int index = p * numTeams + j;
+            subsets[index].sum = units[index].rating;
+            subsets[index].head = index;
+            subsets[index].tail = index;
+        }
+        partitionHeap.push_back(p);
+    }
+
+    auto spread = [this, numTeams](int p)
+    {
+        return subsets[p * numTeams].sum - subsets[p * numTeams + numTeams - 1].sum;
+    };
+    auto lessSpread = [&spread](int a, int b)
+    {
+        double spreadA = spread(a);
+        double spreadB = spread(b);
+        return spreadA != spreadB ? spreadA < spreadB : a > b;
+    };
+    std::make_heap(partitionHeap.begin(), partitionHeap.end(), lessSpread);
+
+    while (partitionHeap.size() > 1)
+    {
+        std::pop_heap(partitionHeap.begin(), partitionHeap.end(), lessSpread);
+        int a = partitionHeap.back();
+        partitionHeap.pop_back();
+        std::pop_heap(partitionHeap.begin(), partitionHeap.end(), lessSpread);
+        int b = partitionHeap.back();
+        partitionHeap.pop_back();
+
+        for (int i = 0; i < numTeams; ++i)
+        {
+            FSubset& into = subsets[a * numTeams + i];
+            const FSubset& from = subsets[b * numTeams + numTeams - 1 - i];
+            nextUnit[into.tail] = from.head;
+            into.tail = from.tail;
+            into.sum += from.sum;
+        }
+        std::sort(subsets.begin() + a * numTeams, subsets.begin() + (a + 1) * numTeams, [](const FSubset& x, const FSubset& y)
+            {
+                return x.sum != y.sum ? x.sum > y.sum : x.head < y.head;
+            });
+
+        partitionHeap.push_back(a);
+        std::push_heap(partitionHeap.begin(), partitionHeap.end(), lessSpread);
+    }
+
+    if (partitionHeap.empty())
+    {
+        return;
+    }
+    int result = partitionHeap.front();
+    for (int t = 0; t < numTeams; ++t)
+    {
+        teams[t].clear();
+        for (int index = subsets[result * numTeams + t].head; index != -1; index = nextUnit[index])
+        {
+            teams[t].push_back(units[index]);
+        }
+    }
+}
+
+void FTeamBalancer::LocalSearch(std::vector<std::vector<FBalanceUnit>>& teams)
+{
+    // swaps a unit of the strongest team with one of the same size and role from the weakest, picking the swap that brings the two
+    // closest together. Neither team can overshoot the other, so the overall spread never grows
+    const size_t numTeams = teams.size();
+    teamTotals.assign(numTeams, 0.0);
+    for (size_t t = 0; t < numTeams; ++t)
+    {
+        for (const FBalanceUnit& unit : teams[t])
+        {
+            teamTotals[t] += unit.rating;
+        }
+    }
+
+    for (int swap = 0; swap < MaxLocalSearchSwaps; ++swap)
+    {
+        size_t strongest = 0;
+        size_t weakest = 0;
+        for (size_t t = 1; t < numTeams; ++t)
+        {
+            strongest = teamTotals[t] > teamTotals[strongest] ? t : strongest;
+            weakest = teamTotals[t] < teamTotals[weakest] ? t : weakest;
+        }
+        double gap = teamTotals[strongest] - teamTotals[weakest];
+        if (gap <= 0.0)
+        {
+            return;
+        }
+
+        size_t bestI = 0;
+        size_t bestJ = 0;
+        double bestGap = gap;
+        for (size_t i = 0; i < teams[strongest].size(); ++i)
+        {
+            for (size_t j = 0; j < teams[weakest].size(); ++j)
+            {
+                if (teams[strongest][i].size != teams[weakest][j].size || teams[strongest][i].role != teams[weakest][j].role)
+                {
+                    continue;
+                }
+                double delta = static_cast<double>(teams[strongest][i].rating) - static_cast<double>(teams[weakest][j].rating);
+                double newGap = std::abs(gap - 2.0 * delta);
+                if (delta > 0.0 && newGap < bestGap)
+                {
+                    bestGap = newGap;
+                    bestI = i;
+                    bestJ = j;
+                }
+            }
+        }
+        if (bestGap >= gap)
+        {
+            return;
+        }
+
+        double delta = static_cast<double>(teams[strongest][bestI].rating) - static_cast<double>(teams[weakest][bestJ].rating);
+        std::swap(teams[strongest][bestI], teams[weakest][bestJ]);
+        teamTotals[strongest] -= delta;
+        teamTotals[weakest] += delta;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// How the players picked for a match are split between its teams
+enum class ETeamBalancing : uint8_t
+{
+    None,           // keep the teams as they were packed from the queue
+    Greedy,         // strongest unit first onto the weakest team that has a slot of its size
+    Differencing,   // balanced Karmarkar-Karp, falls back to Greedy when the match has parties
+};
+
+// A party (or solo player) being placed, it only moves to a slot of the same size and role so the packed teams keep their shape
+struct FBalanceUnit
+{
+    int leaderId = -1;
+    int size = 1;
+    int role = -1; // ERole the unit fills in role queues, -1 otherwise
+    float rating = 0.0f; // sum of the members' ratings
+};
+
+// Partitions the units of one match between its teams to minimize the spread of team rating totals.
+// Sorting dominates, so a match costs O(n log n) plus O(n * numTeams) for Greedy, and the optional local search is capped at
+// MaxLocalSearchSwaps swaps of two units between the strongest and weakest team. Scratch buffers are kept between calls
+class FTeamBalancer
+{
+public:
+    static constexpr int MaxLocalSearchSwaps = 8;
+
+    void Balance(ETeamBalancing mode, bool bLocalSearch, std::vector<std::vector<FBalanceUnit>>& teams);
+
+    static float GetSpread(const std::vector<std::vector<FBalanceUnit>>& teams); // strongest minus weakest team total
+
+private:
+    void BalanceGreedy(std::vector<std::vector<FBalanceUnit>>& teams);
+    void BalanceDifferencing(std::vector<std::vector<FBalanceUnit>>& teams);
+    void LocalSearch(std::vector<std::vector<FBalanceUnit>>& teams);
+
+    // a subset of a partial partition, its units are chained through nextUnit
+    struct FSubset
+    {
+        double sum = 0.0;
+        int head = -1;
+        int tail = -1;
+    };
+
+    std::vector<FBalanceUnit> units;
+    std::vector<int> nextUnit;
+    std::vector<FSubset> subsets;       // numTeams subsets per partial partition, ordered by descending sum
+    std::vector<int> partitionHeap;     // partial partitions by spread
+    std::vector<double> teamTotals;
+    std::vector<int> openSlots;         // per team, role and party size
+};
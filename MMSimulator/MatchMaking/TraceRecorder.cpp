@@ -0,0 +1,176 @@
+#include "TraceRecorder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> bTraceEnabled{false};
+
+namespace
+{
+    // Ring buffer owned by a single thread
+    struct FTraceThreadBuffer
+    {
+        static constexpr uint64_t Capacity = 1 << 16;
+
+        std::unique_ptr<FTraceEvent[]> events = std::make_unique<FTraceEvent[]>(Capacity);
+        std::atomic<uint64_t> writeIndex{0}; // total events written, the slot is writeIndex % Capacity
+        uint32_t threadId = 0;
+    };
+
+    // Registry of all thread buffers, only locked when a thread records for the first time, when it exits and when dumping
+    std::mutex traceRegistryMutex;
+    std::vector<std::unique_ptr<FTraceThreadBuffer>> traceBuffers;
+    std::vector<FTraceThreadBuffer*> freeTraceBuffers; // buffers of exited threads, taken over by the next new thread
+
+    // Hands the thread's buffer back when the thread exits. The worker pools start new threads on every batch, so the number of
+    // buffers follows the most threads recording at once rather than every thread ever started. The events stay in the buffer
+    // and are dumped under the same thread id as the next owner's.
+    struct FTraceBufferOwner
+    {
+        FTraceThreadBuffer* buffer = nullptr;
+
+        ~FTraceBufferOwner()
+        {
+            if (buffer)
+            {
+                std::lock_guard<std::mutex> lock(traceRegistryMutex);
+                freeTraceBuffers.push_back(buffer);
+            }
+        }
+    };
+
+    FTraceThreadBuffer& GetThreadBuffer()
+    {
+        thread_local FTraceBufferOwner owner;
+        if (!owner.buffer)
+        {
+            std::lock_guard<std::mutex> lock(traceRegistryMutex);
+            if (!freeTraceBuffers.empty())
+            {
+                owner.buffer = freeTraceBuffers.back();
+                freeTraceBuffers.pop_back();
+            }
+            else
+            {
+                traceBuffers.push_back(std::make_unique<FTraceThreadBuffer>());
+                owner.buffer = traceBuffers.back().get();
+                owner.buffer->threadId = static_cast<uint32_t>(traceBuffers.size());
+            }
+        }
+        return *owner.buffer;
+    }
+
+    void WriteJsonString(std::ofstream& file, const char* text)
+    {
+        file << '"';
+        for (const char* c = text; *c; ++c)
+        {
+            if (*c == '"' || *c == '\\')
+            {
+                file << '\\';
+            }
+            file << *c;
+        }
+        file << '"';
+    }
+}
+
+void SetTraceEnabled(bool bEnabled)
+{
+    bTraceEnabled.store(bEnabled, std::memory_order_relaxed);
+}
+
+void RecordTraceEvent(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    FTraceThreadBuffer& buffer = GetThreadBuffer();
+    uint64_t index = buffer.writeIndex.load(std::memory_order_relaxed);
+
+    FTraceEvent& event = buffer.events[index % FTraceThreadBuffer::Capacity];
+    event.name = name;
+    event.startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count();
+    event.durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+    // publish after the slot is written so a dump never reads a half-filled new event
+    buffer.writeIndex.store(index + 1, std::memory_order_release);
+}
+
+bool DumpChromeTrace(const std::string& path)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(traceRegistryMutex);
+
+    // rebase timestamps so the trace starts near zero
+    int64_t origin = INT64_MAX;
+    for (const auto& buffer : traceBuffers)
+    {
+        uint64_t written = buffer->writeIndex.load(std::memory_order_acquire);
+        uint64_t first = written > FTraceThreadBuffer::Capacity ? written - FTraceThreadBuffer::Capacity : 0;
+        for (uint64_t i = first; i < written; ++i)
+        {
+            origin = std::min(origin, buffer->events[i % FTraceThreadBuffer::Capacity].startNs);
+        }
+    }
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool bFirst = true;
+    for (const auto& buffer : traceBuffers)
+    {
+        uint64_t written = buffer->writeIndex.load(std::memory_order_acquire);
+        uint64_t first = written > FTraceThreadBuffer::Capacity ? written - FTraceThreadBuffer::Capacity : 0;
+        for (uint64_t i = first; i < written; ++i)
+        {
+            const FTraceEvent& event = buffer->events[i % FTraceThreadBuffer::Capacity];
+            if (!event.name)
+            {
+                continue;
+            }
+
+            file << (bFirst ? "\n" : ",\n");
+            bFirst = false;
+            file << "{\"name\":";
+            WriteJsonString(file, event.name);
+            file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                 << ",\"ts\":" << static_cast<double>(event.startNs - origin) / 1000.0
+                 << ",\"dur\":" << static_cast<double>(event.durationNs) / 1000.0 << "}";
+        }
+    }
+    file << "\n]}\n";
+    return static_cast<bool>(file);
+}
+
+void ClearTrace()
+{
+    std::lock_guard<std::mutex> lock(traceRegistryMutex);
+    for (const auto& buffer : traceBuffers)
+    {
+        buffer->writeIndex.store(0, std::memory_order_release);
+    }
+}
+
+size_t GetNumTraceEvents()
+{
+    std::lock_guard<std::mutex> lock(traceRegistryMutex);
+    size_t total = 0;
+    for (const auto& buffer : traceBuffers)
+    {
+        total += static_cast<size_t>(std::min(buffer->writeIndex.load(std::memory_order_acquire), FTraceThreadBuffer::Capacity));
+    }
+    return total;
+}
+
+size_t GetNumTraceBuffers()
+{
+    std::lock_guard<std::mutex> lock(traceRegistryMutex);
+    return traceBuffers.size();
+}
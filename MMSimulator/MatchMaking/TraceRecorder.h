@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Set to 0 to compile every trace scope out
+#ifndef MM_ENABLE_TRACE
+#define MM_ENABLE_TRACE 1
+#endif
+
+// A completed scope, timestamps are steady_clock nanoseconds
+struct FTraceEvent
+{
+    const char* name = nullptr; // must point to a string literal, only the pointer is stored
+    int64_t startNs = 0;
+    int64_t durationNs = 0;
+};
+
+// Runtime switch, checking it is a single relaxed atomic load so scopes are close to free while disabled
+extern std::atomic<bool> bTraceEnabled;
+
+inline bool IsTraceEnabled() { return bTraceEnabled.load(std::memory_order_relaxed); }
+void SetTraceEnabled(bool bEnabled);
+
+// Records into the calling thread's ring buffer. Each thread only writes its own buffer, so no lock is taken.
+// Buffers have a fixed size and overwrite their oldest events, and an exited thread's buffer is reused by the next thread that
+// records, which keeps memory bounded in long runs.
+void RecordTraceEvent(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+// Writes the buffered events of all threads as Chrome trace JSON (chrome://tracing, ui.perfetto.dev)
+bool DumpChromeTrace(const std::string& path);
+
+// Drops all buffered events, call it between updates while no other thread is recording
+void ClearTrace();
+size_t GetNumTraceEvents();
+
+// Buffers allocated so far, at most the number of threads that recorded at the same time
+size_t GetNumTraceBuffers();
+
+// Records the enclosing scope while tracing is enabled
+class FTraceScope
+{
+public:
+    explicit FTraceScope(const char* inName)
+    {
+        if (IsTraceEnabled())
+        {
+            name = inName;
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~FTraceScope()
+    {
+        if (name)
+        {
+            RecordTraceEvent(name, start, std::chrono::steady_clock::now());
+        }
+    }
+
+    FTraceScope(const FTraceScope&) = delete;
+    FTraceScope& operator=(const FTraceScope&) = delete;
+
+private:
+    const char* name = nullptr;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define MM_TRACE_CONCAT_INNER(a, b) a##b
+#define MM_TRACE_CONCAT(a, b) MM_TRACE_CONCAT_INNER(a, b)
+
+#if MM_ENABLE_TRACE
+#define MM_TRACE_SCOPE(Name) FTraceScope MM_TRACE_CONCAT(traceScope_, __LINE__)(Name)
+#else
+#define MM_TRACE_SCOPE(Name)
+#endif
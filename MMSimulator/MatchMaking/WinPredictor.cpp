@@ -0,0 +1,114 @@
+#include "WinPredictor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    // ln(10) on the rating feature makes the softmax of two teams the Elo expectation of their rating gap
+    constexpr float Ln10 = 2.302585093f;
+    constexpr float RatingCenter = 1500.0f;
+    constexpr float RatingScale = 400.0f;
+}
+
+void FWinPredictor::Reset()
+{
+    prior.fill(0.0f);
+    prior[RatingFeature] = Ln10;
+    weights = prior;
+    numUpdates = 0;
+}
+
+void FWinPredictor::AddPlayer(FFeatures& team, const FOutcomePlayer& player)
+{
+    team[RatingFeature] += (player.rating - RatingCenter) / RatingScale;
+    for (int stat = 0; stat < NumPlayStyleStats; ++stat)
+    {
+        team[FirstStatFeature + stat] += static_cast<float>(player.style[stat] - PlayStyleBase) / 5.0f;
+    }
+    const uint32_t traits = static_cast<uint32_t>(player.traits);
+    for (int trait = 0; trait < NumTraitFeatures; ++trait)
+    {
+        team[FirstTraitFeature + trait] += static_cast<float>((traits >> trait) & 1u);
+    }
+    team[StreakFeature] += std::clamp(static_cast<float>(player.streak) / 5.0f, -1.0f, 1.0f);
+    team[PartyFeature] += player.bInParty ? 1.0f : 0.0f;
+    team[PartyLeaderFeature] += player.bPartyLeader ? 1.0f : 0.0f;
+    team[ExperienceFeature] += std::min(static_cast<float>(player.matchesPlayed) / 50.0f, 1.0f);
+}
+
+void FWinPredictor::FinishTeam(FFeatures& team, int numPresent, int numAbsent)
+{
+    const float scale = 1.0f / static_cast<float>(std::max(numPresent, 1));
+    for (float& feature : team)
+    {
+        feature *= scale;
+    }
+    team[AbsentFeature] = static_cast<float>(numAbsent) / static_cast<float>(std::max(numPresent + numAbsent, 1));
+}
+
+float FWinPredictor::GetScore(const FFeatures& features) const
+{
+    float score = 0.0f;
+    for (int feature = 0; feature < NumFeatures; ++feature)
+    {
+        score += weights[feature] * features[feature];
+    }
+    return score;
+}
+
+void FWinPredictor::Predict(const FFeatures* teams, int numTeams, float* outChances) const
+{
+    float best = std::numeric_limits<float>::lowest();
+    for (int t = 0; t < numTeams; ++t)
+    {
+        outChances[t] = GetScore(teams[t]);
+        best = std::max(best, outChances[t]);
+    }
+    float total = 0.0f;
+    for (int t = 0; t < numTeams; ++t)
+    {
+        outChances[t] = std::exp(outChances[t] - best);
+        total += outChances[t];
+    }
+    for (int t = 0; t < numTeams; ++t)
+    {
+        outChances[t] /= total;
+    }
+}
+
+void FWinPredictor::Update(const FFeatures* teams, const float* chances, int numTeams, int winner, float learningRate)
+{
+    if (winner < 0 || winner >= numTeams || numTeams < 2)
+    {
+        return;
+    }
+    // the log loss gradient is the winner's features less the features the model expected to win
+    gradient = teams[winner];
+    for (int t = 0; t < numTeams; ++t)
+    {
+        const float chance = chances[t];
+        for (int feature = 0; feature < NumFeatures; ++feature)
+        {
+            gradient[feature] -= chance * teams[t][feature];
+        }
+    }
+    for (int feature = 0; feature < NumFeatures; ++feature)
+    {
+        weights[feature] += learningRate * (gradient[feature] - L2 * (weights[feature] - prior[feature]));
+    }
+    ++numUpdates;
+}
+
+float FWinPredictor::GetPlayerStrength(const FOutcomePlayer& player) const
+{
+    FFeatures features{};
+    AddPlayer(features, player);
+    return RatingCenter + GetScore(features) * RatingScale / Ln10;
+}
+
+void FWinPredictor::Serialize(FBinaryArchive& Ar)
+{
+    Ar << weights << numUpdates;
+}
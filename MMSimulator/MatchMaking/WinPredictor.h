@@ -0,0 +1,58 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+#include "BinaryArchive.h"
+#include "MatchOutcome.h"
+
+// Win probabilities of the teams of a match, learned online from match results.
+// A team is described by the average features of its players: rating, play style stats, traits, streak, party situation and
+// experience, plus the share of its players who left the game. Every team scores the dot product of its features with the
+// weights, and wins with the softmax of the scores (a conditional logit, plain logistic regression on the feature difference
+// for two teams). Every reported result takes one SGD step on its log loss, pulled back towards the prior by a little L2.
+// The weights start out as Elo on the rating alone, so the model is sensible before it has seen a result.
+// Features live in fixed arrays, so extracting them, predicting and learning are loops over a few floats that don't allocate
+class FWinPredictor
+{
+public:
+    static constexpr int NumFeatures = 32;
+    using FFeatures = std::array<float, NumFeatures>;
+
+    // feature layout, the rest is padding that stays 0
+    static constexpr int RatingFeature = 0;       // (rating - 1500) / 400
+    static constexpr int FirstStatFeature = 1;    // (stat - PlayStyleBase) / 5, NumPlayStyleStats of them
+    static constexpr int FirstTraitFeature = 8;   // 0 / 1 per trait bit, NumTraitFeatures of them
+    static constexpr int NumTraitFeatures = 16;
+    static constexpr int StreakFeature = 24;      // streak / 5, clamped
+    static constexpr int PartyFeature = 25;
+    static constexpr int PartyLeaderFeature = 26;
+    static constexpr int ExperienceFeature = 27;  // matches played / 50, up to 1
+    static constexpr int AbsentFeature = 28;      // share of the team who left the game
+
+    FWinPredictor() { Reset(); }
+    void Reset(); // back to the prior
+
+    // a team's features are the players added to zeroed features, then finished with the team's count
+    static void AddPlayer(FFeatures& team, const FOutcomePlayer& player);
+    static void FinishTeam(FFeatures& team, int numPresent, int numAbsent);
+
+    float GetScore(const FFeatures& features) const;
+    void Predict(const FFeatures* teams, int numTeams, float* outChances) const;
+    // one SGD step towards {winner}, {chances} as Predict gave them for the same teams
+    void Update(const FFeatures* teams, const float* chances, int numTeams, int winner, float learningRate);
+
+    // a player's score in rating points, so teams can be balanced on what the model expects of them
+    float GetPlayerStrength(const FOutcomePlayer& player) const;
+    float GetWeight(int feature) const { return weights[feature]; }
+    int64_t GetNumUpdates() const { return numUpdates; }
+
+    void Serialize(FBinaryArchive& Ar);
+
+private:
+    static constexpr float L2 = 0.001f;
+
+    FFeatures weights{};
+    FFeatures prior{};
+    FFeatures gradient{}; // scratch for Update
+    int64_t numUpdates = 0;
+};
@@ -1,15 +1,21 @@
 #include "UIConstructor.h"
 
+#include <algorithm>
 #include <sstream>
 
 #include "MatchMaking/MatchMakingSystem.h"
 #include "MatchMaking/MM_Elements.h"
+#include "MatchMaking/Profiler.h"
+#include "MatchMaking/TraceRecorder.h"
 #include "MatchMaking/Utility.h"
 
 float COLOR_CLEAR[4] = { 0.45f, 0.55f, 0.60f, 1.00f };
 std::unordered_map<int, bool> playerListHeaderState;
 std::unordered_map<int, bool> matchListHeaderState;
 int numOfPlayersToAdd = 5;
+char checkpointPath[260] = "mmsim_checkpoint.bin";
+char tracePath[260] = "mmsim_trace.json";
+FArrivalBurst stormBurst;
 
 void InitImGui(HWND hwnd, ID3D11Device* device, ID3D11DeviceContext* deviceContext)
 {
@@ -30,6 +36,7 @@ void InitImGui(HWND hwnd, ID3D11Device* device, ID3D11DeviceContext* deviceConte
 // Runs the MM simulator on update and renders UI
 void RenderUI(MatchMakingSystem* mmSystem)
 {
+    MM_PROFILE_SCOPE("RenderUI");
     // Start the Dear ImGui frame
     ImGui_ImplDX11_NewFrame();
     ImGui_ImplWin32_NewFrame();
@@ -43,6 +50,7 @@ void RenderUI(MatchMakingSystem* mmSystem)
     DrawLogPanel(mmSystem);
     DrawLeaderBoard(mmSystem);
     DrawMatchHistory(mmSystem);
+    DrawProfilerPanel();
     
     // Render
     ImGui::Render();
@@ -54,6 +62,7 @@ void RenderUI(MatchMakingSystem* mmSystem)
 
 void DrawControlPanel(MatchMakingSystem* mmSystem)
 {
+    MM_PROFILE_SCOPE("DrawControlPanel");
     ImGui::Begin("Controls");
 
     // Create Players button
@@ -69,42 +78,341 @@ void DrawControlPanel(MatchMakingSystem* mmSystem)
     ImGui::InputInt("##numPlayerToAdd", &numOfPlayersToAdd);
     ImGui::PopItemWidth();
     
+    // only push settings when edited, so a replay recording only sees real changes
     FMatchSetting Setting = mmSystem->GetMatchSetting();
+    bool bSettingChanged = false;
     ImGui::Text("# Teams/Match: ");
-    ImGui::InputInt("##numTeams", &Setting.numTeams);
+    bSettingChanged |= ImGui::InputInt("##numTeams", &Setting.numTeams);
     ImGui::Text("# Players/Team: ");
-    ImGui::InputInt("##teamSize", &Setting.teamSize);
+    bSettingChanged |= ImGui::InputInt("##teamSize", &Setting.teamSize);
     ImGui::Text("# Match/Cycle: ");
-    ImGui::InputInt("##matchPerCycle", &Setting.matchesPerCycle);
-    mmSystem->SetMatchSetting(Setting);
+    bSettingChanged |= ImGui::InputInt("##matchPerCycle", &Setting.matchesPerCycle);
+    ImGui::Text("Match Duration (s): ");
+    bSettingChanged |= ImGui::InputInt("##matchDuration", &Setting.matchDuration);
+    bSettingChanged |= ImGui::Checkbox("Adaptive Scheduling", &Setting.bAdaptiveScheduling);
+    if (Setting.bAdaptiveScheduling)
+    {
+        ImGui::Text("Cycle Budget (ms): ");
+        bSettingChanged |= ImGui::InputFloat("##cycleBudget", &Setting.cycleBudgetMs, 0.5f, 1.0f, "%.2f");
+        ImGui::Text("Min/Max Cycle Delay (ms): ");
+        bSettingChanged |= ImGui::InputInt("##minCycleDelay", &Setting.minCycleDelay);
+        bSettingChanged |= ImGui::InputInt("##maxCycleDelay", &Setting.maxCycleDelay);
+    }
+    ImGui::Text("Update Budget (ms, 0 = unlimited): ");
+    bSettingChanged |= ImGui::InputFloat("##updateBudget", &Setting.updateBudgetMs, 0.5f, 1.0f, "%.2f");
+    const char* balancingNames[] = { "None", "Greedy", "Differencing" };
+    int balancing = static_cast<int>(Setting.teamBalancing);
+    ImGui::Text("Team Balancing: ");
+    if (ImGui::Combo("##teamBalancing", &balancing, balancingNames, IM_ARRAYSIZE(balancingNames)))
+    {
+        Setting.teamBalancing = static_cast<ETeamBalancing>(balancing);
+        bSettingChanged = true;
+    }
+    bSettingChanged |= ImGui::Checkbox("Balancing Local Search", &Setting.bBalancingLocalSearch);
+    bSettingChanged |= ImGui::Checkbox("Region Sharding", &Setting.bRegionSharding);
+    if (Setting.bRegionSharding)
+    {
+        ImGui::Text("Spillover Wait (s) / Max Latency (ms): ");
+        bSettingChanged |= ImGui::InputFloat("##spilloverWait", &Setting.spilloverWait, 1.0f, 5.0f, "%.1f");
+        bSettingChanged |= ImGui::InputInt("##maxSpilloverLatency", &Setting.maxSpilloverLatency, 10, 50);
+    }
+    const char* formationNames[] = { GetFormationName(EMatchFormation::Fifo), GetFormationName(EMatchFormation::SkillBuckets), GetFormationName(EMatchFormation::SkillWindows),
+        GetFormationName(EMatchFormation::Roles), GetFormationName(EMatchFormation::Batch), GetFormationName(EMatchFormation::PlayStyle) };
+    int formation = static_cast<int>(Setting.formation);
+    ImGui::Text("Match Formation: ");
+    if (ImGui::Combo("##formation", &formation, formationNames, IM_ARRAYSIZE(formationNames)))
+    {
+        Setting.formation = static_cast<EMatchFormation>(formation);
+        bSettingChanged = true;
+    }
+    if (Setting.formation == EMatchFormation::SkillBuckets)
+    {
+        ImGui::Text("Bucket Width (rating): ");
+        bSettingChanged |= ImGui::InputFloat("##ratingBucketWidth", &Setting.ratingBucketWidth, 10.0f, 50.0f, "%.0f");
+    }
+    else if (Setting.formation == EMatchFormation::SkillWindows)
+    {
+        ImGui::Text("Initial / Max Window (rating): ");
+        bSettingChanged |= ImGui::InputFloat("##searchWindow", &Setting.searchWindow, 10.0f, 50.0f, "%.0f");
+        bSettingChanged |= ImGui::InputFloat("##maxSearchWindow", &Setting.maxSearchWindow, 10.0f, 50.0f, "%.0f");
+        ImGui::Text("Growth (rating) / Interval (s): ");
+        bSettingChanged |= ImGui::InputFloat("##searchWindowGrowth", &Setting.searchWindowGrowth, 10.0f, 50.0f, "%.0f");
+        bSettingChanged |= ImGui::InputFloat("##searchWindowInterval", &Setting.searchWindowInterval, 1.0f, 5.0f, "%.1f");
+    }
+    else if (Setting.formation == EMatchFormation::Roles)
+    {
+        ImGui::Text("Players/Team by Role: ");
+        for (int role = 0; role < NumRoles; ++role)
+        {
+            int count = Setting.roleComposition[role];
+            if (ImGui::InputInt(GetRoleName(role), &count))
+            {
+                Setting.roleComposition[role] = static_cast<uint8_t>(std::clamp(count, 0, 10));
+                bSettingChanged = true;
+            }
+        }
+    }
+    else if (Setting.formation == EMatchFormation::Batch)
+    {
+        ImGui::Text("Batch Window (ms) / Budget (ms) / Threads: ");
+        bSettingChanged |= ImGui::InputInt("##batchWindowMs", &Setting.batchWindowMs, 100, 500);
+        bSettingChanged |= ImGui::InputFloat("##batchBudgetMs", &Setting.batchBudgetMs, 0.5f, 2.0f, "%.1f");
+        bSettingChanged |= ImGui::InputInt("##batchThreads", &Setting.batchThreads);
+        ImGui::Text("Latency Weight / Max Cost / Cost Growth (per s): ");
+        bSettingChanged |= ImGui::InputFloat("##batchLatencyWeight", &Setting.batchLatencyWeight, 0.5f, 2.0f, "%.1f");
+        bSettingChanged |= ImGui::InputFloat("##batchMaxCost", &Setting.batchMaxCost, 10.0f, 50.0f, "%.0f");
+        bSettingChanged |= ImGui::InputFloat("##batchCostGrowth", &Setting.batchCostGrowth, 5.0f, 20.0f, "%.0f");
+    }
+    else if (Setting.formation == EMatchFormation::PlayStyle)
+    {
+        ImGui::Text("Max Play Style Distance: ");
+        bSettingChanged |= ImGui::InputFloat("##playStyleDistance", &Setting.playStyleDistance, 0.5f, 2.0f, "%.1f");
+    }
+    bSettingChanged |= ImGui::Checkbox("Backfill", &Setting.bBackfill);
+    if (Setting.bBackfill)
+    {
+        ImGui::Text("Grace (s) / Rating Window / Min Remaining: ");
+        bSettingChanged |= ImGui::InputFloat("##backfillGrace", &Setting.backfillGrace, 0.5f, 2.0f, "%.1f");
+        bSettingChanged |= ImGui::InputFloat("##backfillRatingWindow", &Setting.backfillRatingWindow, 10.0f, 50.0f, "%.0f");
+        bSettingChanged |= ImGui::SliderFloat("##backfillMinRemaining", &Setting.backfillMinRemaining, 0.0f, 1.0f, "%.2f");
+    }
+    bSettingChanged |= ImGui::Checkbox("Outcome Model", &Setting.bOutcomeModel);
+    bSettingChanged |= ImGui::Checkbox("Round Simulation", &Setting.bRoundSimulation);
+    if (Setting.bRoundSimulation)
+    {
+        ImGui::Text("Rounds to Win / Threads: ");
+        bSettingChanged |= ImGui::InputInt("##roundsToWin", &Setting.roundsToWin);
+        bSettingChanged |= ImGui::InputInt("##roundThreads", &Setting.roundThreads);
+    }
+    bSettingChanged |= ImGui::Checkbox("Win Predictor", &Setting.bWinPredictor);
+    if (Setting.bWinPredictor)
+    {
+        ImGui::Text("Learning Rate: ");
+        bSettingChanged |= ImGui::InputFloat("##predictorLearningRate", &Setting.predictorLearningRate, 0.005f, 0.02f, "%.3f");
+        bSettingChanged |= ImGui::Checkbox("Balance by Prediction", &Setting.bBalanceByPrediction);
+    }
+    const char* ratingNames[] = { GetRatingSystemName(ERatingSystem::Elo), GetRatingSystemName(ERatingSystem::Glicko2), GetRatingSystemName(ERatingSystem::TrueSkill) };
+    int ratingSystem = static_cast<int>(Setting.ratingSystem);
+    ImGui::Text("Rating System: ");
+    if (ImGui::Combo("##ratingSystem", &ratingSystem, ratingNames, IM_ARRAYSIZE(ratingNames)))
+    {
+        Setting.ratingSystem = static_cast<ERatingSystem>(ratingSystem);
+        bSettingChanged = true;
+    }
+    ImGui::Text("Rating Period (s) / Threads: ");
+    bSettingChanged |= ImGui::InputFloat("##ratingPeriodSeconds", &Setting.ratingPeriodSeconds, 10.0f, 60.0f, "%.0f");
+    bSettingChanged |= ImGui::InputInt("##ratingThreads", &Setting.ratingThreads);
+    bSettingChanged |= ImGui::Checkbox("Avoid Rematches", &Setting.bAvoidRematches);
+    if (Setting.bAvoidRematches)
+    {
+        ImGui::Text("Grace (s): ");
+        bSettingChanged |= ImGui::InputFloat("##rematchGraceSeconds", &Setting.rematchGraceSeconds, 5.0f, 30.0f, "%.0f");
+    }
+    ImGui::Text("Wait SLO (s): ");
+    bSettingChanged |= ImGui::InputFloat("##waitSloSeconds", &Setting.waitSloSeconds, 5.0f, 30.0f, "%.0f");
+    if (bSettingChanged)
+    {
+        mmSystem->SetMatchSetting(Setting);
+    }
+
+    // Arrivals, pushed only when edited like the match settings
+    ImGui::NewLine();
+    FArrivalSetting Arrival = mmSystem->GetArrivalSetting();
+    bool bArrivalChanged = false;
+    const char* processNames[] = { "None", "Poisson", "Diurnal" };
+    int process = static_cast<int>(Arrival.process);
+    ImGui::Text("Arrival Process: ");
+    if (ImGui::Combo("##arrivalProcess", &process, processNames, IM_ARRAYSIZE(processNames)))
+    {
+        Arrival.process = static_cast<EArrivalProcess>(process);
+        bArrivalChanged = true;
+    }
+    if (Arrival.process != EArrivalProcess::None)
+    {
+        ImGui::Text("Arrivals/s: ");
+        bArrivalChanged |= ImGui::InputFloat("##arrivalRate", &Arrival.arrivalRate, 1.0f, 10.0f, "%.2f");
+        if (Arrival.process == EArrivalProcess::Diurnal)
+        {
+            ImGui::Text("Day Length (s): ");
+            bArrivalChanged |= ImGui::InputFloat("##dayLength", &Arrival.dayLength, 10.0f, 60.0f, "%.0f");
+        }
+        ImGui::Text("Mean Session (s) / Spread: ");
+        bArrivalChanged |= ImGui::InputFloat("##sessionLength", &Arrival.meanSessionLength, 10.0f, 60.0f, "%.0f");
+        bArrivalChanged |= ImGui::SliderFloat("##sessionSpread", &Arrival.sessionLengthSpread, 0.0f, 2.0f);
+        ImGui::Text("Returning Player Ratio: ");
+        bArrivalChanged |= ImGui::SliderFloat("##returningRatio", &Arrival.returningPlayerRatio, 0.0f, 1.0f);
+        ImGui::Text("Party Size Weights (1 - %d): ", FPartyQueue::MaxPartySize);
+        Arrival.partySizeWeights.resize(FPartyQueue::MaxPartySize, 0.0f);
+        for (int size = 0; size < FPartyQueue::MaxPartySize; ++size)
+        {
+            std::string label = "##partyWeight" + std::to_string(size + 1);
+            bArrivalChanged |= ImGui::SliderFloat(label.c_str(), &Arrival.partySizeWeights[size], 0.0f, 1.0f);
+        }
+        ImGui::Text("Region Population Weights: ");
+        Arrival.regionWeights.resize(NumRegions, 0.0f);
+        for (int region = 0; region < NumRegions; ++region)
+        {
+            std::string label = std::string(GetRegionName(region)) + "##regionWeight";
+            bArrivalChanged |= ImGui::SliderFloat(label.c_str(), &Arrival.regionWeights[region], 0.0f, 1.0f);
+        }
+
+        ImGui::Text("Storm Arrivals/s, Duration (s): ");
+        ImGui::InputFloat("##stormRate", &stormBurst.rate, 10.0f, 100.0f, "%.0f");
+        ImGui::InputFloat("##stormDuration", &stormBurst.duration, 1.0f, 10.0f, "%.0f");
+        if (ImGui::Button("Trigger Storm"))
+        {
+            FArrivalBurst burst = stormBurst;
+            burst.startTime = mmSystem->GetArrivalElapsedSeconds();
+            Arrival.bursts.push_back(burst);
+            bArrivalChanged = true;
+        }
+    }
+    ImGui::Text("Disconnects/min in game: ");
+    bArrivalChanged |= ImGui::InputFloat("##disconnectRate", &Arrival.disconnectRate, 0.1f, 1.0f, "%.2f");
+    if (Arrival.disconnectRate > 0.0f)
+    {
+        ImGui::Text("Reconnect Chance: ");
+        bArrivalChanged |= ImGui::SliderFloat("##reconnectChance", &Arrival.reconnectChance, 0.0f, 1.0f);
+        ImGui::Text("Reconnect Delay / Window (s): ");
+        bArrivalChanged |= ImGui::InputFloat("##reconnectDelay", &Arrival.meanReconnectDelay, 1.0f, 5.0f, "%.1f");
+        bArrivalChanged |= ImGui::InputFloat("##reconnectWindow", &Arrival.reconnectWindow, 1.0f, 5.0f, "%.1f");
+    }
+    bArrivalChanged |= ImGui::Checkbox("Queue Abandonment", &Arrival.bQueueAbandonment);
+    if (Arrival.bQueueAbandonment)
+    {
+        ImGui::Text("Patience Casual / Competitive (s) / Spread: ");
+        bArrivalChanged |= ImGui::InputFloat("##casualPatience", &Arrival.casualPatience, 5.0f, 30.0f, "%.0f");
+        bArrivalChanged |= ImGui::InputFloat("##competitivePatience", &Arrival.competitivePatience, 5.0f, 30.0f, "%.0f");
+        bArrivalChanged |= ImGui::SliderFloat("##patienceSpread", &Arrival.patienceSpread, 0.0f, 2.0f, "%.2f");
+    }
+    if (bArrivalChanged)
+    {
+        mmSystem->SetArrivalSetting(Arrival);
+    }
+
+    // Checkpoint
+    ImGui::NewLine();
+    ImGui::Text("Checkpoint: ");
+    ImGui::InputText("##checkpointPath", checkpointPath, sizeof(checkpointPath));
+    if (ImGui::Button("Save Checkpoint"))
+    {
+        mmSystem->SaveCheckpoint(checkpointPath);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Load Checkpoint"))
+    {
+        if (mmSystem->LoadCheckpoint(checkpointPath))
+        {
+            playerListHeaderState.clear();
+            matchListHeaderState.clear();
+        }
+    }
+
+    // Trace
+    ImGui::NewLine();
+    ImGui::Text("Trace (%d events buffered): ", static_cast<int>(GetNumTraceEvents()));
+    ImGui::InputText("##tracePath", tracePath, sizeof(tracePath));
+    bool bTracing = IsTraceEnabled();
+    if (ImGui::Checkbox("Record Trace", &bTracing))
+    {
+        SetTraceEnabled(bTracing);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Dump Trace"))
+    {
+        DumpChromeTrace(tracePath);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear Trace"))
+    {
+        ClearTrace();
+    }
     
     ImGui::End();
 }
 
 void DrawStatusPanel(const MatchMakingSystem* mmSystem)
 {
+    MM_PROFILE_SCOPE("DrawStatusPanel");
     ImGui::Begin("Current Status");
     ImGui::Text("# of ongoing matches: %d", static_cast<int>(mmSystem->GetOngoingMatchIds().size()));
+    ImGui::Text("# of queued players: %d", mmSystem->GetNumQueuedPlayers());
+
+    FMatchmakingStats stats = mmSystem->GetMatchmakingStats();
+    ImGui::Text("Formation rate: %.2f matches/s (fixed cap %.2f)", stats.achievedRate, stats.configuredCap);
+    ImGui::Text("Cycle delay: %d ms, last cycle: %d matches", stats.cycleDelay, stats.lastCycleMatches);
+    ImGui::Text("Budget-limited cycles: %lld / %lld", static_cast<long long>(stats.budgetLimitedCycles), static_cast<long long>(stats.totalCycles));
+    ImGui::Text("Parties: %d, average queued party size: %.2f", stats.activeParties, stats.avgQueuedPartySize);
+    ImGui::Text("Packing failures: %lld, split parties: %lld", static_cast<long long>(stats.packingFailures), static_cast<long long>(stats.splitParties));
+    ImGui::Text("Team rating spread: %.1f (%.1f as packed)", stats.avgTeamSpread, stats.avgPackedSpread);
+    ImGui::Text("Skill: rating range %.0f, window %.0f avg when matched, %lld widenings, %lld misses", stats.avgRatingRange, stats.avgMatchedWindow,
+        static_cast<long long>(stats.windowWidenings), static_cast<long long>(stats.ratingMisses));
+    for (int role = 0; role < NumRoles; ++role)
+    {
+        ImGui::Text("%s: %d queued, queue %.1f s, starved %.1f s, %lld misses", GetRoleName(role), stats.queuedByRole[role], stats.avgRoleQueueSeconds[role],
+            stats.roleStarvedSeconds[role], static_cast<long long>(stats.roleMisses[role]));
+    }
+    ImGui::Text("Play style: distance %.2f within matches, %lld misses", stats.avgStyleDistance, static_cast<long long>(stats.styleMisses));
+    ImGui::Text("Batch: %lld solves, %.2f ms avg, %lld blocks cut", static_cast<long long>(stats.batchSolves), stats.avgBatchSolveMs,
+        static_cast<long long>(stats.batchBlocksCut));
+    ImGui::Text("Backfill: %d open slots, %lld filled, %lld expired, wait %.1f s, rating gap %.0f", stats.openSlots, static_cast<long long>(stats.backfills),
+        static_cast<long long>(stats.expiredSlots), stats.avgBackfillWait, stats.avgBackfillGap);
+    ImGui::Text("Outcomes: %lld batches of %.1f matches, favorite won %.1f%%, winner's chance %.1f%%", static_cast<long long>(stats.outcomeBatches),
+        stats.avgOutcomeBatch, stats.favoriteWinRate * 100.0f, stats.avgWinnerChance * 100.0f);
+    ImGui::Text("Rounds: %lld matches of %.1f rounds, %.3f ms per cycle, matches last %.2fs", static_cast<long long>(stats.roundMatches),
+        stats.avgRounds, stats.avgRoundBatchMs, stats.avgMatchSeconds);
+    ImGui::Text("Predictor: %lld results, log loss %.3f, accuracy %.1f%%, favorite's chance %.1f%%, rating weight %.2f", static_cast<long long>(stats.predictorUpdates),
+        stats.predictorLogLoss, stats.predictorAccuracy * 100.0f, stats.avgPredictedFavorite * 100.0f, stats.predictorRatingWeight);
+    ImGui::Text("Ratings: %lld matches rated, %.3f ms per batch, %lld periods, average deviation %.1f", static_cast<long long>(stats.ratedMatches),
+        stats.avgRatingBatchMs, static_cast<long long>(stats.ratingPeriods), stats.avgDeviation);
+    ImGui::Text("Rematches: %lld matches, %lld parties passed over, %lld after the grace period", static_cast<long long>(stats.rematchMatches),
+        static_cast<long long>(stats.rematchRejections), static_cast<long long>(stats.rematchFallbacks));
+    ImGui::Text("Wait SLO: %lld breaches, %.1f%% of the parties that left the queue", static_cast<long long>(stats.sloBreaches), stats.sloBreachRate * 100.0f);
+    for (int region = 0; region < NumRegions; ++region)
+    {
+        FRegionStats regionStats = mmSystem->GetRegionStats(region);
+        ImGui::Text("%s: %d queued, %lld matches (%lld spilled), queue %.1f s, %.0f ms, cpu %.1f ms", GetRegionName(region), regionStats.queuedPlayers,
+            static_cast<long long>(regionStats.matches), static_cast<long long>(regionStats.spilledMatches), regionStats.avgQueueSeconds, regionStats.avgLatencyMs, regionStats.cpuMs);
+    }
+
+    FArrivalStats arrivals = mmSystem->GetArrivalStats();
+    ImGui::Text("Online: %d, offline: %d (cold storage %.1f KB)", arrivals.onlinePlayers, arrivals.offlinePlayers, static_cast<float>(arrivals.coldStorageBytes) / 1024.0f);
+    ImGui::Text("Disconnects: %lld, reconnects: %lld, timed out: %lld", static_cast<long long>(arrivals.disconnects),
+        static_cast<long long>(arrivals.reconnects), static_cast<long long>(arrivals.reconnectTimeouts));
+    ImGui::Text("Abandoned: %lld parties, %lld players, after %.1f s", static_cast<long long>(arrivals.abandonments),
+        static_cast<long long>(arrivals.abandonedPlayers), arrivals.avgAbandonSeconds);
+    ImGui::Text("Arrival rate: %.2f/s (day %.0f%%), arrivals: %lld, departures: %lld", arrivals.currentRate, arrivals.timeOfDay * 100.0f,
+        static_cast<long long>(arrivals.arrivals), static_cast<long long>(arrivals.departures));
+
+    const FUpdateBacklog& backlog = mmSystem->GetUpdateBacklog();
+    ImGui::Text("Update: %.2f ms, sliced calls: %lld", backlog.lastUpdateMs, static_cast<long long>(backlog.slicedUpdates));
+    ImGui::Text("Backlog: %d player events, %d match ends, %d matches to form, arrivals %.0f ms behind", backlog.playerEvents, backlog.matchEnds, backlog.matchmakeMatches, backlog.arrivalLagMs);
 
     ImGui::NewLine();
     
-    std::unordered_map<int, VirtualPlayer> allPlayers = mmSystem->GetAllPlayers();
+    // offline players are in cold storage, so ids of active players have gaps
+    const std::unordered_map<int, VirtualPlayer>& allPlayers = mmSystem->GetAllPlayers();
     if (allPlayers.empty())
     {
         ImGui::Text("No players available.");
     }
     else
     {
-        ImGui::Text("Total players: %d", static_cast<int>(allPlayers.size()));
+        ImGui::Text("Active players: %d", static_cast<int>(allPlayers.size()));
         ImGui::Text("Average Queue time: %.2f", mmSystem->GetAvgQueueTime());
-        for (int i = 0; i < static_cast<int>(allPlayers.size()); ++i)
+        for (int i = 0; i < mmSystem->GetNextPlayerId(); ++i)
         {
+            auto it = allPlayers.find(i);
+            if (it == allPlayers.end())
+            {
+                continue;
+            }
             if (playerListHeaderState.find(i) == playerListHeaderState.end())
             {
                 playerListHeaderState[i] = false;
             }
 
-            DrawPlayerEntry(allPlayers.find(i)->second, i, playerListHeaderState);
+            DrawPlayerEntry(it->second, i, playerListHeaderState);
         }
     }
     ImGui::End();
@@ -113,6 +421,7 @@ void DrawStatusPanel(const MatchMakingSystem* mmSystem)
 
 void DrawLogPanel(const MatchMakingSystem* mmSystem)
 {
+    MM_PROFILE_SCOPE("DrawLogPanel");
     ImGui::Begin("Match Log - System Online...");
 
     ImGui::Text("Player Log");
@@ -149,6 +458,7 @@ void DrawLogPanel(const MatchMakingSystem* mmSystem)
 
 void DrawLeaderBoard(const MatchMakingSystem* mmSystem)
 {
+    MM_PROFILE_SCOPE("DrawLeaderBoard");
     ImGui::Begin("===== Leader Board =====");
 
     std::vector<VirtualPlayer*> topPlayers = mmSystem->GetTopPlayersByWinRate();
@@ -169,6 +479,7 @@ void DrawLeaderBoard(const MatchMakingSystem* mmSystem)
 
 void DrawMatchHistory(const MatchMakingSystem* mmSystem)
 {
+    MM_PROFILE_SCOPE("DrawMatchHistory");
     ImGui::Begin("Match History");
 
     std::unordered_map<int, FMatch> allMatches = mmSystem->GetAllMatches();
@@ -192,6 +503,24 @@ void DrawMatchHistory(const MatchMakingSystem* mmSystem)
             {
                 matchListHeaderState[i] = true;
                 ImGui::Text("Duration: %.2fs", match.matchDuration);
+                if (!match.roundScores.empty())
+                {
+                    std::string scoreDisplay;
+                    for (size_t t = 0; t < match.roundScores.size(); ++t)
+                    {
+                        scoreDisplay.append((t > 0 ? " - " : "") + std::to_string(match.roundScores[t]));
+                    }
+                    ImGui::Text("Rounds: %s", scoreDisplay.c_str());
+                }
+                if (!match.predictedChances.empty())
+                {
+                    std::string chanceDisplay;
+                    for (size_t t = 0; t < match.predictedChances.size(); ++t)
+                    {
+                        chanceDisplay.append((t > 0 ? " / " : "") + std::to_string(static_cast<int>(match.predictedChances[t] * 100.0f + 0.5f)) + "%");
+                    }
+                    ImGui::Text("Predicted: %s", chanceDisplay.c_str());
+                }
                 ImGui::Text("Teams: %s", match.CreateTeamVersusMessage().str().c_str());
                 std::string teamDisplay;
                 if (!match.winningTeam.empty())
@@ -213,6 +542,50 @@ void DrawMatchHistory(const MatchMakingSystem* mmSystem)
     ImGui::End();
 }
 
+void DrawProfilerPanel()
+{
+    MM_PROFILE_SCOPE("DrawProfilerPanel");
+    ImGui::Begin("Profiler");
+
+    constexpr float frameBudgetMs = 1000.0f / 60.0f;
+    FProfileSummary frame = GetFrameTimeSummary();
+    ImGui::Text("Frame: %.2fms (avg %.2f, p99 %.2f, max %.2f), budget %.2fms", frame.lastMs, frame.avgMs, frame.p99Ms, frame.maxMs, frameBudgetMs);
+
+    static std::vector<float> frameTimes;
+    GetFrameTimeHistory(frameTimes);
+    int overBudget = static_cast<int>(std::count_if(frameTimes.begin(), frameTimes.end(), [](float ms) { return ms > frameBudgetMs; }));
+    std::string overlay = std::to_string(overBudget) + " of " + std::to_string(frameTimes.size()) + " frames over budget";
+    ImGui::PlotLines("##frameTimes", frameTimes.data(), static_cast<int>(frameTimes.size()), 0, overlay.c_str(), 0.0f, frameBudgetMs * 2.0f, ImVec2(ImGui::GetContentRegionAvail().x, 80.0f));
+
+    // per-phase totals per frame over the last NumProfileFrames frames
+    if (ImGui::BeginTable("ProfileStats", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+    {
+        ImGui::TableSetupColumn("Scope");
+        ImGui::TableSetupColumn("Last ms");
+        ImGui::TableSetupColumn("Min ms");
+        ImGui::TableSetupColumn("Avg ms");
+        ImGui::TableSetupColumn("Max ms");
+        ImGui::TableSetupColumn("P99 ms");
+        ImGui::TableSetupColumn("Calls/frame");
+        ImGui::TableHeadersRow();
+
+        for (const FProfileSummary& summary : GetProfileSummaries())
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(summary.name);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", summary.lastMs);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", summary.minMs);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", summary.avgMs);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", summary.maxMs);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", summary.p99Ms);
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", summary.avgCalls);
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::End();
+}
+
 void DrawPlayerEntry(const VirtualPlayer& player, int drawIndex, std::unordered_map<int, bool>& headerStateMapping)
 {
     ImGui::SetNextItemOpen(headerStateMapping[drawIndex]);
@@ -240,6 +613,16 @@ void DrawPlayerEntry(const VirtualPlayer& player, int drawIndex, std::unordered_
         ImGui::NewLine();
         
         ImGui::Text("Win Rate: %.2f%%", player.GetWinRate() * 100.0f);
+        ImGui::Text("Rating: %.0f, streak: %d", player.GetRating(), player.GetStreak());
+        ImGui::Text("Region: %s (%d ms)", GetRegionName(player.GetRegion()), player.GetLatency(player.GetRegion()));
+        ImGui::Text("Roles: %s", RolesToString(player.GetRoles()).c_str());
+        const FPlayStyle style = player.GetPlayStyle();
+        std::string styleText;
+        for (int stat = 0; stat < NumPlayStyleStats; ++stat)
+        {
+            styleText += std::string(stat > 0 ? ", " : "") + GetPlayStyleStatName(stat) + " " + std::to_string(style[stat]);
+        }
+        ImGui::Text("Play Style: %s", styleText.c_str());
         ImGui::Text("W: %d, L: %d", static_cast<int>(player.GetWonMatches().size()), static_cast<int>(player.GetLostMatches().size()));
         ImGui::Text("Total Online Time: %d", player.GetOnlineTime());
         ImGui::Text("Average Queue Time: %.2f", player.GetAvgQueueTime());
@@ -28,6 +28,7 @@ void DrawStatusPanel(const MatchMakingSystem* mmSystem);
 void DrawLogPanel(const MatchMakingSystem* mmSystem);
 void DrawLeaderBoard(const MatchMakingSystem* mmSystem);
 void DrawMatchHistory(const MatchMakingSystem* mmSystem);
+void DrawProfilerPanel();
 
 // Virtual Player Display
 void DrawPlayerEntry(const VirtualPlayer& player, int drawIndex, std::unordered_map<int, bool>& headerStateMapping);